@@ -2,19 +2,22 @@
 #define AFINA_THREADPOOL_H
 
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <string>
 #include <thread>
+#include <vector>
 
 namespace Afina {
 
 /**
  * # Thread pool
+ * Fixed number of threads executing tasks from the shared queue in FIFO order
  */
 class Executor {
+public:
     enum class State {
         // Threadpool is fully operational, tasks could be added and get executed
         kRun,
@@ -27,6 +30,9 @@ class Executor {
         kStopped
     };
 
+    /**
+     * Starts size threads, name is given to each of them to tell pool threads apart in debugger and top
+     */
     Executor(std::string name, int size);
     ~Executor();
 
@@ -96,6 +102,16 @@ private:
      * Flag to stop bg threads
      */
     State state;
+
+    /**
+     * Number of threads still running perform, the last one switches pool into kStopped
+     */
+    size_t running;
+
+    /**
+     * Name given to pool threads
+     */
+    std::string name;
 };
 
 } // namespace Afina
@@ -1,12 +1,73 @@
 #ifndef AFINA_STORAGE_H
 #define AFINA_STORAGE_H
 
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
 #include <string>
 
 namespace Afina {
 
 /**
+ * # Read-only value handle
+ * Points to value bytes kept by the storage without copying them. Bytes stay valid and unchanged
+ * while at least one handle referencing them is alive, even if association gets overwritten or
+ * deleted meanwhile. Handle could be safely passed to other threads, for example to network
+ * layer to write value out directly from the storage memory
+ */
+class PinnedValue {
+public:
+    PinnedValue() : _size(0) {}
+
+    /**
+     * Shares given bytes, data pointer also controls lifetime of the bytes
+     */
+    PinnedValue(std::shared_ptr<const char> data, size_t size) : _data(std::move(data)), _size(size) {}
+
+    /**
+     * Shares bytes of the given string, string is kept alive by the handle
+     */
+    explicit PinnedValue(const std::shared_ptr<const std::string> &str) : _data(str, str->data()), _size(str->size()) {}
+
+    const char *data() const { return _data.get(); }
+    size_t size() const { return _size; }
+
+    /**
+     * Releases reference to the value bytes
+     */
+    void reset() {
+        _data.reset();
+        _size = 0;
+    }
+
+private:
+    std::shared_ptr<const char> _data;
+    size_t _size;
+};
+
+/**
+ * # Outcome of Storage::CompareAndSwap
+ */
+enum class CasResult {
+    // Value has been replaced
+    kStored,
+
+    // Association exists but has been modified since version was read
+    kExists,
+
+    // There is no association for the key
+    kNotFound
+};
+
+/**
+ * # Storage interface
+ * Associations could be given expiration time: absolute unix time in seconds after which
+ * association is considered to be absent, 0 means it never expires. Expired associations are
+ * invisible to all methods and their memory is reclaimed lazily on access and by ReapExpired
  *
+ * Every association carries a version, which changes each time its value gets modified. Version
+ * could be read by GetVersioned and used by CompareAndSwap to detect concurrent updates
  */
 class Storage {
 public:
@@ -27,8 +88,38 @@ public:
      *
      * @param key to be associated with value
      * @param value to be assigned for the key
+     * @param expire_at unix time when association expires, 0 if never
+     */
+    virtual bool Put(const std::string &key, const std::string &value, time_t expire_at = 0) = 0;
+
+    /**
+     * Allocates empty value with room for the given number of bytes, to be filled by the caller and then
+     * stored by PutReserved. Lets network layer collect large data block without growing temporary buffers.
+     * Value isn't visible to anybody until PutReserved is called, and is simply released if it never is
+     *
+     * Default implementation allocates a new string. Map based backends keep values in strings and override
+     * PutReserved to take it without copying, backends with own value memory (lru, arena, lockfree) use the
+     * default one and copy the value once
+     *
+     * @param size number of value bytes
+     */
+    virtual std::shared_ptr<std::string> ReserveValue(size_t size) {
+        std::shared_ptr<std::string> value = std::make_shared<std::string>();
+        value->reserve(size);
+        return value;
+    }
+
+    /**
+     * Stores association between given key and value obtained from ReserveValue, otherwise works like Put.
+     * Caller must not touch the value after that
+     *
+     * @param key to be associated with value
+     * @param value filled value returned by ReserveValue
+     * @param expire_at unix time when association expires, 0 if never
      */
-    virtual bool Put(const std::string &key, const std::string &value) = 0;
+    virtual bool PutReserved(const std::string &key, std::shared_ptr<std::string> value, time_t expire_at = 0) {
+        return Put(key, *value, expire_at);
+    }
 
     /**
      * Stores association between given key/value pair if key isn't present in
@@ -40,8 +131,9 @@ public:
      *
      * @param key to be associated with value
      * @param value to be assigned for the key
+     * @param expire_at unix time when association expires, 0 if never
      */
-    virtual bool PutIfAbsent(const std::string &key, const std::string &value) = 0;
+    virtual bool PutIfAbsent(const std::string &key, const std::string &value, time_t expire_at = 0) = 0;
 
     /**
      * Updates existing association between given key/value pair
@@ -53,8 +145,41 @@ public:
      *
      * @param key to be associated with value
      * @param value to be assigned for the key
+     * @param expire_at unix time when association expires, 0 if never
      */
-    virtual bool Set(const std::string &key, const std::string &value) = 0;
+    virtual bool Set(const std::string &key, const std::string &value, time_t expire_at = 0) = 0;
+
+    /**
+     * Adds data to the end of existing value
+     * If requested key doesn't present in storage method returns false and doesn't change
+     * anything. Expiration time of the association stays the same
+     *
+     * Read and update happen atomically: concurrent modifications of the same key are never lost
+     *
+     * @param key to modify value of
+     * @param suffix data to be added
+     */
+    virtual bool Append(const std::string &key, const std::string &suffix) = 0;
+
+    /**
+     * Adds data to the beginning of existing value, otherwise works like Append
+     *
+     * @param key to modify value of
+     * @param prefix data to be added
+     */
+    virtual bool Prepend(const std::string &key, const std::string &prefix) = 0;
+
+    /**
+     * Replaces value of existing association if it hasn't been modified since given version was
+     * obtained by GetVersioned. Check and update happen atomically
+     *
+     * @param key to be associated with value
+     * @param value to be assigned for the key
+     * @param version expected current version of the association
+     * @param expire_at unix time when association expires, 0 if never
+     */
+    virtual CasResult CompareAndSwap(const std::string &key, const std::string &value, uint64_t version,
+                                     time_t expire_at = 0) = 0;
 
     /**
      * Removes association for the given key
@@ -84,6 +209,57 @@ public:
      * @param value output parameter to copy value to
      */
     virtual bool Get(const std::string &key, std::string &value) const = 0;
+
+    /**
+     * Retrive value for the given key without copying it
+     * If there is an association for the given key then method sets output parameter to
+     * reference current value and returns true. Referenced bytes are never modified, so later
+     * updates of the association are not visible through the handle
+     *
+     * In case if given key not found method returns false and doesn't perform any changes on
+     * the output parameter
+     *
+     * Default implementation copies value into a new buffer, backends override it to share
+     * their own memory
+     *
+     * @param key to retrive value for
+     * @param value output parameter to reference value by
+     */
+    virtual bool GetPinned(const std::string &key, PinnedValue &value) const {
+        std::shared_ptr<std::string> copy = std::make_shared<std::string>();
+        if (!Get(key, *copy)) {
+            return false;
+        }
+        value = PinnedValue(std::shared_ptr<const std::string>(copy));
+        return true;
+    }
+
+    /**
+     * Retrive value for the given key along with its current version, otherwise works like
+     * GetPinned
+     *
+     * @param key to retrive value for
+     * @param value output parameter to reference value by
+     * @param version output parameter to store version to
+     */
+    virtual bool GetVersioned(const std::string &key, PinnedValue &value, uint64_t &version) const = 0;
+
+    /**
+     * Releases memory of associations expired by the given time. Called periodically by the
+     * application, each call performs bounded amount of work, so expired associations might
+     * be collected by several subsequent calls
+     *
+     * @param now current unix time
+     */
+    virtual void ReapExpired(time_t now) {}
+
+    /**
+     * Appends backend statistics to the output, one "name value" pair per line, to be reported
+     * by stats command. Default implementation has nothing to report
+     *
+     * @param out output parameter to append statistics to
+     */
+    virtual void Stats(std::string &out) const {}
 };
 
 } // namespace Afina
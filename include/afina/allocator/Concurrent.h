@@ -0,0 +1,85 @@
+#ifndef AFINA_ALLOCATOR_CONCURRENT_H
+#define AFINA_ALLOCATOR_CONCURRENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Afina {
+namespace Allocator {
+
+// Forward declaration. Do not include real class definition
+// to avoid expensive macros calculations and increase compile speed
+class Pointer;
+
+/**
+ * # Thread safe front-end of Simple
+ * Wraps given memory area with Simple allocator shared by all threads. Small blocks are served
+ * from per-thread magazines: every thread keeps a few free blocks of each size class, and refills
+ * or drains half of the magazine in a single batch under the arena lock. So the common alloc/free
+ * path touches only memory of the calling thread, lock is taken once per many operations. Large
+ * blocks go directly to the arena under the lock.
+ *
+ * Blocks cached by a thread are unavailable to others, so allocation might fail while there are
+ * free blocks in magazines of other threads. Magazines of exited thread are drained back into the
+ * arena.
+ *
+ * Like Simple, instance doesn't take ownership of wrapped memory
+ */
+class Concurrent {
+public:
+    Concurrent(void *base, size_t size);
+    ~Concurrent();
+
+    /**
+     * Allocates block of at least N bytes, aligned for any type
+     *
+     * @param N size_t
+     * @throw AllocError of NoMemory type if there is no free block that large
+     */
+    Pointer alloc(size_t N);
+
+    /**
+     * Releases block and resets the pointer. Releasing empty pointer does nothing. Block could be
+     * released by any thread, not only by the one allocated it
+     *
+     * Small blocks are put into magazine without any checks, so p must reference block allocated
+     * by this instance
+     *
+     * @param p Pointer
+     * @param N size_t size block has been allocated with
+     * @throw AllocError of InvalidFree type if large p doesn't reference allocated block
+     */
+    void free(Pointer &p, size_t N);
+
+    /**
+     * Returns blocks cached by the calling thread back to the arena
+     */
+    void flush();
+
+    /**
+     * Same as Simple::defrag(budget). Blocks get moved, so it must be called only while no other
+     * thread accesses allocated memory
+     */
+    bool defrag(size_t budget);
+
+private:
+    struct State;
+    struct Cache;
+    struct Bindings;
+
+    /**
+     * Returns magazines of the calling thread, creating them on the first call
+     */
+    Cache &Local();
+
+    std::shared_ptr<State> _state;
+
+    // Magazines of the current thread for every allocator it has used
+    static thread_local Bindings _bindings;
+};
+
+} // namespace Allocator
+} // namespace Afina
+
+#endif // AFINA_ALLOCATOR_CONCURRENT_H
@@ -0,0 +1,64 @@
+#ifndef AFINA_ALLOCATOR_MAPPED_REGION_H
+#define AFINA_ALLOCATOR_MAPPED_REGION_H
+
+#include <cstddef>
+
+namespace Afina {
+namespace Allocator {
+
+/**
+ * How region should be backed by huge pages
+ */
+enum class HugePages {
+    // Regular pages only
+    None,
+
+    // Region is aligned on huge page boundary and advised with MADV_HUGEPAGE, kernel backs it by
+    // transparent huge pages whenever it can
+    Transparent,
+
+    // Region is taken from hugetlbfs pool with MAP_HUGETLB, pool must be reserved in advance,
+    // see /proc/sys/vm/nr_hugepages
+    Explicit
+};
+
+/**
+ * # Anonymous memory mapping to run allocator on
+ * Maps memory for the cache arena directly from the kernel. On a multi-GB cache huge pages cut
+ * TLB misses, pre-faulting moves page fault stalls from the first writes to the startup.
+ *
+ * Size of the region could be rounded up to the page size, see size(). Region is unmapped on
+ * destruction, so it must outlive allocator using it
+ */
+class MappedRegion {
+public:
+    /**
+     * Maps region of at least given size
+     *
+     * @param huge_pages how region should be backed by huge pages
+     * @param populate fault all pages in right away rather than on the first access
+     * @throw std::runtime_error if region couldn't be mapped
+     */
+    MappedRegion(size_t size, HugePages huge_pages = HugePages::None, bool populate = false);
+    ~MappedRegion();
+
+    MappedRegion(const MappedRegion &) = delete;
+    MappedRegion &operator=(const MappedRegion &) = delete;
+
+    void *data() const { return _data; }
+    size_t size() const { return _size; }
+
+    /**
+     * Size of the huge page used for the alignment and rounding
+     */
+    static const size_t HugePageSize = 2 * 1024 * 1024;
+
+private:
+    void *_data;
+    size_t _size;
+};
+
+} // namespace Allocator
+} // namespace Afina
+
+#endif // AFINA_ALLOCATOR_MAPPED_REGION_H
@@ -0,0 +1,123 @@
+#ifndef AFINA_ALLOCATOR_MEMORY_RESOURCE_H
+#define AFINA_ALLOCATOR_MEMORY_RESOURCE_H
+
+#include <cstddef>
+#include <limits>
+#include <new>
+
+namespace Afina {
+namespace Allocator {
+
+// Forward declaration. Do not include real class definition
+// to avoid expensive macros calculations and increase compile speed
+class Simple;
+
+/**
+ * # Source of raw memory
+ * Mirrors C++17 std::pmr::memory_resource, so that code using it could switch to the standard
+ * one as soon as project moves on. Lets containers choose memory source at runtime, without
+ * changing their type
+ */
+class MemoryResource {
+public:
+    virtual ~MemoryResource() {}
+
+    /**
+     * Allocates bytes aligned by the given alignment
+     *
+     * @throw std::bad_alloc if there is no memory or alignment isn't supported
+     */
+    void *allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+        return do_allocate(bytes, alignment);
+    }
+
+    /**
+     * Releases memory, size and alignment must be the same as given to allocate
+     */
+    void deallocate(void *p, size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+        do_deallocate(p, bytes, alignment);
+    }
+
+    /**
+     * Returns true if memory allocated by one resource could be released by another
+     */
+    bool is_equal(const MemoryResource &other) const noexcept { return do_is_equal(other); }
+
+    /**
+     * Resource using global operator new and delete
+     */
+    static MemoryResource *NewDelete();
+
+protected:
+    virtual void *do_allocate(size_t bytes, size_t alignment) = 0;
+    virtual void do_deallocate(void *p, size_t bytes, size_t alignment) = 0;
+    virtual bool do_is_equal(const MemoryResource &other) const noexcept = 0;
+};
+
+inline bool operator==(const MemoryResource &a, const MemoryResource &b) { return &a == &b || a.is_equal(b); }
+inline bool operator!=(const MemoryResource &a, const MemoryResource &b) { return !(a == b); }
+
+/**
+ * # Resource taking memory from Simple arena
+ * Blocks are allocated pinned, so defragmentation of the arena doesn't affect them. Resource
+ * doesn't own allocator and is not thread safe, same as allocator itself
+ */
+class SimpleResource : public MemoryResource {
+public:
+    explicit SimpleResource(Simple &allocator) : _allocator(allocator) {}
+
+protected:
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const MemoryResource &other) const noexcept override;
+
+private:
+    Simple &_allocator;
+};
+
+/**
+ * # STL allocator over MemoryResource
+ * Analog of std::pmr::polymorphic_allocator: containers of the same type could take memory from
+ * different resources. Default constructed allocator uses NewDelete resource
+ */
+template <typename T> class PolymorphicAllocator {
+public:
+    typedef T value_type;
+
+    PolymorphicAllocator() : _resource(MemoryResource::NewDelete()) {}
+    PolymorphicAllocator(MemoryResource *resource) : _resource(resource) {}
+
+    template <typename U> PolymorphicAllocator(const PolymorphicAllocator<U> &other) : _resource(other.resource()) {}
+
+    T *allocate(size_t n) {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T *>(_resource->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *p, size_t n) { _resource->deallocate(p, n * sizeof(T), alignof(T)); }
+
+    // Containers copied keep default resource rather than share the original one
+    PolymorphicAllocator select_on_container_copy_construction() const { return PolymorphicAllocator(); }
+
+    MemoryResource *resource() const { return _resource; }
+
+private:
+    MemoryResource *_resource;
+};
+
+template <typename T, typename U>
+bool operator==(const PolymorphicAllocator<T> &a, const PolymorphicAllocator<U> &b) {
+    return *a.resource() == *b.resource();
+}
+
+template <typename T, typename U>
+bool operator!=(const PolymorphicAllocator<T> &a, const PolymorphicAllocator<U> &b) {
+    return !(a == b);
+}
+
+} // namespace Allocator
+} // namespace Afina
+
+#endif // AFINA_ALLOCATOR_MEMORY_RESOURCE_H
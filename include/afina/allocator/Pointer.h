@@ -7,6 +7,15 @@ namespace Allocator {
 // to avoid expensive macros calculations and increase compile speed
 class Simple;
 
+/**
+ * # Reference to memory allocated by Simple
+ * Pointer is a handle: it references a slot of the allocator handle table, which holds current
+ * address of the block, so that the block could be moved by defragmentation. Address returned by
+ * get() stays valid until the next defrag or realloc call only.
+ *
+ * Default constructed pointer references nothing and get() returns nullptr. Copies reference the
+ * same block, which stays valid until freed through any of them
+ */
 class Pointer {
 public:
     Pointer();
@@ -17,7 +26,14 @@ public:
     Pointer &operator=(const Pointer &);
     Pointer &operator=(Pointer &&);
 
-    void *get() const { return 0; }
+    void *get() const { return _slot != nullptr ? *_slot : nullptr; }
+
+private:
+    friend class Simple;
+
+    explicit Pointer(void **slot) : _slot(slot) {}
+
+    void **_slot;
 };
 
 } // namespace Allocator
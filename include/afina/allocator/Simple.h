@@ -1,8 +1,9 @@
 #ifndef AFINA_ALLOCATOR_SIMPLE_H
 #define AFINA_ALLOCATOR_SIMPLE_H
 
-#include <string>
 #include <cstddef>
+#include <cstdint>
+#include <string>
 
 namespace Afina {
 namespace Allocator {
@@ -18,44 +19,198 @@ class Pointer;
  * Allocator instance doesn't take ownership of wrapped memmory and do not delete it
  * on destruction. So caller must take care of resource cleaup after allocator stop
  * being needs
+ *
+ * Memory is managed by segregated fit scheme: free blocks are kept in lists by size class, each
+ * power of two range is split into 8 classes. Two level bitmap of non empty lists allows to find
+ * a fitting block and to put it back in O(1), no matter how many blocks are there. Every block
+ * starts with a header holding its size and the size of the free predecessor, so that neighbour
+ * free blocks are merged on free and realloc could grow block in place. Free lists heads are
+ * kept at the beginning of the wrapped area.
+ *
+ * Pointer references a slot of the handle table rather than the block itself, so allocated blocks
+ * could be moved by defrag(). Handle table grows by chunks allocated from the arena, chunks are
+ * never moved nor released and are taken from the top of the heap whenever possible, so that they
+ * don't stand in the way of compaction.
+ *
+ * Instance is not thread safe. C++ allocator interfaces on top of it are in StlAllocator.h and
+ * MemoryResource.h
  */
-// TODO: Implements interface to allow usage as C++ allocators
 class Simple {
 public:
     Simple(void *base, const size_t size);
 
     /**
-     * TODO: semantics
+     * Allocates block of at least N bytes, aligned for any type
+     *
      * @param N size_t
+     * @throw AllocError of NoMemory type if there is no free block that large
      */
     Pointer alloc(size_t N);
 
     /**
-     * TODO: semantics
+     * Changes size of the block to be at least N bytes, preserving its content up to the lesser
+     * of the old and new sizes. Block is resized in place whenever possible, otherwise its data
+     * is moved to a new place and the old block is released. Empty pointer gets a new block
+     *
      * @param p Pointer
      * @param N size_t
+     * @throw AllocError of NoMemory type if there is not enough memory, p stays untouched then
      */
     void realloc(Pointer &p, size_t N);
 
     /**
-     * TODO: semantics
+     * Releases block and resets the pointer. Releasing empty pointer does nothing
+     *
      * @param p Pointer
+     * @throw AllocError of InvalidFree type if p doesn't reference allocated block
      */
     void free(Pointer &p);
 
     /**
-     * TODO: semantics
+     * Allocates block of at least N bytes which is never moved by defragmentation, so it could be
+     * referenced by raw address. Such blocks have no handle and stay in place while compaction
+     * slides other blocks around them, so they should be used for long living data only
+     *
+     * @param N size_t
+     * @throw AllocError of NoMemory type if there is no free block that large
+     */
+    void *alloc_pinned(size_t N);
+
+    /**
+     * Releases block allocated by alloc_pinned. Releasing nullptr does nothing
+     *
+     * @param ptr void*
+     * @throw AllocError of InvalidFree type if ptr doesn't reference pinned block
+     */
+    void free_pinned(void *ptr);
+
+    /**
+     * Slides all allocated blocks towards the beginning of the arena, so that free memory forms
+     * a single block at its end. Pointers are updated, addresses obtained from them before the
+     * call are no longer valid
      */
     void defrag();
 
     /**
-     * TODO: semantics
+     * Incremental version of defrag(): continues compaction from where the previous call stopped,
+     * doing about budget bytes worth of work (every moved byte and every visited block counts).
+     * Allocations and releases between calls are allowed
+     *
+     * @param budget size_t
+     * @return true if compaction reached the end of the arena, next call starts from its beginning
+     */
+    bool defrag(size_t budget);
+
+    /**
+     * Returns allocator statistics, one "name value" pair per line:
+     * - bytes: size of the heap, without allocator own structures
+     * - used_bytes, used_blocks: blocks allocated by alloc, including their headers
+     * - pinned_bytes, pinned_blocks: blocks allocated by alloc_pinned
+     * - handle_table_bytes, handles_free: memory taken by handle table and its unused slots
+     * - free_bytes, free_blocks, largest_free: free memory and its biggest contiguous piece
+     * - fragmentation: share of free memory unusable for allocation of largest_free size, 0..1
+     * - defrag_moves, defrag_moved_bytes: work done by compaction since creation
+     * - class_<size>_used, class_<size>_free: number of blocks in size class starting at <size>,
+     *   reported only for non empty classes
+     *
+     * Walks the whole heap, so it takes time proportional to the number of blocks
      */
     std::string dump() const;
 
 private:
+    struct Block;
+
+    /**
+     * Free lists manipulation, block size defines the list
+     */
+    void Insert(Block *block);
+    void Remove(Block *block);
+
+    /**
+     * Returns free block of at least given size or nullptr, block stays in its list
+     */
+    Block *FindFree(size_t size) const;
+
+    /**
+     * Takes allocated block of the given size out of free memory, returns nullptr if there is
+     * no space. Block handle is not set
+     */
+    Block *Carve(size_t size);
+
+    /**
+     * Same as Carve, but takes block from the tail of the free block right below the pinned
+     * chunks at the top of the heap, returns nullptr if there is no such block or it is too small.
+     * Block taken extends the pinned chunks run, caller must pin it
+     */
+    Block *CarveTop(size_t size);
+
+    /**
+     * Cuts tail of the allocated block so that it is size bytes long, the tail gets released
+     */
+    void Split(Block *block, size_t size);
+
+    /**
+     * Marks block as free, merges it with free neighbours and puts into free list
+     */
+    void Release(Block *block);
+
+    /**
+     * Appends next block to the given one, next must be already out of free lists
+     */
+    void Join(Block *block, Block *next);
+
+    /**
+     * Moves allocated block next into the free block preceding it and updates its handle. Returns
+     * free block following the moved one, after merge with its free neighbour
+     */
+    Block *Slide(Block *block, Block *next);
+
+    /**
+     * Adds chunk of free slots to the handle table
+     *
+     * @throw AllocError of NoMemory type if there is no space for it
+     */
+    void GrowHandles();
+
+    /**
+     * Returns allocated block with given payload, slot is the block handle or nullptr for pinned
+     * blocks
+     *
+     * @throw AllocError of InvalidFree type if there is no such block
+     */
+    Block *BlockOf(void *ptr, void **slot) const;
+
     void *_base;
     const size_t _base_len;
+
+    // Non empty free lists: bit of the first level is set if any list of that power of two range
+    // is non empty, second level has a bit per list
+    uint64_t _fl_bitmap;
+    uint32_t *_sl_bitmap;
+    unsigned _fl_count;
+
+    // Free lists heads, 8 per each first level
+    Block **_heads;
+
+    // First block of the heap and the zero sized sentinel after the last one
+    Block *_first;
+    Block *_last;
+
+    // Free slots of the handle table, each one holds the next free slot tagged with the low bit
+    void **_free_handles;
+
+    // Number of slots in the next chunk of the handle table
+    size_t _handles_chunk;
+
+    // Lowest block of the pinned chunks run at the top of the heap, sentinel if there is none
+    Block *_pinned;
+
+    // Block where incremental defrag continues from
+    Block *_defrag_cursor;
+
+    // Compaction statistics
+    size_t _defrag_moves;
+    size_t _defrag_moved_bytes;
 };
 
 } // namespace Allocator
@@ -0,0 +1,66 @@
+#ifndef AFINA_ALLOCATOR_STL_ALLOCATOR_H
+#define AFINA_ALLOCATOR_STL_ALLOCATOR_H
+
+#include <cstddef>
+#include <limits>
+#include <new>
+
+#include <afina/allocator/Error.h>
+#include <afina/allocator/Simple.h>
+
+namespace Afina {
+namespace Allocator {
+
+/**
+ * # STL allocator taking memory from Simple arena
+ * Allows standard containers to live inside of the arena, e.g
+ * std::vector<int, StlAllocator<int>> v(StlAllocator<int>(simple))
+ *
+ * Memory is allocated pinned, so defragmentation doesn't move container data. Allocator type is
+ * bound to Simple at compile time, see PolymorphicAllocator for runtime choice of memory source.
+ * Not thread safe, same as Simple itself
+ */
+template <typename T> class StlAllocator {
+public:
+    typedef T value_type;
+
+    explicit StlAllocator(Simple &allocator) : _allocator(&allocator) {}
+
+    template <typename U> StlAllocator(const StlAllocator<U> &other) : _allocator(other.allocator()) {}
+
+    /**
+     * @throw std::bad_alloc if there is no room in the arena
+     */
+    T *allocate(size_t n) {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned types are not supported");
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+
+        try {
+            return static_cast<T *>(_allocator->alloc_pinned(n * sizeof(T)));
+        } catch (AllocError &) {
+            throw std::bad_alloc();
+        }
+    }
+
+    void deallocate(T *p, size_t) { _allocator->free_pinned(p); }
+
+    Simple *allocator() const { return _allocator; }
+
+private:
+    Simple *_allocator;
+};
+
+template <typename T, typename U> bool operator==(const StlAllocator<T> &a, const StlAllocator<U> &b) {
+    return a.allocator() == b.allocator();
+}
+
+template <typename T, typename U> bool operator!=(const StlAllocator<T> &a, const StlAllocator<U> &b) {
+    return !(a == b);
+}
+
+} // namespace Allocator
+} // namespace Afina
+
+#endif // AFINA_ALLOCATOR_STL_ALLOCATOR_H
@@ -0,0 +1,39 @@
+#ifndef AFINA_EXECUTE_CAS_H
+#define AFINA_EXECUTE_CAS_H
+
+#include <cstdint>
+#include <string>
+
+#include "InsertCommand.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Check and set
+ * Store data for the key, but only if nobody else has updated it since client
+ * last fetched it by "gets" command
+ *
+ * Command must write result to the output, which could be:
+ * - "STORED", to indicate success.
+ * - "EXISTS" to indicate that the item has been modified since client fetched it
+ * - "NOT_FOUND" to indicate that the item did not exist or has been deleted
+ */
+class Cas : public InsertCommand {
+public:
+    Cas(const std::string &key, uint32_t flags, int32_t expire, uint64_t version)
+        : InsertCommand(key, flags, expire), _version(version) {}
+    ~Cas() {}
+
+    inline const uint64_t version() const { return _version; }
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+private:
+    const uint64_t _version;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_CAS_H
@@ -2,13 +2,35 @@
 #define AFINA_EXECUTE_COMMAND_H
 
 #include <string>
+#include <utility>
+#include <vector>
 
-namespace Afina {
-
-class Storage;
+#include <afina/Storage.h>
 
+namespace Afina {
 namespace Execute {
 
+/**
+ * # Output of a command
+ * Text of the response with values of the storage referenced rather than copied into it. Each value
+ * goes into the text at the offset it is stored with, so network layer could write pieces of the text
+ * and the values one after another as they are
+ */
+struct Response {
+    std::string text;
+    std::vector<std::pair<size_t, PinnedValue>> values;
+
+    void clear() {
+        text.clear();
+        values.clear();
+    }
+
+    /**
+     * Copies the text with all the values put in place into out
+     */
+    void Flatten(std::string &out) const;
+};
+
 /**
  *
  *
@@ -19,6 +41,15 @@ public:
     virtual ~Command() {}
 
     virtual void Execute(Storage &storage, const std::string &args, std::string &out) = 0;
+
+    /**
+     * Same as above, but allowed to reference values of the storage in the response. Commands which
+     * don't return values just write the text
+     */
+    virtual void Execute(Storage &storage, const std::string &args, Response &out) {
+        out.values.clear();
+        Execute(storage, args, out.text);
+    }
 };
 
 } // namespace Execute
@@ -0,0 +1,105 @@
+#ifndef AFINA_EXECUTE_COMMAND_SLOT_H
+#define AFINA_EXECUTE_COMMAND_SLOT_H
+
+#include <cstdint>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "Add.h"
+#include "Append.h"
+#include "Cas.h"
+#include "Command.h"
+#include "Get.h"
+#include "Prepend.h"
+#include "Replace.h"
+#include "Set.h"
+#include "Stats.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Place for a single command
+ * Holds any of the commands protocol could build, constructed in place. Slot is meant to be reused for
+ * command after command, so building one takes no heap allocation for the command itself and executing
+ * it is a switch over known types rather than a virtual call
+ */
+class CommandSlot {
+public:
+    CommandSlot() : _kind(Kind::kEmpty), _command(nullptr) {}
+    ~CommandSlot() { Reset(); }
+
+    CommandSlot(const CommandSlot &) = delete;
+    CommandSlot &operator=(const CommandSlot &) = delete;
+
+    /**
+     * Destroys current command if any and constructs new one from the given arguments
+     */
+    template <typename T, typename... Args> T &Emplace(Args &&... args) {
+        static_assert(sizeof(T) <= sizeof(_storage) && alignof(T) <= alignof(storage_type),
+                      "Command doesn't fit the slot");
+        Reset();
+        T *command = new (&_storage) T(std::forward<Args>(args)...);
+        _kind = KindOf(command);
+        _command = command;
+        return *command;
+    }
+
+    /**
+     * Returns current command if it has given type, nullptr otherwise
+     */
+    template <typename T> T *As() {
+        return _kind == KindOf(static_cast<T *>(nullptr)) ? static_cast<T *>(_command) : nullptr;
+    }
+
+    /**
+     * Returns current command, nullptr if slot is empty
+     */
+    Command *get() const { return _command; }
+
+    explicit operator bool() const { return _command != nullptr; }
+
+    /**
+     * Executes current command, see Command::Execute. Slot must not be empty
+     */
+    void Execute(Storage &storage, const std::string &args, std::string &out);
+
+    /**
+     * Executes current command referencing values of the storage in the response, see Command::Execute
+     */
+    void Execute(Storage &storage, const std::string &args, Response &out);
+
+    /**
+     * Destroys current command if any
+     */
+    void Reset();
+
+private:
+    enum class Kind : uint8_t { kEmpty, kSet, kAdd, kReplace, kAppend, kPrepend, kCas, kGet, kStats };
+
+    static Kind KindOf(const Set *) { return Kind::kSet; }
+    static Kind KindOf(const Add *) { return Kind::kAdd; }
+    static Kind KindOf(const Replace *) { return Kind::kReplace; }
+    static Kind KindOf(const Append *) { return Kind::kAppend; }
+    static Kind KindOf(const Prepend *) { return Kind::kPrepend; }
+    static Kind KindOf(const Cas *) { return Kind::kCas; }
+    static Kind KindOf(const Get *) { return Kind::kGet; }
+    static Kind KindOf(const Stats *) { return Kind::kStats; }
+
+    typedef std::aligned_union<0, Set, Add, Replace, Append, Prepend, Cas, Get, Stats>::type storage_type;
+
+    // Type of the current command
+    Kind _kind;
+
+    // Current command, points into _storage
+    Command *_command;
+
+    storage_type _storage;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_COMMAND_SLOT_H
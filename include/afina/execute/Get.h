@@ -1,6 +1,7 @@
 #ifndef AFINA_EXECUTE_GET_H
 #define AFINA_EXECUTE_GET_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -31,18 +32,42 @@ namespace Execute {
  * hold items with such keys (because they were never stored, or stored
  * but deleted to make space for more items, or expired, or explicitly
  * deleted by a client).
+ *
+ * Command "gets" additionally returns version of each value, which could be
+ * passed to "cas" later:
+ * VALUE <key> <bytes> <cas unique>\r\n
  */
 class Get : public Command {
 public:
-    Get(const std::vector<std::string> &keys) : _keys(keys) {}
+    /**
+     * Keys are borrowed rather than copied, both buffers must outlive the command and stay unchanged
+     *
+     * @param keys bytes of all the keys separated by single space
+     * @param ends offset just past the end of each key in keys
+     */
+    Get(const std::string &keys, const std::vector<uint32_t> &ends, bool versions = false)
+        : _keys(keys), _ends(ends), _versions(versions) {}
     ~Get() {}
 
-    inline const std::vector<std::string> &keys() const { return _keys; }
+    /**
+     * Returns copy of the keys, one string per key. Meant for inspection, Execute doesn't need it
+     */
+    std::vector<std::string> keys() const;
+    inline bool versions() const { return _versions; }
 
     void Execute(Storage &storage, const std::string &args, std::string &out) override;
 
+    /**
+     * Builds the response referencing found values in place
+     */
+    void Execute(Storage &storage, const std::string &args, Response &out) override;
+
 private:
-    std::vector<std::string> _keys;
+    // All keys are kept in a single string owned along with the command slot, by network connection or task,
+    // so multiget allocates nothing for its keys
+    const std::string &_keys;
+    const std::vector<uint32_t> &_ends;
+    bool _versions;
 };
 
 } // namespace Execute
@@ -2,6 +2,7 @@
 #define AFINA_EXECUTE_INSERT_COMMAND_H
 
 #include <cstdint>
+#include <ctime>
 #include <string>
 
 #include "Command.h"
@@ -22,7 +23,25 @@ public:
     inline const uint32_t flags() const { return _flags; }
     inline const int32_t expire() const { return _expire; }
 
+    /**
+     * Converts expire field into absolute unix time as Storage expects it. Following memcached,
+     * 0 means never, negative value means already expired, values up to 30 days are offsets from
+     * now and larger ones are absolute unix time
+     */
+    inline time_t deadline() const {
+        if (_expire == 0) {
+            return 0;
+        } else if (_expire < 0) {
+            return 1;
+        } else if (_expire <= MaxRelativeExpire) {
+            return time(nullptr) + _expire;
+        }
+        return _expire;
+    }
+
 protected:
+    static const int32_t MaxRelativeExpire = 60 * 60 * 24 * 30;
+
     const std::string _key;
     const uint32_t _flags;
     const int32_t _expire;
@@ -2,6 +2,7 @@
 #define AFINA_EXECUTE_SET_H
 
 #include <cstdint>
+#include <memory>
 #include <string>
 
 #include "InsertCommand.h"
@@ -18,6 +19,9 @@ namespace Execute {
  * - "STORED", to indicate success.
  * - "NOT_STORED" to indicate the data was not stored, but not because of an
  * error. This normally means that the condition for the command wasn't met.
+ *
+ * Large data block could be collected right into the value reserved by Reserve, in that case Execute
+ * ignores args and stores reserved value as is
  */
 class Set : public InsertCommand {
 public:
@@ -25,6 +29,21 @@ public:
     ~Set() {}
 
     void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+    /**
+     * Reserves room for the value of the given size in the storage. Value starts empty and is filled
+     * by Append before Execute is called
+     */
+    void Reserve(Storage &storage, size_t size);
+
+    /**
+     * Appends bytes to the reserved value. Room is reserved up front, so that never reallocates
+     */
+    void Append(const char *data, size_t size) { _value->append(data, size); }
+
+private:
+    // Value reserved for the data block, if any
+    std::shared_ptr<std::string> _value;
 };
 
 } // namespace Execute
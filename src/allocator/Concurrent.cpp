@@ -0,0 +1,202 @@
+#include <afina/allocator/Concurrent.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <afina/allocator/Error.h>
+#include <afina/allocator/Pointer.h>
+#include <afina/allocator/Simple.h>
+
+namespace Afina {
+namespace Allocator {
+
+// Blocks up to MaxCached bytes are kept in magazines, size classes are ClassStep bytes apart
+static const size_t ClassStep = 16;
+static const size_t MaxCached = 1024;
+static const size_t ClassCount = MaxCached / ClassStep;
+
+// Blocks per magazine, half of it is moved from or to the arena at once
+static const size_t MagazineSize = 32;
+static const size_t BatchSize = MagazineSize / 2;
+
+static inline size_t SizeClass(size_t N) { return N == 0 ? 0 : (N - 1) / ClassStep; }
+
+/**
+ * Free blocks cached by a single thread
+ */
+struct Concurrent::Cache {
+    struct Magazine {
+        Pointer blocks[MagazineSize];
+        size_t count;
+
+        Magazine() : count(0) {}
+    };
+
+    Magazine classes[ClassCount];
+};
+
+/**
+ * Part shared by all threads, outlives allocator while any thread has magazines bound to it
+ */
+struct Concurrent::State {
+    State(void *base, size_t size) : id(++last_id), arena(base, size) {}
+
+    /**
+     * Moves count blocks from the magazine to the arena. Must be called under the lock
+     */
+    void Drain(Cache::Magazine &magazine, size_t count) {
+        for (; count > 0 && magazine.count > 0; count--) {
+            arena.free(magazine.blocks[--magazine.count]);
+        }
+    }
+
+    /**
+     * Drains magazines of exited thread and keeps them for reuse
+     */
+    void Release(Cache *cache) {
+        std::unique_lock<std::mutex> guard(lock);
+        for (Cache::Magazine &magazine : cache->classes) {
+            Drain(magazine, MagazineSize);
+        }
+        idle.push_back(cache);
+    }
+
+    // Unique allocator id, addresses of dead allocators could be reused
+    const uint64_t id;
+    static std::atomic<uint64_t> last_id;
+
+    std::mutex lock;
+    Simple arena;
+
+    // All magazines ever created, those not bound to any thread are idle
+    std::vector<std::unique_ptr<Cache>> caches;
+    std::vector<Cache *> idle;
+};
+
+std::atomic<uint64_t> Concurrent::State::last_id(0);
+
+/**
+ * Magazines bound to the thread, returned to their allocators on thread exit
+ */
+struct Concurrent::Bindings {
+    struct Binding {
+        uint64_t id;
+        std::weak_ptr<State> state;
+        Cache *cache;
+    };
+
+    ~Bindings() {
+        for (Binding &binding : list) {
+            std::shared_ptr<State> state = binding.state.lock();
+            if (state) {
+                state->Release(binding.cache);
+            }
+        }
+    }
+
+    std::vector<Binding> list;
+};
+
+thread_local Concurrent::Bindings Concurrent::_bindings;
+
+// See Concurrent.h
+Concurrent::Concurrent(void *base, size_t size) : _state(std::make_shared<State>(base, size)) {}
+
+// See Concurrent.h
+Concurrent::~Concurrent() {}
+
+// See Concurrent.h
+Pointer Concurrent::alloc(size_t N) {
+    if (N > MaxCached) {
+        std::unique_lock<std::mutex> guard(_state->lock);
+        return _state->arena.alloc(N);
+    }
+
+    size_t cls = SizeClass(N);
+    Cache::Magazine &magazine = Local().classes[cls];
+    if (magazine.count == 0) {
+        std::unique_lock<std::mutex> guard(_state->lock);
+        try {
+            while (magazine.count < BatchSize) {
+                magazine.blocks[magazine.count] = _state->arena.alloc((cls + 1) * ClassStep);
+                magazine.count++;
+            }
+        } catch (AllocError &) {
+            // Partial batch is fine, fail only if there is nothing at all
+            if (magazine.count == 0) {
+                throw;
+            }
+        }
+    }
+
+    return std::move(magazine.blocks[--magazine.count]);
+}
+
+// See Concurrent.h
+void Concurrent::free(Pointer &p, size_t N) {
+    if (p.get() == nullptr) {
+        return;
+    } else if (N > MaxCached) {
+        std::unique_lock<std::mutex> guard(_state->lock);
+        _state->arena.free(p);
+        return;
+    }
+
+    Cache::Magazine &magazine = Local().classes[SizeClass(N)];
+    if (magazine.count == MagazineSize) {
+        std::unique_lock<std::mutex> guard(_state->lock);
+        _state->Drain(magazine, BatchSize);
+    }
+    magazine.blocks[magazine.count++] = std::move(p);
+}
+
+// See Concurrent.h
+void Concurrent::flush() {
+    Cache &cache = Local();
+    std::unique_lock<std::mutex> guard(_state->lock);
+    for (Cache::Magazine &magazine : cache.classes) {
+        _state->Drain(magazine, MagazineSize);
+    }
+}
+
+// See Concurrent.h
+bool Concurrent::defrag(size_t budget) {
+    std::unique_lock<std::mutex> guard(_state->lock);
+    return _state->arena.defrag(budget);
+}
+
+// See Concurrent.h
+Concurrent::Cache &Concurrent::Local() {
+    // Threads rarely use more than one allocator, so the search is short
+    std::vector<Bindings::Binding> &list = _bindings.list;
+    for (Bindings::Binding &binding : list) {
+        if (binding.id == _state->id) {
+            return *binding.cache;
+        }
+    }
+
+    // Forget magazines of destroyed allocators, they are gone along with allocator state
+    list.erase(std::remove_if(list.begin(), list.end(),
+                              [](const Bindings::Binding &binding) { return binding.state.expired(); }),
+               list.end());
+
+    Cache *cache;
+    {
+        std::unique_lock<std::mutex> guard(_state->lock);
+        if (!_state->idle.empty()) {
+            cache = _state->idle.back();
+            _state->idle.pop_back();
+        } else {
+            _state->caches.emplace_back(new Cache());
+            cache = _state->caches.back().get();
+        }
+    }
+
+    list.push_back({_state->id, _state, cache});
+    return *cache;
+}
+
+} // namespace Allocator
+} // namespace Afina
@@ -0,0 +1,100 @@
+#include <afina/allocator/MappedRegion.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace Afina {
+namespace Allocator {
+
+static size_t RoundUp(size_t size, size_t alignment) { return (size + alignment - 1) / alignment * alignment; }
+
+static std::runtime_error MapError(const char *what) {
+    return std::runtime_error(std::string(what) + ": " + std::strerror(errno));
+}
+
+// See MappedRegion.h
+const size_t MappedRegion::HugePageSize;
+
+// See MappedRegion.h
+MappedRegion::MappedRegion(size_t size, HugePages huge_pages, bool populate) : _data(nullptr), _size(0) {
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+    if (huge_pages == HugePages::Explicit) {
+#ifdef MAP_HUGETLB
+        // Pages are reserved from the pool by mmap, so shortage fails here rather than on the first access
+        _size = RoundUp(size, HugePageSize);
+        if (populate) {
+            flags |= MAP_POPULATE;
+        }
+
+        _data = mmap(nullptr, _size, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+        if (_data == MAP_FAILED) {
+            _data = nullptr;
+            throw MapError("Failed to map arena with huge pages");
+        }
+        return;
+#else
+        throw std::runtime_error("Huge pages are not supported by the platform");
+#endif
+    }
+
+    if (huge_pages == HugePages::None) {
+        _size = RoundUp(size, page_size);
+        if (populate) {
+            flags |= MAP_POPULATE;
+        }
+
+        _data = mmap(nullptr, _size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (_data == MAP_FAILED) {
+            _data = nullptr;
+            throw MapError("Failed to map arena");
+        }
+        return;
+    }
+
+    // Transparent huge pages are only used for huge page aligned ranges, so map a bit more and
+    // trim head and tail. Pre-faulting is done after madvise, otherwise MAP_POPULATE would fill
+    // region with regular pages
+    _size = RoundUp(size, HugePageSize);
+    char *raw = static_cast<char *>(mmap(nullptr, _size + HugePageSize, PROT_READ | PROT_WRITE, flags, -1, 0));
+    if (raw == MAP_FAILED) {
+        throw MapError("Failed to map arena");
+    }
+
+    char *aligned = reinterpret_cast<char *>(RoundUp(reinterpret_cast<size_t>(raw), HugePageSize));
+    if (aligned > raw) {
+        munmap(raw, aligned - raw);
+    }
+    if (aligned + _size < raw + _size + HugePageSize) {
+        munmap(aligned + _size, raw + HugePageSize - aligned);
+    }
+    _data = aligned;
+
+#ifdef MADV_HUGEPAGE
+    // Only a hint, THP could be disabled system wide, region is still usable then
+    madvise(_data, _size, MADV_HUGEPAGE);
+#endif
+
+    if (populate) {
+        volatile char *p = static_cast<char *>(_data);
+        for (size_t offset = 0; offset < _size; offset += page_size) {
+            p[offset] = 0;
+        }
+    }
+}
+
+// See MappedRegion.h
+MappedRegion::~MappedRegion() {
+    if (_data != nullptr) {
+        munmap(_data, _size);
+    }
+}
+
+} // namespace Allocator
+} // namespace Afina
@@ -0,0 +1,57 @@
+#include <afina/allocator/MemoryResource.h>
+
+#include <afina/allocator/Error.h>
+#include <afina/allocator/Simple.h>
+
+namespace Afina {
+namespace Allocator {
+
+/**
+ * Global operator new and delete, all instances are interchangeable
+ */
+class NewDeleteResource : public MemoryResource {
+protected:
+    void *do_allocate(size_t bytes, size_t alignment) override {
+        if (alignment > alignof(std::max_align_t)) {
+            throw std::bad_alloc();
+        }
+        return ::operator new(bytes);
+    }
+
+    void do_deallocate(void *p, size_t, size_t) override { ::operator delete(p); }
+
+    bool do_is_equal(const MemoryResource &other) const noexcept override {
+        return dynamic_cast<const NewDeleteResource *>(&other) != nullptr;
+    }
+};
+
+// See MemoryResource.h
+MemoryResource *MemoryResource::NewDelete() {
+    static NewDeleteResource resource;
+    return &resource;
+}
+
+// See MemoryResource.h
+void *SimpleResource::do_allocate(size_t bytes, size_t alignment) {
+    if (alignment > alignof(std::max_align_t)) {
+        throw std::bad_alloc();
+    }
+
+    try {
+        return _allocator.alloc_pinned(bytes);
+    } catch (AllocError &) {
+        throw std::bad_alloc();
+    }
+}
+
+// See MemoryResource.h
+void SimpleResource::do_deallocate(void *p, size_t, size_t) { _allocator.free_pinned(p); }
+
+// See MemoryResource.h
+bool SimpleResource::do_is_equal(const MemoryResource &other) const noexcept {
+    const SimpleResource *resource = dynamic_cast<const SimpleResource *>(&other);
+    return resource != nullptr && &resource->_allocator == &_allocator;
+}
+
+} // namespace Allocator
+} // namespace Afina
@@ -1,40 +1,597 @@
 #include <afina/allocator/Simple.h>
 
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+#include <afina/allocator/Error.h>
 #include <afina/allocator/Pointer.h>
 
 namespace Afina {
 namespace Allocator {
 
-Simple::Simple(void *base, size_t size) : _base(base), _base_len(size) {}
+// All blocks and their payloads are aligned to that many bytes
+static const size_t Align = 16;
 
-/**
- * TODO: semantics
- * @param N size_t
- */
-Pointer Simple::alloc(size_t N) { return Pointer(); }
+// Number of second level lists per power of two range is 1 << SLLog2
+static const unsigned SLLog2 = 3;
+static const unsigned SLCount = 1 << SLLog2;
 
-/**
- * TODO: semantics
- * @param p Pointer
- * @param N size_t
- */
-void Simple::realloc(Pointer &p, size_t N) {}
+// Blocks smaller than SmallSize share the first level, their classes are Align bytes apart
+static const unsigned FLShift = SLLog2 + 4;
+static const size_t SmallSize = size_t(1) << FLShift;
 
-/**
- * TODO: semantics
- * @param p Pointer
- */
-void Simple::free(Pointer &p) {}
+// Block flags are kept in low bits of its size
+static const size_t FreeFlag = 1;
+static const size_t PrevFreeFlag = 2;
+static const size_t PinnedFlag = 4;
+static const size_t FlagMask = FreeFlag | PrevFreeFlag | PinnedFlag;
 
-/**
- * TODO: semantics
- */
-void Simple::defrag() {}
+// Size of the block part preceding payload
+static const size_t HeaderSize = 2 * sizeof(size_t);
+
+// Free block must have room for free list links
+static const size_t MinBlockSize = HeaderSize + 2 * sizeof(void *);
+
+static_assert(HeaderSize % Align == 0, "Block header breaks payload alignment");
+static_assert(MinBlockSize % Align == 0, "Minimal block breaks alignment");
+static_assert(FlagMask < Align, "Block flags overlap its size");
+
+// Handle table growth limits, in slots
+static const size_t MinHandlesChunk = 64;
+static const size_t MaxHandlesChunk = 4096;
+
+// Free handle slots are tagged, so that they never look like a block address
+static inline void *TagFree(void **next) { return reinterpret_cast<void *>(reinterpret_cast<uintptr_t>(next) | 1); }
+static inline void **UntagFree(void *slot) {
+    return reinterpret_cast<void **>(reinterpret_cast<uintptr_t>(slot) & ~uintptr_t(1));
+}
 
 /**
- * TODO: semantics
+ * Block header, payload follows it. Free list links are stored in the payload of free blocks
  */
-std::string Simple::dump() const { return ""; }
+struct Simple::Block {
+    // Size of the previous block if that one is free, otherwise the handle of the previous block
+    size_t prev_size;
+
+    // Size of this block including header, low bits hold flags
+    size_t size_flags;
+
+    // Neighbours in the free list, valid only if this block is free
+    Block *free_next;
+    Block *free_prev;
+
+    size_t size() const { return size_flags & ~FlagMask; }
+    bool IsFree() const { return (size_flags & FreeFlag) != 0; }
+    bool IsPrevFree() const { return (size_flags & PrevFreeFlag) != 0; }
+    bool IsPinned() const { return (size_flags & PinnedFlag) != 0; }
+
+    void Resize(size_t size) { size_flags = size | (size_flags & FlagMask); }
+
+    Block *next() { return reinterpret_cast<Block *>(reinterpret_cast<char *>(this) + size()); }
+    Block *prev() { return reinterpret_cast<Block *>(reinterpret_cast<char *>(this) - prev_size); }
+
+    void *payload() { return reinterpret_cast<char *>(this) + HeaderSize; }
+    static Block *Of(void *payload) {
+        return reinterpret_cast<Block *>(reinterpret_cast<char *>(payload) - HeaderSize);
+    }
+
+    // Handle of the allocated block is kept by the next one
+    void **owner() { return reinterpret_cast<void **>(next()->prev_size); }
+    void SetOwner(void **slot) { next()->prev_size = reinterpret_cast<size_t>(slot); }
+
+    // Flags of the block are mirrored by the next one
+    void MarkFree() {
+        size_flags |= FreeFlag;
+        next()->size_flags |= PrevFreeFlag;
+        next()->prev_size = size();
+    }
+    void MarkUsed() {
+        size_flags &= ~FreeFlag;
+        next()->size_flags &= ~PrevFreeFlag;
+    }
+};
+
+static inline char *AlignUp(char *p) {
+    return reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(p) + Align - 1) & ~(Align - 1));
+}
+
+static inline unsigned Msb(size_t size) { return 63 - __builtin_clzll(size); }
+
+// Finds list for the block of the given size
+static inline void Mapping(size_t size, unsigned &fl, unsigned &sl) {
+    if (size < SmallSize) {
+        fl = 0;
+        sl = size / (SmallSize / SLCount);
+    } else {
+        unsigned msb = Msb(size);
+        fl = msb - FLShift + 1;
+        sl = (size >> (msb - SLLog2)) ^ SLCount;
+    }
+}
+
+// Smallest size of blocks kept in the same list as the block of given size
+static inline size_t ClassSize(size_t size) {
+    if (size < SmallSize) {
+        return size & ~(SmallSize / SLCount - 1);
+    }
+    unsigned shift = Msb(size) - SLLog2;
+    return (size >> shift) << shift;
+}
+
+// Size of the block able to hold N bytes
+static inline size_t BlockSize(size_t N) {
+    size_t size = (N + HeaderSize + Align - 1) & ~(Align - 1);
+    return size < MinBlockSize ? MinBlockSize : size;
+}
+
+// See Simple.h
+Simple::Simple(void *base, size_t size)
+    : _base(base), _base_len(size), _fl_bitmap(0), _free_handles(nullptr), _handles_chunk(MinHandlesChunk),
+      _defrag_moves(0), _defrag_moved_bytes(0) {
+    char *begin = AlignUp(static_cast<char *>(base));
+    char *end = AlignUp(static_cast<char *>(base) + size);
+    if (end != static_cast<char *>(base) + size) {
+        end -= Align;
+    }
+    if (end < begin + MinBlockSize) {
+        throw AllocError(AllocErrorType::NoMemory, "Arena is too small");
+    }
+
+    unsigned fl, sl;
+    Mapping(end - begin, fl, sl);
+    _fl_count = fl + 1;
+
+    _sl_bitmap = reinterpret_cast<uint32_t *>(begin);
+    begin = AlignUp(begin + _fl_count * sizeof(uint32_t));
+    _heads = reinterpret_cast<Block **>(begin);
+    begin = AlignUp(begin + _fl_count * SLCount * sizeof(Block *));
+    if (end < begin + MinBlockSize + HeaderSize) {
+        throw AllocError(AllocErrorType::NoMemory, "Arena is too small");
+    }
+
+    std::memset(_sl_bitmap, 0, _fl_count * sizeof(uint32_t));
+    std::memset(_heads, 0, _fl_count * SLCount * sizeof(Block *));
+
+    // Sentinel never gets allocated or merged, so that every real block has next one
+    _first = reinterpret_cast<Block *>(begin);
+    _last = reinterpret_cast<Block *>(end - HeaderSize);
+    _first->prev_size = 0;
+    _first->size_flags = reinterpret_cast<char *>(_last) - begin;
+    _last->size_flags = 0;
+    _first->MarkFree();
+    Insert(_first);
+    _pinned = _last;
+    _defrag_cursor = _first;
+}
+
+// See Simple.h
+Pointer Simple::alloc(size_t N) {
+    if (N >= _base_len) {
+        throw AllocError(AllocErrorType::NoMemory, "Requested block is larger than arena");
+    }
+
+    if (_free_handles == nullptr) {
+        GrowHandles();
+    }
+
+    Block *block = Carve(BlockSize(N));
+    if (block == nullptr) {
+        throw AllocError(AllocErrorType::NoMemory, "No free block of requested size");
+    }
+
+    void **slot = _free_handles;
+    _free_handles = UntagFree(*slot);
+    *slot = block->payload();
+    block->SetOwner(slot);
+    return Pointer(slot);
+}
+
+// See Simple.h
+void Simple::realloc(Pointer &p, size_t N) {
+    if (p._slot == nullptr) {
+        p = alloc(N);
+        return;
+    }
+
+    Block *block = BlockOf(*p._slot, p._slot);
+    if (N >= _base_len) {
+        throw AllocError(AllocErrorType::NoMemory, "Requested block is larger than arena");
+    }
+
+    size_t size = BlockSize(N);
+    if (size <= block->size()) {
+        Split(block, size);
+        block->SetOwner(p._slot);
+        return;
+    }
+
+    // Try to take space from the free block following this one
+    Block *next = block->next();
+    if (next->IsFree() && block->size() + next->size() >= size) {
+        Remove(next);
+        Join(block, next);
+        block->MarkUsed();
+        Split(block, size);
+        block->SetOwner(p._slot);
+        return;
+    }
+
+    Block *moved = Carve(size);
+    if (moved == nullptr) {
+        throw AllocError(AllocErrorType::NoMemory, "No free block of requested size");
+    }
+
+    std::memcpy(moved->payload(), block->payload(), block->size() - HeaderSize);
+    Release(block);
+    *p._slot = moved->payload();
+    moved->SetOwner(p._slot);
+}
+
+// See Simple.h
+void Simple::free(Pointer &p) {
+    if (p._slot == nullptr) {
+        return;
+    }
+
+    Release(BlockOf(*p._slot, p._slot));
+    *p._slot = TagFree(_free_handles);
+    _free_handles = p._slot;
+    p._slot = nullptr;
+}
+
+// See Simple.h
+void *Simple::alloc_pinned(size_t N) {
+    if (N >= _base_len) {
+        throw AllocError(AllocErrorType::NoMemory, "Requested block is larger than arena");
+    }
+
+    Block *block = Carve(BlockSize(N));
+    if (block == nullptr) {
+        throw AllocError(AllocErrorType::NoMemory, "No free block of requested size");
+    }
+
+    block->size_flags |= PinnedFlag;
+    block->SetOwner(nullptr);
+    return block->payload();
+}
+
+// See Simple.h
+void Simple::free_pinned(void *ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+
+    Block *block = BlockOf(ptr, nullptr);
+    block->size_flags &= ~PinnedFlag;
+    Release(block);
+}
+
+// See Simple.h
+void Simple::defrag() {
+    _defrag_cursor = _first;
+    defrag(SIZE_MAX);
+}
+
+// See Simple.h
+bool Simple::defrag(size_t budget) {
+    size_t work = 0;
+    Block *block = _defrag_cursor;
+    while (block != _last) {
+        if (work >= budget) {
+            _defrag_cursor = block;
+            return false;
+        }
+
+        // Free blocks never neighbour each other, so everything but pinned chunks gets moved
+        Block *next = block->next();
+        if (block->IsFree() && next != _last && !next->IsPinned()) {
+            work += next->size();
+            block = Slide(block, next);
+        } else {
+            work += HeaderSize;
+            block = next;
+        }
+    }
+
+    _defrag_cursor = _first;
+    return true;
+}
+
+// See Simple.h
+std::string Simple::dump() const {
+    size_t used = 0, used_blocks = 0, pinned = 0, pinned_blocks = 0, handle_table = 0;
+    size_t free = 0, free_blocks = 0, largest_free = 0;
+
+    // Lower bound of size class to the number of used and free blocks in it
+    std::map<size_t, std::pair<size_t, size_t>> classes;
+    for (Block *block = _first; block != _last; block = block->next()) {
+        size_t size = block->size();
+        if (block->IsFree()) {
+            free += size;
+            free_blocks++;
+            largest_free = std::max(largest_free, size);
+            classes[ClassSize(size)].second++;
+        } else if (!block->IsPinned()) {
+            used += size;
+            used_blocks++;
+            classes[ClassSize(size)].first++;
+        } else if (block->owner() == nullptr) {
+            pinned += size;
+            pinned_blocks++;
+            classes[ClassSize(size)].first++;
+        } else {
+            handle_table += size;
+        }
+    }
+
+    size_t handles_free = 0;
+    for (void **slot = _free_handles; slot != nullptr; slot = UntagFree(*slot)) {
+        handles_free++;
+    }
+
+    // Free memory that can't be taken by a single allocation is considered fragmented
+    double fragmentation = free == 0 ? 0.0 : 1.0 - double(largest_free) / free;
+
+    std::ostringstream out;
+    out << "bytes " << reinterpret_cast<char *>(_last) - reinterpret_cast<char *>(_first) << "\n";
+    out << "used_bytes " << used << "\n";
+    out << "used_blocks " << used_blocks << "\n";
+    out << "pinned_bytes " << pinned << "\n";
+    out << "pinned_blocks " << pinned_blocks << "\n";
+    out << "handle_table_bytes " << handle_table << "\n";
+    out << "handles_free " << handles_free << "\n";
+    out << "free_bytes " << free << "\n";
+    out << "free_blocks " << free_blocks << "\n";
+    out << "largest_free " << largest_free << "\n";
+    out << "fragmentation " << std::fixed << std::setprecision(4) << fragmentation << "\n";
+    out << "defrag_moves " << _defrag_moves << "\n";
+    out << "defrag_moved_bytes " << _defrag_moved_bytes << "\n";
+    for (auto &cls : classes) {
+        out << "class_" << cls.first << "_used " << cls.second.first << "\n";
+        out << "class_" << cls.first << "_free " << cls.second.second << "\n";
+    }
+    return out.str();
+}
+
+// See Simple.h
+void Simple::Insert(Block *block) {
+    unsigned fl, sl;
+    Mapping(block->size(), fl, sl);
+
+    Block *&head = _heads[fl * SLCount + sl];
+    block->free_prev = nullptr;
+    block->free_next = head;
+    if (head != nullptr) {
+        head->free_prev = block;
+    }
+    head = block;
+
+    _fl_bitmap |= uint64_t(1) << fl;
+    _sl_bitmap[fl] |= 1u << sl;
+}
+
+// See Simple.h
+void Simple::Remove(Block *block) {
+    unsigned fl, sl;
+    Mapping(block->size(), fl, sl);
+
+    Block *&head = _heads[fl * SLCount + sl];
+    if (block->free_prev != nullptr) {
+        block->free_prev->free_next = block->free_next;
+    } else {
+        head = block->free_next;
+    }
+    if (block->free_next != nullptr) {
+        block->free_next->free_prev = block->free_prev;
+    }
+
+    if (head == nullptr) {
+        _sl_bitmap[fl] &= ~(1u << sl);
+        if (_sl_bitmap[fl] == 0) {
+            _fl_bitmap &= ~(uint64_t(1) << fl);
+        }
+    }
+}
+
+// See Simple.h
+Simple::Block *Simple::FindFree(size_t size) const {
+    // Round size up to the next class boundary, so that any block of the class found fits
+    size_t rounded = size;
+    if (size >= SmallSize) {
+        rounded += (size_t(1) << (Msb(size) - SLLog2)) - 1;
+    }
+
+    unsigned fl, sl;
+    Mapping(rounded, fl, sl);
+    if (fl < _fl_count) {
+        uint32_t sl_map = _sl_bitmap[fl] & (~0u << sl);
+        if (sl_map == 0) {
+            uint64_t fl_map = (fl + 1 < 64) ? (_fl_bitmap & (~uint64_t(0) << (fl + 1))) : 0;
+            if (fl_map != 0) {
+                fl = __builtin_ctzll(fl_map);
+                sl_map = _sl_bitmap[fl];
+            }
+        }
+        if (sl_map != 0) {
+            return _heads[fl * SLCount + __builtin_ctz(sl_map)];
+        }
+    }
+
+    // Rounding skips blocks of the request's own class, some of them might still fit. That is
+    // the only case when list is scanned, and it happens only when memory is nearly exhausted
+    Mapping(size, fl, sl);
+    if (fl < _fl_count) {
+        for (Block *block = _heads[fl * SLCount + sl]; block != nullptr; block = block->free_next) {
+            if (block->size() >= size) {
+                return block;
+            }
+        }
+    }
+    return nullptr;
+}
+
+// See Simple.h
+Simple::Block *Simple::Carve(size_t size) {
+    Block *block = FindFree(size);
+    if (block == nullptr) {
+        return nullptr;
+    }
+
+    Remove(block);
+    block->MarkUsed();
+    Split(block, size);
+    return block;
+}
+
+// See Simple.h
+Simple::Block *Simple::CarveTop(size_t size) {
+    if (!_pinned->IsPrevFree()) {
+        return nullptr;
+    }
+
+    Block *block = _pinned->prev();
+    if (block->size() < size) {
+        return nullptr;
+    }
+
+    Remove(block);
+    if (block->size() - size < MinBlockSize) {
+        block->MarkUsed();
+        _pinned = block;
+        return block;
+    }
+
+    block->Resize(block->size() - size);
+    Block *top = block->next();
+    top->size_flags = size;
+    block->MarkFree();
+    Insert(block);
+    top->MarkUsed();
+    _pinned = top;
+    return top;
+}
+
+// See Simple.h
+void Simple::Split(Block *block, size_t size) {
+    size_t rest = block->size() - size;
+    if (rest < MinBlockSize) {
+        return;
+    }
+
+    block->Resize(size);
+    Block *tail = block->next();
+    tail->size_flags = rest;
+    Release(tail);
+}
+
+// See Simple.h
+void Simple::Release(Block *block) {
+    if (block->IsPrevFree()) {
+        Block *prev = block->prev();
+        Remove(prev);
+        Join(prev, block);
+        block = prev;
+    }
+
+    Block *next = block->next();
+    if (next->IsFree()) {
+        Remove(next);
+        Join(block, next);
+    }
+
+    block->MarkFree();
+    Insert(block);
+}
+
+// See Simple.h
+void Simple::Join(Block *block, Block *next) {
+    block->Resize(block->size() + next->size());
+    if (_defrag_cursor == next) {
+        _defrag_cursor = block;
+    }
+}
+
+// See Simple.h
+Simple::Block *Simple::Slide(Block *block, Block *next) {
+    size_t free_size = block->size();
+    size_t used_size = next->size();
+    void **slot = next->owner();
+    Block *after = next->next();
+
+    // Free block is preceded by allocated one, so moved block gets no flags. Its prev_size holds
+    // the handle of the previous block and must stay untouched
+    Remove(block);
+    std::memmove(block->payload(), next->payload(), used_size - HeaderSize);
+    block->size_flags = used_size;
+
+    Block *rest = block->next();
+    rest->size_flags = free_size;
+    if (after->IsFree()) {
+        Remove(after);
+        Join(rest, after);
+    }
+    rest->MarkFree();
+    Insert(rest);
+
+    *slot = block->payload();
+    block->SetOwner(slot);
+
+    _defrag_moves++;
+    _defrag_moved_bytes += used_size;
+    return rest;
+}
+
+// See Simple.h
+void Simple::GrowHandles() {
+    // Chunks are pinned, prefer the top of the heap for them and fall back to any free block
+    Block *chunk = nullptr;
+    size_t count = _handles_chunk;
+    for (; chunk == nullptr && count > 0; count /= 2) {
+        size_t size = BlockSize(count * sizeof(void *));
+        chunk = CarveTop(size);
+        if (chunk == nullptr) {
+            chunk = Carve(size);
+        }
+    }
+    if (chunk == nullptr) {
+        throw AllocError(AllocErrorType::NoMemory, "No space for handle table");
+    }
+    chunk->size_flags |= PinnedFlag;
+
+    // Chunk is owned by itself, so that it is never taken for a block allocated by alloc_pinned
+    void **slots = static_cast<void **>(chunk->payload());
+    chunk->SetOwner(slots);
+
+    if (_handles_chunk < MaxHandlesChunk) {
+        _handles_chunk *= 2;
+    }
+
+    // Block might be larger than requested, use all of it
+    count = (chunk->size() - HeaderSize) / sizeof(void *);
+    for (size_t i = 0; i < count; i++) {
+        slots[i] = TagFree(i + 1 < count ? &slots[i + 1] : _free_handles);
+    }
+    _free_handles = slots;
+}
+
+// See Simple.h
+Simple::Block *Simple::BlockOf(void *ptr, void **slot) const {
+    char *payload = static_cast<char *>(ptr);
+    if (payload < static_cast<char *>(_first->payload()) || payload >= reinterpret_cast<char *>(_last) ||
+        (reinterpret_cast<uintptr_t>(payload) & (Align - 1)) != 0) {
+        throw AllocError(AllocErrorType::InvalidFree, "Pointer is outside of the arena");
+    }
+
+    Block *block = Block::Of(payload);
+    if (block->IsFree() || block->IsPinned() != (slot == nullptr) || block->next() > _last ||
+        block->owner() != slot) {
+        throw AllocError(AllocErrorType::InvalidFree, "Block is not allocated");
+    }
+    return block;
+}
 
 } // namespace Allocator
 } // namespace Afina
@@ -0,0 +1,27 @@
+#include <afina/Storage.h>
+#include <afina/execute/Cas.h>
+
+#include <iostream>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: "cas" is a check and set operation which means "store this data but only if
+// no one else has updated since I last fetched it."
+void Cas::Execute(Storage &storage, const std::string &args, std::string &out) {
+    std::cout << "Cas(" << _key << ", " << _version << "): " << args << std::endl;
+    switch (storage.CompareAndSwap(_key, args, _version, deadline())) {
+    case CasResult::kStored:
+        out.assign("STORED");
+        break;
+    case CasResult::kExists:
+        out.assign("EXISTS");
+        break;
+    case CasResult::kNotFound:
+        out.assign("NOT_FOUND");
+        break;
+    }
+}
+
+} // namespace Execute
+} // namespace Afina
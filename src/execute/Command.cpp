@@ -1 +1,25 @@
 #include <afina/execute/Command.h>
+
+namespace Afina {
+namespace Execute {
+
+// See Command.h
+void Response::Flatten(std::string &out) const {
+    size_t size = text.size();
+    for (auto &value : values) {
+        size += value.second.size();
+    }
+
+    out.clear();
+    out.reserve(size);
+    size_t pos = 0;
+    for (auto &value : values) {
+        out.append(text, pos, value.first - pos);
+        out.append(value.second.data(), value.second.size());
+        pos = value.first;
+    }
+    out.append(text, pos, std::string::npos);
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -0,0 +1,59 @@
+#include <afina/execute/CommandSlot.h>
+
+#include <cassert>
+
+namespace Afina {
+namespace Execute {
+
+// Calls are qualified, so they go straight to the implementation
+void CommandSlot::Execute(Storage &storage, const std::string &args, std::string &out) {
+    switch (_kind) {
+    case Kind::kSet:
+        static_cast<Set *>(_command)->Set::Execute(storage, args, out);
+        break;
+    case Kind::kAdd:
+        static_cast<Add *>(_command)->Add::Execute(storage, args, out);
+        break;
+    case Kind::kReplace:
+        static_cast<Replace *>(_command)->Replace::Execute(storage, args, out);
+        break;
+    case Kind::kAppend:
+        static_cast<Append *>(_command)->Append::Execute(storage, args, out);
+        break;
+    case Kind::kPrepend:
+        static_cast<Prepend *>(_command)->Prepend::Execute(storage, args, out);
+        break;
+    case Kind::kCas:
+        static_cast<Cas *>(_command)->Cas::Execute(storage, args, out);
+        break;
+    case Kind::kGet:
+        static_cast<Get *>(_command)->Get::Execute(storage, args, out);
+        break;
+    case Kind::kStats:
+        static_cast<Stats *>(_command)->Stats::Execute(storage, args, out);
+        break;
+    default:
+        assert(false);
+    }
+}
+
+// Only get has values to reference, the rest write text
+void CommandSlot::Execute(Storage &storage, const std::string &args, Response &out) {
+    if (_kind == Kind::kGet) {
+        static_cast<Get *>(_command)->Get::Execute(storage, args, out);
+    } else {
+        out.values.clear();
+        Execute(storage, args, out.text);
+    }
+}
+
+void CommandSlot::Reset() {
+    if (_command != nullptr) {
+        _command->~Command();
+        _command = nullptr;
+        _kind = Kind::kEmpty;
+    }
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -2,8 +2,8 @@
 #include <afina/execute/Get.h>
 
 #include <iostream>
-#include <iterator>
-#include <sstream>
+#include <utility>
+#include <vector>
 
 namespace Afina {
 namespace Execute {
@@ -21,23 +21,50 @@ to indicate the end of response.
 
 */
 
+std::vector<std::string> Get::keys() const {
+    std::vector<std::string> result;
+    for (size_t i = 0, begin = 0; i < _ends.size(); begin = _ends[i++] + 1) {
+        result.emplace_back(_keys, begin, _ends[i] - begin);
+    }
+    return result;
+}
+
 void Get::Execute(Storage &storage, const std::string &args, std::string &out) {
-    std::stringstream keyStream;
-    copy(_keys.begin(), _keys.end(), std::ostream_iterator<std::string>(keyStream, " "));
-    std::cout << "Get(" << keyStream.str() << ")" << std::endl;
+    Response response;
+    Execute(storage, args, response);
+    response.Flatten(out);
+}
 
-    std::stringstream outStream;
+void Get::Execute(Storage &storage, const std::string &args, Response &out) {
+    std::cout << "Get(" << _keys << ")" << std::endl;
 
-    std::string value;
-    for (auto &key : _keys) {
-        if (!storage.Get(key, value))
+    // Values are referenced in place, it is up to the caller to either write them out as they are or copy
+    out.clear();
+    out.values.reserve(_ends.size());
+
+    // Storage looks keys up by string, the same one is reused for each key
+    std::string key;
+    PinnedValue value;
+    uint64_t version = 0;
+    for (size_t i = 0, begin = 0; i < _ends.size(); begin = _ends[i++] + 1) {
+        key.assign(_keys, begin, _ends[i] - begin);
+        bool ok = _versions ? storage.GetVersioned(key, value, version) : storage.GetPinned(key, value);
+        if (!ok)
             continue;
-        outStream << "VALUE " << key << " 0 " << value.size() << "\r\n";
-        outStream << value << "\r\n";
-    }
-    outStream << "END"; // networking layer should add the last \r\n
 
-    out = outStream.str();
+        out.text.append("VALUE ");
+        out.text.append(key);
+        out.text.append(" 0 ");
+        out.text.append(std::to_string(value.size()));
+        if (_versions) {
+            out.text.append(" ");
+            out.text.append(std::to_string(version));
+        }
+        out.text.append("\r\n");
+        out.values.emplace_back(out.text.size(), std::move(value));
+        out.text.append("\r\n");
+    }
+    out.text.append("END"); // networking layer should add the last \r\n
 }
 
 } // namespace Execute
@@ -8,10 +8,18 @@ namespace Execute {
 
 // memcached protocol: "set" means "store this data".
 void Set::Execute(Storage &storage, const std::string &args, std::string &out) {
-    std::cout << "Set(" << _key << "): " << args << std::endl;
-    storage.Put(_key, args);
+    if (_value) {
+        std::cout << "Set(" << _key << "): " << _value->size() << " bytes reserved" << std::endl;
+        storage.PutReserved(_key, std::move(_value), deadline());
+    } else {
+        std::cout << "Set(" << _key << "): " << args << std::endl;
+        storage.Put(_key, args, deadline());
+    }
     out = "STORED";
 }
 
+// Data block is collected straight into the value that ends up in the storage
+void Set::Reserve(Storage &storage, size_t size) { _value = storage.ReserveValue(size); }
+
 } // namespace Execute
 } // namespace Afina
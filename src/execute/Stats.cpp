@@ -8,7 +8,37 @@
 namespace Afina {
 namespace Execute {
 
-void Stats::Execute(Storage &storage, const std::string &args, std::string &out) { out.assign("END"); }
+/* memcached protocol:
+
+Each statistic sent by the server looks like this:
+
+STAT <name> <value>\r\n
+
+After all the statistics have been transmitted, the server sends the string
+"END\r\n"
+
+*/
+
+void Stats::Execute(Storage &storage, const std::string &args, std::string &out) {
+    std::cout << "Stats(" << args << ")" << std::endl;
+
+    std::string stats;
+    storage.Stats(stats);
+
+    out.clear();
+    out.reserve(stats.size() * 2 + 3);
+    for (size_t pos = 0; pos < stats.size();) {
+        size_t end = stats.find('\n', pos);
+        if (end == std::string::npos) {
+            end = stats.size();
+        }
+        out.append("STAT ");
+        out.append(stats, pos, end - pos);
+        out.append("\r\n");
+        pos = end + 1;
+    }
+    out.append("END"); // networking layer should add the last \r\n
+}
 
 } // namespace Execute
 } // namespace Afina
@@ -0,0 +1,76 @@
+#include <afina/Executor.h>
+
+#include <iostream>
+#include <stdexcept>
+
+#include <pthread.h>
+
+namespace Afina {
+
+// See Executor.h
+void perform(Executor *executor) {
+    // Linux limits thread name by 15 characters
+    pthread_setname_np(pthread_self(), executor->name.substr(0, 15).c_str());
+
+    std::unique_lock<std::mutex> lock(executor->mutex);
+    for (;;) {
+        if (executor->tasks.empty()) {
+            if (executor->state != Executor::State::kRun) {
+                break;
+            }
+            executor->empty_condition.wait(lock);
+            continue;
+        }
+
+        std::function<void()> task = std::move(executor->tasks.front());
+        executor->tasks.pop_front();
+
+        lock.unlock();
+        try {
+            task();
+        } catch (std::exception &ex) {
+            std::cerr << "Executor " << executor->name << " task fails: " << ex.what() << std::endl;
+        }
+        lock.lock();
+    }
+
+    if (--executor->running == 0) {
+        executor->state = Executor::State::kStopped;
+    }
+}
+
+// See Executor.h
+Executor::Executor(std::string name, int size) : state(State::kRun), running(size), name(name) {
+    if (size <= 0) {
+        throw std::invalid_argument("Executor needs at least one thread");
+    }
+
+    threads.reserve(size);
+    for (int i = 0; i < size; i++) {
+        threads.emplace_back(perform, this);
+    }
+}
+
+// See Executor.h
+Executor::~Executor() { Stop(true); }
+
+// See Executor.h
+void Executor::Stop(bool await) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (state == State::kRun) {
+            state = State::kStopping;
+        }
+        empty_condition.notify_all();
+    }
+
+    if (await) {
+        for (auto &thread : threads) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+    }
+}
+
+} // namespace Afina
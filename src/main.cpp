@@ -1,18 +1,29 @@
+#include <cctype>
 #include <chrono>
+#include <ctime>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <stdexcept>
+#include <string>
 #include <uv.h>
 
 #include <cxxopts.hpp>
 
 #include <afina/Storage.h>
 #include <afina/Version.h>
+#include <afina/allocator/MappedRegion.h>
 #include <afina/network/Server.h>
 
 #include "network/blocking/ServerImpl.h"
 #include "network/nonblocking/ServerImpl.h"
 #include "network/uv/ServerImpl.h"
+#include "storage/ArenaImpl.h"
+#include "storage/LRUCacheImpl.h"
+#include "storage/LockFreeHashImpl.h"
 #include "storage/MapBasedGlobalLockImpl.h"
+#include "storage/MapBasedRWLockImpl.h"
+#include "storage/StripedLockImpl.h"
 
 typedef struct {
     std::shared_ptr<Afina::Storage> storage;
@@ -33,6 +44,51 @@ void timer_handler(uv_timer_t *handle) {
     std::cout << "Start passive metrics collection" << std::endl;
 }
 
+// Called periodically to release memory of expired associations
+void reaper_handler(uv_timer_t *handle) {
+    Application *pApp = static_cast<Application *>(handle->data);
+    pApp->storage->ReapExpired(time(nullptr));
+}
+
+// Parses memory size given as number of bytes with optional K, M or G suffix, e.g 512M or 4G
+size_t parse_memory_size(const std::string &str) {
+    // stoull happily negates "-1" into a huge number, so sign is checked upfront
+    if (str.empty() || !std::isdigit(static_cast<unsigned char>(str[0]))) {
+        throw std::invalid_argument("Invalid memory size: " + str);
+    }
+
+    size_t pos = 0;
+    unsigned long long size = std::stoull(str, &pos);
+    if (pos == str.size()) {
+        return size;
+    } else if (pos + 1 != str.size()) {
+        throw std::invalid_argument("Invalid memory size: " + str);
+    }
+
+    unsigned shift = 0;
+    switch (str[pos]) {
+    case 'G':
+    case 'g':
+        shift += 10;
+    // fall through
+    case 'M':
+    case 'm':
+        shift += 10;
+    // fall through
+    case 'K':
+    case 'k':
+        shift += 10;
+        break;
+    default:
+        throw std::invalid_argument("Invalid memory size: " + str);
+    }
+
+    if (size > (std::numeric_limits<size_t>::max() >> shift)) {
+        throw std::out_of_range("Memory size is too large: " + str);
+    }
+    return size << shift;
+}
+
 int main(int argc, char **argv) {
     // Build version
     // TODO: move into Version.h as a function
@@ -48,7 +104,15 @@ int main(int argc, char **argv) {
         // TODO: use custom cxxopts::value to print options possible values in help message
         // and simplify validation below
         options.add_options()("s,storage", "Type of storage service to use", cxxopts::value<std::string>());
+        options.add_options()("m,memory", "Memory budget for the lru and arena storages, e.g 512M or 4G",
+                              cxxopts::value<std::string>());
+        options.add_options()("hugepages", "Huge pages for the arena storage: none, thp or explicit",
+                              cxxopts::value<std::string>());
+        options.add_options()("populate", "Pre-fault arena storage memory on startup");
         options.add_options()("n,network", "Type of network service to use", cxxopts::value<std::string>());
+        options.add_options()("w,workers", "Number of network threads", cxxopts::value<uint16_t>());
+        options.add_options()("reuseport", "Nonblocking network: each worker listens on own SO_REUSEPORT socket");
+        options.add_options()("pin", "Nonblocking network: pin worker threads to CPUs");
         options.add_options()("h,help", "Print usage info");
         options.parse(argc, argv);
 
@@ -71,8 +135,40 @@ int main(int argc, char **argv) {
         storage_type = options["storage"].as<std::string>();
     }
 
+    size_t memory = 64 * 1024 * 1024;
+    if (options.count("memory") > 0) {
+        // Other storages are bounded by number of items, budget would be silently ignored
+        if (storage_type != "lru" && storage_type != "arena") {
+            throw std::runtime_error("Memory budget is supported by lru and arena storages only");
+        }
+        memory = parse_memory_size(options["memory"].as<std::string>());
+    }
+
+    Afina::Allocator::HugePages huge_pages = Afina::Allocator::HugePages::None;
+    if (options.count("hugepages") > 0) {
+        std::string hugepages = options["hugepages"].as<std::string>();
+        if (hugepages == "thp") {
+            huge_pages = Afina::Allocator::HugePages::Transparent;
+        } else if (hugepages == "explicit") {
+            huge_pages = Afina::Allocator::HugePages::Explicit;
+        } else if (hugepages != "none") {
+            throw std::runtime_error("Unknown huge pages mode");
+        }
+    }
+    bool populate = options.count("populate") > 0;
+
     if (storage_type == "map_global") {
         app.storage = std::make_shared<Afina::Backend::MapBasedGlobalLockImpl>();
+    } else if (storage_type == "lockfree") {
+        app.storage = std::make_shared<Afina::Backend::LockFreeHashImpl>();
+    } else if (storage_type == "lru") {
+        app.storage = std::make_shared<Afina::Backend::LRUCacheImpl>(memory);
+    } else if (storage_type == "map_rwlock") {
+        app.storage = std::make_shared<Afina::Backend::MapBasedRWLockImpl>();
+    } else if (storage_type == "striped") {
+        app.storage = std::make_shared<Afina::Backend::StripedLockImpl>();
+    } else if (storage_type == "arena") {
+        app.storage = std::make_shared<Afina::Backend::ArenaImpl>(memory, huge_pages, populate);
     } else {
         throw std::runtime_error("Unknown storage type");
     }
@@ -83,12 +179,19 @@ int main(int argc, char **argv) {
         network_type = options["network"].as<std::string>();
     }
 
+    uint16_t workers = 1;
+    if (options.count("workers") > 0) {
+        workers = options["workers"].as<uint16_t>();
+    }
+
     if (network_type == "uv") {
         app.server = std::make_shared<Afina::Network::UV::ServerImpl>(app.storage);
     } else if (network_type == "blocking") {
         app.server = std::make_shared<Afina::Network::Blocking::ServerImpl>(app.storage);
     } else if (network_type == "nonblocking") {
-        app.server = std::make_shared<Afina::Network::NonBlocking::ServerImpl>(app.storage);
+        bool reuse_port = options.count("reuseport") > 0;
+        bool pin_cpu = options.count("pin") > 0;
+        app.server = std::make_shared<Afina::Network::NonBlocking::ServerImpl>(app.storage, reuse_port, pin_cpu);
     } else {
         throw std::runtime_error("Unknown network type");
     }
@@ -109,10 +212,15 @@ int main(int argc, char **argv) {
     timer.data = &app;
     uv_timer_start(&timer, timer_handler, 0, 5000);
 
+    uv_timer_t reaper;
+    uv_timer_init(&loop, &reaper);
+    reaper.data = &app;
+    uv_timer_start(&reaper, reaper_handler, 100, 100);
+
     // Start services
     try {
         app.storage->Start();
-        app.server->Start(8080);
+        app.server->Start(8080, workers);
 
         // Freeze current thread and process events
         std::cout << "Application started" << std::endl;
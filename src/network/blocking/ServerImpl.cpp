@@ -1,10 +1,13 @@
 #include "ServerImpl.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
 #include <cstring>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
+#include <vector>
 
 #include <pthread.h>
 #include <signal.h>
@@ -18,23 +21,59 @@
 #include <unistd.h>
 
 #include <afina/Storage.h>
+#include <afina/execute/CommandSlot.h>
+
+#include "protocol/Parser.h"
 
 namespace Afina {
 namespace Network {
 namespace Blocking {
 
+// Largest data block accepted from the client
+static const uint32_t MaxBodySize = 64 * 1024 * 1024;
+
+// Writes whole buffer to the socket, returns false if connection is broken
+static bool SendAll(int socket, const std::string &data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(socket, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
 void *ServerImpl::RunAcceptorProxy(void *p) {
     ServerImpl *srv = reinterpret_cast<ServerImpl *>(p);
     try {
         srv->RunAcceptor();
-    } catch (std::runtime_error &ex) {
+    } catch (std::exception &ex) {
         std::cerr << "Server fails: " << ex.what() << std::endl;
+    } catch (...) {
+        std::cerr << "Server fails: unknown error" << std::endl;
+    }
+    return 0;
+}
+
+void *ServerImpl::RunWorkerProxy(void *p) {
+    ServerImpl *srv = reinterpret_cast<ServerImpl *>(p);
+    try {
+        srv->RunWorker();
+    } catch (std::exception &ex) {
+        std::cerr << "Worker fails: " << ex.what() << std::endl;
+    } catch (...) {
+        std::cerr << "Worker fails: unknown error" << std::endl;
     }
     return 0;
 }
 
 // See Server.h
-ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps) : Server(ps) {}
+ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps) : Server(ps), server_socket(-1) {}
 
 // See Server.h
 ServerImpl::~ServerImpl() {}
@@ -82,21 +121,59 @@ void ServerImpl::Start(uint32_t port, uint16_t n_workers) {
     // since there will only be one server thread, and the program's main thread (the
     // one running main()) could fulfill this purpose.
     running.store(true);
-    if (pthread_create(&accept_thread, NULL, ServerImpl::RunAcceptorProxy, this) < 0) {
+    if (pthread_create(&accept_thread, NULL, ServerImpl::RunAcceptorProxy, this) != 0) {
+        running.store(false);
         throw std::runtime_error("Could not create server thread");
     }
+
+    // Connections are served by the fixed pool of threads, acceptor hands them over through the queue
+    for (uint16_t i = 0; i < max_workers; i++) {
+        pthread_t worker;
+        if (pthread_create(&worker, NULL, ServerImpl::RunWorkerProxy, this) != 0) {
+            // Threads started so far would otherwise be left running without anybody to join them
+            Stop();
+            Join();
+            throw std::runtime_error("Could not create worker thread");
+        }
+        workers.push_back(worker);
+    }
 }
 
 // See Server.h
 void ServerImpl::Stop() {
     std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+    std::unique_lock<std::mutex> __lock(connections_mutex);
     running.store(false);
+
+    // Wake up acceptor blocked in accept()
+    if (server_socket != -1) {
+        shutdown(server_socket, SHUT_RDWR);
+    }
+
+    // Connections nobody started to serve yet are just dropped
+    for (int client_socket : pending) {
+        close(client_socket);
+    }
+    pending.clear();
+
+    // Workers blocked in recv() get EOF, while ones executing command complete it and send
+    // response back before closing connection
+    for (int client_socket : connections) {
+        shutdown(client_socket, SHUT_RD);
+    }
+
+    connections_cv.notify_all();
+    pending_cv.notify_all();
 }
 
 // See Server.h
 void ServerImpl::Join() {
     std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
     pthread_join(accept_thread, 0);
+    for (pthread_t worker : workers) {
+        pthread_join(worker, 0);
+    }
+    workers.clear();
 }
 
 // See Server.h
@@ -152,77 +229,197 @@ void ServerImpl::RunAcceptor() {
     // connections that we'll allow to queue up. Note that listen() doesn't block until
     // incoming connections arrive. It just makesthe OS aware that this process is willing
     // to accept connections on this socket (which is bound to a specific IP and port)
-    if (listen(server_socket, 5) == -1) {
+    if (listen(server_socket, SOMAXCONN) == -1) {
         close(server_socket);
         throw std::runtime_error("Socket listen() failed");
     }
 
+    // Publish socket so that Stop could interrupt accept() on it
+    {
+        std::unique_lock<std::mutex> __lock(connections_mutex);
+        if (!running.load()) {
+            close(server_socket);
+            return;
+        }
+        this->server_socket = server_socket;
+    }
+
     int client_socket;
     struct sockaddr_in client_addr;
     socklen_t sinSize = sizeof(struct sockaddr_in);
     while (running.load()) {
         std::cout << "network debug: waiting for connection..." << std::endl;
 
+        // Backpressure: while queue is full connections are left in the kernel backlog
+        {
+            std::unique_lock<std::mutex> __lock(connections_mutex);
+            while (running.load() && pending.size() >= max_workers) {
+                pending_cv.wait(__lock);
+            }
+        }
+
         // When an incoming connection arrives, accept it. The call to accept() blocks until
         // the incoming connection arrives
+        sinSize = sizeof(struct sockaddr_in);
         if ((client_socket = accept(server_socket, (struct sockaddr *)&client_addr, &sinSize)) == -1) {
+            if (!running.load()) {
+                break;
+            } else if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+
             close(server_socket);
             throw std::runtime_error("Socket accept() failed");
         }
 
-        // TODO: Start new thread and process data from/to connection
-        {
-            std::string msg = "TODO: start new thread and process memcached protocol instead";
-            if (send(client_socket, msg.data(), msg.size(), 0) <= 0) {
-                close(client_socket);
-                close(server_socket);
-                throw std::runtime_error("Socket send() failed");
-            }
+        // Hand connection over to the pool
+        std::unique_lock<std::mutex> __lock(connections_mutex);
+        if (!running.load()) {
             close(client_socket);
+            break;
         }
+        pending.push_back(client_socket);
+        connections_cv.notify_one();
     }
 
     // Cleanup on exit...
+    std::unique_lock<std::mutex> __lock(connections_mutex);
+    this->server_socket = -1;
     close(server_socket);
+}
+
+// See Server.h
+void ServerImpl::RunWorker() {
+    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
 
-    // Wait until for all connections to be complete
     std::unique_lock<std::mutex> __lock(connections_mutex);
-    while (!connections.empty()) {
-        connections_cv.wait(__lock);
+    while (running.load()) {
+        if (pending.empty()) {
+            connections_cv.wait(__lock);
+            continue;
+        }
+
+        int client_socket = pending.front();
+        pending.pop_front();
+        connections.insert(client_socket);
+        pending_cv.notify_one();
+
+        // Whatever happens to the connection, worker goes on with the next one and socket is released
+        __lock.unlock();
+        try {
+            RunConnection(client_socket);
+        } catch (std::exception &ex) {
+            std::cerr << "Connection fails: " << ex.what() << std::endl;
+        } catch (...) {
+            std::cerr << "Connection fails: unknown error" << std::endl;
+        }
+        __lock.lock();
+
+        connections.erase(client_socket);
+        close(client_socket);
     }
 }
 
 // See Server.h
-void ServerImpl::RunConnection() {
+void ServerImpl::RunConnection(int client_socket) {
     std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
-    pthread_t self = pthread_self();
 
-    // Thread just spawn, register itself as a connection
-    {
-        std::unique_lock<std::mutex> __lock(connections_mutex);
-        connections.insert(self);
-    }
+    Protocol::Parser parser;
 
-    // TODO: All connection work is here
+    // Key bytes of the current command, it borrows them from here
+    std::string keys;
+    std::vector<uint32_t> key_ends;
 
-    // Thread is about to stop, remove self from list of connections
-    // and it was the very last one, notify main thread
-    {
-        std::unique_lock<std::mutex> __lock(connections_mutex);
-        auto pos = connections.find(self);
+    // Reused by every command of the connection
+    Execute::CommandSlot cmd;
 
-        assert(pos != connections.end());
-        connections.erase(pos);
+    // Number of body bytes, including trailing \r\n, left to read before command could be executed
+    uint32_t body_size = 0;
+    std::string body;
 
-        if (connections.empty()) {
-            // Better to unlock before notify in order to let notified thread
-            // hold the mutex. Otherwise notification might be skipped
-            __lock.unlock();
+    char input[4096];
+    std::string output;
+
+    bool alive = true;
+    while (alive && running.load()) {
+        ssize_t n = recv(client_socket, input, sizeof(input), 0);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            break;
+        }
+
+        // All commands found in the input are executed and their responses sent back at once
+        size_t offset = 0;
+        try {
+            while (offset < size_t(n)) {
+                if (!cmd) {
+                    // Parser reports number of bytes consumed from the given chunk, not from the buffer start
+                    size_t parsed = 0;
+                    bool complete = parser.Parse(input + offset, n - offset, parsed);
+                    offset += parsed;
+                    if (!complete) {
+                        break;
+                    }
+
+                    uint32_t size = 0;
+                    parser.Build(size, cmd, keys, key_ends);
+                    if (size > MaxBodySize) {
+                        throw std::runtime_error("Data block is too large");
+                    }
+                    body_size = parser.HasBody() ? size + 2 : 0;
+                    body.clear();
+                }
+
+                if (body_size > 0) {
+                    size_t size = std::min(size_t(body_size), n - offset);
+                    body.append(input + offset, size);
+                    body_size -= size;
+                    offset += size;
+                    if (body_size > 0) {
+                        break;
+                    }
+
+                    if (body.compare(body.size() - 2, 2, "\r\n") != 0) {
+                        throw std::runtime_error("Invalid data block, \\r\\n expected");
+                    }
+                    body.resize(body.size() - 2);
+                }
+
+                // Failure of a single command is reported to the client, pool thread must survive it
+                std::string out;
+                try {
+                    cmd.Execute(*pStorage, body, out);
+                } catch (std::exception &ex) {
+                    out = std::string("SERVER_ERROR ") + ex.what();
+                } catch (...) {
+                    out = "SERVER_ERROR unknown error";
+                }
+                output.append(out);
+                output.append("\r\n");
+
+                cmd.Reset();
+                body.clear();
+                parser.Reset();
+            }
+        } catch (std::runtime_error &ex) {
+            // Input stream can't be resynchronized after bad command, so it is the last one
+            output.append("CLIENT_ERROR ");
+            output.append(ex.what());
+            output.append("\r\n");
+            alive = false;
+        } catch (std::exception &ex) {
+            // Command couldn't be taken in, e.g there is no memory for its data block
+            output.append("SERVER_ERROR ");
+            output.append(ex.what());
+            output.append("\r\n");
+            alive = false;
+        }
 
-            // We are pretty sure that only ONE thread is waiting for connections
-            // queue to be empty - main thread
-            connections_cv.notify_one();
+        if (!SendAll(client_socket, output)) {
+            break;
         }
+        output.clear();
     }
 }
 
@@ -3,9 +3,11 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <mutex>
 #include <pthread.h>
 #include <unordered_set>
+#include <vector>
 
 #include <afina/network/Server.h>
 
@@ -15,7 +17,11 @@ namespace Blocking {
 
 /**
  * # Network resource manager implementation
- * Server that is spawning a separate thread for each connection
+ * Blocking server, each connection is served by a dedicated thread for its whole life. Threads are
+ * taken from the pool of max_workers threads created on start, so no thread is spawned per connection.
+ *
+ * Accepted sockets wait in the queue until some thread becomes free. Once there are max_workers sockets
+ * waiting, acceptor stops taking new connections and they are left in the kernel backlog
  */
 class ServerImpl : public Server {
 public:
@@ -38,12 +44,19 @@ protected:
     void RunAcceptor();
 
     /**
-     * Methos is running for each connection
+     * Method is running in each pool thread, takes connections from the queue one by one
      */
-    void RunConnection();
+    void RunWorker();
+
+    /**
+     * Methos is running for each connection, reads and executes commands until client disconnects
+     * or server stops
+     */
+    void RunConnection(int client_socket);
 
 private:
     static void *RunAcceptorProxy(void *p);
+    static void *RunWorkerProxy(void *p);
 
     // Atomic flag to notify threads when it is time to stop. Note that
     // flag must be atomic in order to safely publisj changes cross thread
@@ -63,16 +76,28 @@ private:
     // Read-only
     uint32_t listen_port;
 
-    // Mutex used to access connections list
+    // Socket accepting new connections, -1 until acceptor creates it. Guarded by connections_mutex
+    int server_socket;
+
+    // Pool threads serving connections
+    std::vector<pthread_t> workers;
+
+    // Mutex used to access connections queue and list
     std::mutex connections_mutex;
 
-    // Conditional variable used to notify waiters about empty
-    // connections list
+    // Conditional variable used to notify workers about new connection
+    // in the queue or server stop
     std::condition_variable connections_cv;
 
-    // Threads that are processing connection data, permits
-    // access only from inside of accept_thread
-    std::unordered_set<pthread_t> connections;
+    // Conditional variable used to notify acceptor about free space
+    // in the queue or server stop
+    std::condition_variable pending_cv;
+
+    // Accepted connections waiting for a free worker
+    std::deque<int> pending;
+
+    // Sockets of connections being served by workers
+    std::unordered_set<int> connections;
 };
 
 } // namespace Blocking
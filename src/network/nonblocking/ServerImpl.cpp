@@ -24,10 +24,14 @@ namespace Network {
 namespace NonBlocking {
 
 // See Server.h
-ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps) : Server(ps) {}
+ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps, bool reuse_port, bool pin_cpu)
+    : Server(ps), reuse_port(reuse_port), pin_cpu(pin_cpu) {}
 
 // See Server.h
-ServerImpl::~ServerImpl() {}
+ServerImpl::~ServerImpl() {
+    Stop();
+    Join();
+}
 
 // See Server.h
 void ServerImpl::Start(uint32_t port, uint16_t n_workers) {
@@ -43,38 +47,15 @@ void ServerImpl::Start(uint32_t port, uint16_t n_workers) {
         throw std::runtime_error("Unable to mask SIGPIPE");
     }
 
-    // Create server socket
-    struct sockaddr_in server_addr;
-    std::memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;         // IPv4
-    server_addr.sin_port = htons(port);       // TCP port number
-    server_addr.sin_addr.s_addr = INADDR_ANY; // Bind to any address
-
-    int server_socket = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (server_socket == -1) {
-        throw std::runtime_error("Failed to open socket");
-    }
-
-    int opts = 1;
-    if (setsockopt(server_socket, SOL_SOCKET, 0, &opts, sizeof(opts)) == -1) {
-        close(server_socket);
-        throw std::runtime_error("Socket setsockopt() failed");
-    }
-
-    if (bind(server_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
-        close(server_socket);
-        throw std::runtime_error("Socket bind() failed");
-    }
-
-    make_socket_non_blocking(server_socket);
-    if (listen(server_socket, 5) == -1) {
-        close(server_socket);
-        throw std::runtime_error("Socket listen() failed");
-    }
-
+    // Either all workers accept from the single socket, or each gets own one bound to the same port
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
     for (int i = 0; i < n_workers; i++) {
-        workers.emplace_back(pStorage);
-        workers.back().Start(server_socket);
+        if (server_sockets.empty() || reuse_port) {
+            server_sockets.push_back(make_server_socket(port, reuse_port));
+        }
+
+        workers.emplace_back(new Worker(pStorage));
+        workers.back()->Start(server_sockets.back(), pin_cpu && cpus > 0 ? int(i % cpus) : -1);
     }
 }
 
@@ -82,7 +63,7 @@ void ServerImpl::Start(uint32_t port, uint16_t n_workers) {
 void ServerImpl::Stop() {
     std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
     for (auto &worker : workers) {
-        worker.Stop();
+        worker->Stop();
     }
 }
 
@@ -90,8 +71,14 @@ void ServerImpl::Stop() {
 void ServerImpl::Join() {
     std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
     for (auto &worker : workers) {
-        worker.Join();
+        worker->Join();
+    }
+    workers.clear();
+
+    for (int server_socket : server_sockets) {
+        close(server_socket);
     }
+    server_sockets.clear();
 }
 
 } // namespace NonBlocking
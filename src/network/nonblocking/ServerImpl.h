@@ -1,6 +1,7 @@
 #ifndef AFINA_NETWORK_NONBLOCKING_SERVER_H
 #define AFINA_NETWORK_NONBLOCKING_SERVER_H
 
+#include <memory>
 #include <vector>
 
 #include <afina/network/Server.h>
@@ -15,10 +16,18 @@ class Worker;
 /**
  * # Network resource manager implementation
  * Epoll based server
+ *
+ * By default all workers accept connections from the single listen socket. In reuse port mode every worker
+ * binds own SO_REUSEPORT socket, so kernel spreads connections between workers, optionally each worker
+ * thread could be pinned to a CPU. Connection never leaves worker that accepted it
  */
 class ServerImpl : public Server {
 public:
-    ServerImpl(std::shared_ptr<Afina::Storage> ps);
+    /**
+     * @param reuse_port give each worker own listen socket bound with SO_REUSEPORT
+     * @param pin_cpu pin worker threads to CPUs in round robin
+     */
+    ServerImpl(std::shared_ptr<Afina::Storage> ps, bool reuse_port = false, bool pin_cpu = false);
     ~ServerImpl();
 
     // See Server.h
@@ -31,13 +40,14 @@ public:
     void Join() override;
 
 private:
-    // Port to listen for new connections, permits access only from
-    // inside of accept_thread
-    // Read-only
-    uint32_t listen_port;
+    const bool reuse_port;
+    const bool pin_cpu;
 
-    // Thread that is accepting new connections
-    std::vector<Worker> workers;
+    // Sockets accepting new connections, either one shared by all workers or one per worker
+    std::vector<int> server_sockets;
+
+    // Threads serving connections, each runs own epoll
+    std::vector<std::unique_ptr<Worker>> workers;
 };
 
 } // namespace NonBlocking
@@ -2,7 +2,10 @@
 
 #include <stdexcept>
 
+#include <cstring>
+
 #include <fcntl.h>
+#include <netinet/in.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
@@ -27,6 +30,48 @@ void make_socket_non_blocking(int sfd) {
     }
 }
 
+int make_server_socket(uint32_t port, bool reuse_port) {
+    struct sockaddr_in server_addr;
+    std::memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;         // IPv4
+    server_addr.sin_port = htons(port);       // TCP port number
+    server_addr.sin_addr.s_addr = INADDR_ANY; // Bind to any address
+
+    int sfd = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sfd == -1) {
+        throw std::runtime_error("Failed to open socket");
+    }
+
+    int opts = 1;
+    if (setsockopt(sfd, SOL_SOCKET, SO_REUSEADDR, &opts, sizeof(opts)) == -1) {
+        close(sfd);
+        throw std::runtime_error("Socket setsockopt() failed");
+    }
+
+    if (reuse_port && setsockopt(sfd, SOL_SOCKET, SO_REUSEPORT, &opts, sizeof(opts)) == -1) {
+        close(sfd);
+        throw std::runtime_error("Socket setsockopt(SO_REUSEPORT) failed");
+    }
+
+    if (bind(sfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
+        close(sfd);
+        throw std::runtime_error("Socket bind() failed");
+    }
+
+    try {
+        make_socket_non_blocking(sfd);
+    } catch (std::runtime_error &) {
+        close(sfd);
+        throw;
+    }
+
+    if (listen(sfd, SOMAXCONN) == -1) {
+        close(sfd);
+        throw std::runtime_error("Socket listen() failed");
+    }
+    return sfd;
+}
+
 } // namespace NonBlocking
 } // namespace Network
 } // namespace Afina
@@ -1,12 +1,21 @@
 #ifndef AFINA_NETWORK_NONBLOCKING_UTILS_H
 #define AFINA_NETWORK_NONBLOCKING_UTILS_H
 
+#include <cstdint>
+
 namespace Afina {
 namespace Network {
 namespace NonBlocking {
 
 void make_socket_non_blocking(int sfd);
 
+/**
+ * Creates non-blocking socket listening on the given port of all interfaces
+ *
+ * @param reuse_port let other sockets bind the same port, kernel spreads incoming connections between them
+ */
+int make_server_socket(uint32_t port, bool reuse_port);
+
 } // namespace NonBlocking
 } // namespace Network
 } // namespace Afina
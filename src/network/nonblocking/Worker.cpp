@@ -1,10 +1,22 @@
 #include "Worker.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <stdexcept>
+#include <vector>
 
+#include <sched.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <afina/Storage.h>
 
 #include "Utils.h"
 
@@ -12,48 +24,389 @@ namespace Afina {
 namespace Network {
 namespace NonBlocking {
 
+// Maximum number of events taken by a single epoll_wait call
+static const int MaxEvents = 64;
+
+// Maximum number of responses written by a single sendmsg call
+static const size_t MaxWriteBatch = 64;
+
+// Connection stops reading new commands while that many response bytes are waiting to be written,
+// so client that doesn't read responses can't make server buffer them without bound
+static const size_t MaxOutputSize = 1024 * 1024;
+
+// Largest data block accepted from the client
+static const uint32_t MaxBodySize = 64 * 1024 * 1024;
+
+// Time given to connections to take their responses once worker is stopped, the rest are closed anyway
+static const std::chrono::milliseconds DrainTimeout(5000);
+
 // See Worker.h
-Worker::Worker(std::shared_ptr<Afina::Storage> ps) {
-    // TODO: implementation here
-}
+Worker::Worker(std::shared_ptr<Afina::Storage> ps)
+    : pStorage(ps), server_socket(-1), epoll_fd(-1), event_fd(-1), running(false), draining(false) {}
 
 // See Worker.h
 Worker::~Worker() {
-    // TODO: implementation here
+    Stop();
+    Join();
+
+    if (event_fd != -1) {
+        close(event_fd);
+    }
+    if (epoll_fd != -1) {
+        close(epoll_fd);
+    }
 }
 
 // See Worker.h
-void Worker::Start(int server_socket) {
+void Worker::Start(int server_socket, int cpu) {
     std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
-    // TODO: implementation here
+    this->server_socket = server_socket;
+
+    epoll_fd = epoll_create1(0);
+    if (epoll_fd == -1) {
+        throw std::runtime_error("Failed to create epoll");
+    }
+
+    event_fd = eventfd(0, EFD_NONBLOCK);
+    if (event_fd == -1) {
+        throw std::runtime_error("Failed to create eventfd");
+    }
+
+    // Server socket is level-triggered: worker accepts until EAGAIN anyway, but connection left
+    // in backlog by any reason must not be forgotten
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+#ifdef EPOLLEXCLUSIVE
+    ev.events |= EPOLLEXCLUSIVE;
+#endif
+    ev.data.ptr = &this->server_socket;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_socket, &ev) == -1) {
+        throw std::runtime_error("Failed to add server socket to epoll");
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = &event_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_fd, &ev) == -1) {
+        throw std::runtime_error("Failed to add eventfd to epoll");
+    }
+
+    running.store(true);
+    if (pthread_create(&thread, NULL, Worker::RunProxy, this) != 0) {
+        running.store(false);
+        throw std::runtime_error("Could not create worker thread");
+    }
+
+    // Failure to pin is not fatal, worker just runs wherever scheduler puts it
+    if (cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        if (pthread_setaffinity_np(thread, sizeof(cpus), &cpus) != 0) {
+            std::cerr << "Failed to pin worker to CPU " << cpu << std::endl;
+        }
+    }
 }
 
 // See Worker.h
 void Worker::Stop() {
     std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
-    // TODO: implementation here
+    if (event_fd == -1) {
+        return;
+    }
+
+    uint64_t one = 1;
+    if (write(event_fd, &one, sizeof(one)) != sizeof(one)) {
+        std::cerr << "Failed to signal worker: " << strerror(errno) << std::endl;
+    }
 }
 
 // See Worker.h
 void Worker::Join() {
     std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
-    // TODO: implementation here
+    if (running.exchange(false)) {
+        pthread_join(thread, NULL);
+    }
 }
 
 // See Worker.h
-void Worker::OnRun(void *args) {
+void *Worker::RunProxy(void *p) {
+    Worker *worker = reinterpret_cast<Worker *>(p);
+    try {
+        worker->OnRun();
+    } catch (std::exception &ex) {
+        std::cerr << "Worker fails: " << ex.what() << std::endl;
+    }
+    return 0;
+}
+
+// See Worker.h
+void Worker::OnRun() {
     std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
 
-    // TODO: implementation here
-    // 1. Create epoll_context here
-    // 2. Add server_socket to context
-    // 3. Accept new connections, don't forget to call make_socket_nonblocking on
-    //    the client socket descriptor
-    // 4. Add connections to the local context
-    // 5. Process connection events
-    //
-    // Do not forget to use EPOLLEXCLUSIVE flag when register socket
-    // for events to avoid thundering herd type behavior.
+    struct epoll_event events[MaxEvents];
+    bool stop = false;
+    while (!draining || !connections.empty()) {
+        // Client that never reads its responses can't hold the worker forever
+        int timeout = -1;
+        if (draining) {
+            auto left = drain_deadline - std::chrono::steady_clock::now();
+            timeout = std::chrono::duration_cast<std::chrono::milliseconds>(left).count();
+            if (timeout <= 0) {
+                std::cerr << "Drain timed out, closing " << connections.size() << " connections" << std::endl;
+                while (!connections.empty()) {
+                    Close(*connections.begin()->second);
+                }
+                break;
+            }
+        }
+
+        int n = epoll_wait(epoll_fd, events, MaxEvents, timeout);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Failed to wait for events");
+        }
+
+        for (int i = 0; i < n; i++) {
+            void *p = events[i].data.ptr;
+            if (p == &event_fd) {
+                uint64_t value;
+                if (read(event_fd, &value, sizeof(value)) > 0) {
+                    stop = true;
+                }
+                continue;
+            } else if (p == &server_socket) {
+                if (!draining) {
+                    OnAccept();
+                }
+                continue;
+            }
+
+            Connection &conn = *reinterpret_cast<Connection *>(p);
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                conn.readable = true;
+            }
+
+            // Reading stops once output queue gets too long and resumes as soon as socket accepts
+            // enough of it, all that without new events as socket is edge-triggered
+            bool alive = true;
+            do {
+                alive = OnRead(conn) && OnWrite(conn);
+            } while (alive && conn.readable && !conn.eof && conn.output_size < MaxOutputSize);
+
+            if (!alive || (conn.eof && conn.output.empty())) {
+                Close(conn);
+            }
+        }
+
+        // Connections referenced by the events processed above might be closed by Drain, so it
+        // runs once the whole batch is done
+        if (stop && !draining) {
+            Drain();
+        }
+    }
+
+    std::cout << "network debug: worker drained" << std::endl;
+}
+
+// See Worker.h
+void Worker::OnAccept() {
+    for (;;) {
+        int client_socket = accept(server_socket, NULL, NULL);
+        if (client_socket == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            // EAGAIN means connection was taken by other worker or backlog is empty
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "Failed to accept connection: " << strerror(errno) << std::endl;
+            }
+            return;
+        }
+
+        try {
+            make_socket_non_blocking(client_socket);
+        } catch (std::runtime_error &ex) {
+            std::cerr << ex.what() << std::endl;
+            close(client_socket);
+            continue;
+        }
+
+        std::unique_ptr<Connection> conn(new Connection(client_socket));
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = conn.get();
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_socket, &ev) == -1) {
+            std::cerr << "Failed to add connection to epoll: " << strerror(errno) << std::endl;
+            close(client_socket);
+            continue;
+        }
+
+        connections[client_socket] = std::move(conn);
+    }
+}
+
+// See Worker.h
+bool Worker::OnRead(Connection &conn) {
+    while (conn.readable && !conn.eof && conn.output_size < MaxOutputSize) {
+        ssize_t n = recv(conn.socket, conn.input + conn.input_used, sizeof(conn.input) - conn.input_used, 0);
+        if (n > 0) {
+            conn.input_used += n;
+            Process(conn);
+        } else if (n == 0) {
+            conn.eof = true;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            conn.readable = false;
+        } else if (errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// See Worker.h
+bool Worker::OnWrite(Connection &conn) {
+    while (!conn.output.empty()) {
+        struct iovec iov[MaxWriteBatch];
+        size_t count = 0;
+        for (auto it = conn.output.begin(); it != conn.output.end() && count < MaxWriteBatch; it++, count++) {
+            size_t offset = (count == 0 ? conn.output_offset : 0);
+            iov[count].iov_base = &(*it)[offset];
+            iov[count].iov_len = it->size() - offset;
+        }
+
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+
+        ssize_t n = sendmsg(conn.socket, &msg, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+
+        conn.output_size -= n;
+        size_t written = n + conn.output_offset;
+        while (!conn.output.empty() && written >= conn.output.front().size()) {
+            written -= conn.output.front().size();
+            conn.output.pop_front();
+        }
+        conn.output_offset = written;
+    }
+    return true;
+}
+
+// See Worker.h
+void Worker::Process(Connection &conn) {
+    size_t offset = 0;
+    try {
+        while (offset < conn.input_used && !conn.eof) {
+            if (!conn.cmd) {
+                // Parser reports number of bytes consumed from the given chunk, not from the buffer start
+                size_t parsed = 0;
+                bool complete = conn.parser.Parse(conn.input + offset, conn.input_used - offset, parsed);
+                offset += parsed;
+                if (!complete) {
+                    break;
+                }
+
+                uint32_t body_size = 0;
+                conn.parser.Build(body_size, conn.cmd, conn.keys, conn.key_ends);
+                if (body_size > MaxBodySize) {
+                    throw std::runtime_error("Data block is too large");
+                }
+                conn.body_size = conn.parser.HasBody() ? body_size + 2 : 0;
+                conn.body.clear();
+            }
+
+            if (conn.body_size > 0) {
+                size_t size = std::min(size_t(conn.body_size), conn.input_used - offset);
+                conn.body.append(conn.input + offset, size);
+                conn.body_size -= size;
+                offset += size;
+                if (conn.body_size > 0) {
+                    break;
+                }
+
+                if (conn.body.compare(conn.body.size() - 2, 2, "\r\n") != 0) {
+                    throw std::runtime_error("Invalid data block, \\r\\n expected");
+                }
+                conn.body.resize(conn.body.size() - 2);
+            }
+
+            Execute(conn);
+        }
+    } catch (std::runtime_error &ex) {
+        // Input stream can't be resynchronized after bad command, so it is the last one
+        Respond(conn, std::string("CLIENT_ERROR ") + ex.what());
+        conn.eof = true;
+        offset = conn.input_used;
+    } catch (std::exception &ex) {
+        // Command couldn't be taken in, e.g there is no memory for its data block
+        Respond(conn, std::string("SERVER_ERROR ") + ex.what());
+        conn.eof = true;
+        offset = conn.input_used;
+    }
+
+    conn.input_used -= offset;
+    std::memmove(conn.input, conn.input + offset, conn.input_used);
+}
+
+// See Worker.h
+void Worker::Execute(Connection &conn) {
+    // Failure of a single command must not unwind out of the worker loop, taking all its connections down
+    std::string out;
+    try {
+        conn.cmd.Execute(*pStorage, conn.body, out);
+    } catch (std::exception &ex) {
+        out = std::string("SERVER_ERROR ") + ex.what();
+    } catch (...) {
+        out = "SERVER_ERROR unknown error";
+    }
+    Respond(conn, std::move(out));
+
+    conn.cmd.Reset();
+    conn.body.clear();
+    conn.parser.Reset();
+}
+
+// See Worker.h
+void Worker::Respond(Connection &conn, std::string &&out) {
+    out.append("\r\n");
+    conn.output_size += out.size();
+    conn.output.push_back(std::move(out));
+}
+
+// See Worker.h
+void Worker::Drain() {
+    draining = true;
+    drain_deadline = std::chrono::steady_clock::now() + DrainTimeout;
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, server_socket, NULL);
+
+    std::vector<Connection *> idle;
+    for (auto &it : connections) {
+        it.second->eof = true;
+        if (it.second->output.empty()) {
+            idle.push_back(it.second.get());
+        }
+    }
+
+    for (Connection *conn : idle) {
+        Close(*conn);
+    }
+}
+
+// See Worker.h
+void Worker::Close(Connection &conn) {
+    int socket = conn.socket;
+    close(socket);
+    connections.erase(socket);
 }
 
 } // namespace NonBlocking
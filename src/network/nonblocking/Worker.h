@@ -1,8 +1,17 @@
 #ifndef AFINA_NETWORK_NONBLOCKING_WORKER_H
 #define AFINA_NETWORK_NONBLOCKING_WORKER_H
 
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <memory>
 #include <pthread.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <afina/execute/CommandSlot.h>
+#include <protocol/Parser.h>
 
 namespace Afina {
 
@@ -16,18 +25,28 @@ namespace NonBlocking {
  * # Thread running epoll
  * On Start spaws background thread that is doing epoll on the given server
  * socket and process incoming connections and its data
+ *
+ * Each worker owns its epoll instance and all connections it accepted. Server socket is shared
+ * by all workers and registered with EPOLLEXCLUSIVE, so a new connection wakes only one of them.
+ * Client sockets are edge-triggered: worker reads until EAGAIN and executes every complete
+ * command found in the input, responses are queued and written out as socket accepts them.
  */
 class Worker {
 public:
     Worker(std::shared_ptr<Afina::Storage> ps);
     ~Worker();
 
+    Worker(const Worker &) = delete;
+    Worker &operator=(const Worker &) = delete;
+
     /**
      * Spaws new background thread that is doing epoll on the given server
      * socket. Once connection accepted it must be registered and being processed
      * on this thread
+     *
+     * @param cpu pin thread to the given CPU, -1 lets scheduler move it freely
      */
-    void Start(int server_socket);
+    void Start(int server_socket, int cpu = -1);
 
     /**
      * Signal background thread to stop. After that signal thread must stop to
@@ -47,10 +66,115 @@ protected:
     /**
      * Method executing by background thread
      */
-    void OnRun(void *args);
+    void OnRun();
 
 private:
+    /**
+     * Client connection state
+     */
+    struct Connection {
+        Connection(int s)
+            : socket(s), input_used(0), body_size(0), output_offset(0), output_size(0), readable(false), eof(false) {}
+
+        int socket;
+
+        // Bytes received from the client but not consumed by the parser yet
+        char input[4096];
+        size_t input_used;
+
+        // Protocol parser, keeps state between chunks of input
+        Protocol::Parser parser;
+
+        // Key bytes of the current command, it borrows them from here
+        std::string keys;
+        std::vector<uint32_t> key_ends;
+
+        // Command parsed out from the input, waits for its body if body_size isn't zero. Slot is reused by
+        // every command of the connection
+        Execute::CommandSlot cmd;
+
+        // Number of body bytes, including trailing \r\n, left to read before command could be executed
+        uint32_t body_size;
+        std::string body;
+
+        // Responses waiting to be written, first one is written starting from output_offset
+        std::deque<std::string> output;
+        size_t output_offset;
+
+        // Total bytes in the output queue
+        size_t output_size;
+
+        // Socket may have unread input, cleared once recv returns EAGAIN
+        bool readable;
+
+        // No more commands will be read: client closed its side, sent garbage, or worker stops
+        bool eof;
+    };
+
+    static void *RunProxy(void *p);
+
+    /**
+     * Accepts all pending connections from the server socket
+     */
+    void OnAccept();
+
+    /**
+     * Reads input until socket is drained and executes complete commands. Returns false if
+     * connection must be closed
+     */
+    bool OnRead(Connection &conn);
+
+    /**
+     * Writes as much of output queue as socket accepts. Returns false if connection must be closed
+     */
+    bool OnWrite(Connection &conn);
+
+    /**
+     * Parses commands out of connection input and executes them. Parser errors are reported to
+     * the client and stop reading
+     */
+    void Process(Connection &conn);
+
+    /**
+     * Executes parsed command and queues its response
+     */
+    void Execute(Connection &conn);
+
+    /**
+     * Adds response line to the output queue
+     */
+    void Respond(Connection &conn, std::string &&out);
+
+    /**
+     * Stops accepting and reading, connections with empty output are closed right away. The rest get
+     * DrainTimeout to take their output and are closed after that
+     */
+    void Drain();
+
+    void Close(Connection &conn);
+
+    std::shared_ptr<Afina::Storage> pStorage;
+
     pthread_t thread;
+
+    // Server socket shared with other workers, not owned
+    int server_socket;
+
+    // Epoll instance of the worker and eventfd used to wake it up on Stop
+    int epoll_fd;
+    int event_fd;
+
+    // Thread is started and not joined yet
+    std::atomic<bool> running;
+
+    // Set on the worker thread once Stop is noticed
+    bool draining;
+
+    // Connections still open by that time are closed without writing out the rest of the output
+    std::chrono::steady_clock::time_point drain_deadline;
+
+    // Live connections by socket
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
 };
 
 } // namespace NonBlocking
@@ -0,0 +1,61 @@
+#include "BufferPool.h"
+
+#include <cassert>
+
+namespace Afina {
+namespace Network {
+namespace UV {
+
+// See BufferPool.h
+BufferPool::~BufferPool() {
+    for (auto &list : free) {
+        for (char *buf : list) {
+            delete[] buf;
+        }
+    }
+}
+
+// See BufferPool.h
+char *BufferPool::Get(size_t size) {
+    std::vector<char *> &list = free[Class(size)];
+    if (list.empty()) {
+        return new char[size];
+    }
+
+    char *buf = list.back();
+    list.pop_back();
+    return buf;
+}
+
+// See BufferPool.h
+void BufferPool::Put(char *buf, size_t size) {
+    std::vector<char *> &list = free[Class(size)];
+    if (list.size() >= MaxFree) {
+        delete[] buf;
+    } else {
+        list.push_back(buf);
+    }
+}
+
+// See BufferPool.h
+size_t BufferPool::Fit(size_t bytes) {
+    size_t size = MinSize;
+    while (size < bytes && size < MaxSize) {
+        size *= 4;
+    }
+    return size;
+}
+
+// See BufferPool.h
+size_t BufferPool::Class(size_t size) {
+    size_t result = 0;
+    for (size_t s = MinSize; s < size; s *= 4) {
+        result++;
+    }
+    assert(result < Classes && (MinSize << (2 * result)) == size);
+    return result;
+}
+
+} // namespace UV
+} // namespace Network
+} // namespace Afina
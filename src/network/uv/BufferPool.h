@@ -0,0 +1,66 @@
+#ifndef AFINA_NETWORK_UV_BUFFER_POOL_H
+#define AFINA_NETWORK_UV_BUFFER_POOL_H
+
+#include <cstddef>
+#include <vector>
+
+namespace Afina {
+namespace Network {
+namespace UV {
+
+/**
+ * # Pool of input buffers
+ * Buffers are handed out only for the time of a single read, so idle connections hold no memory at all. Sizes are
+ * powers of four between MinSize and MaxSize, each size has its own free list. Pool grows when free list is empty
+ * and gives memory back to the system once more than MaxFree buffers of the same size are idle.
+ *
+ * Pool isn't thread safe, each worker owns its own
+ */
+class BufferPool {
+public:
+    // Smallest buffer handed out
+    const static size_t MinSize = 4 * 1024L;
+
+    // Largest buffer handed out
+    const static size_t MaxSize = 64 * 1024L;
+
+    // How many idle buffers of each size are kept for reuse
+    const static size_t MaxFree = 64;
+
+    BufferPool() : free(Classes) {}
+    ~BufferPool();
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    /**
+     * Returns buffer of the given size, size must be the one returned by Fit
+     */
+    char *Get(size_t size);
+
+    /**
+     * Takes buffer back, size must be the one it has been taken with
+     */
+    void Put(char *buf, size_t size);
+
+    /**
+     * Returns smallest buffer size that could hold given number of bytes, but not larger than MaxSize
+     */
+    static size_t Fit(size_t bytes);
+
+private:
+    // Number of different buffer sizes
+    const static size_t Classes = 3;
+
+    // Index of the free list for the given buffer size
+    static size_t Class(size_t size);
+
+    // Free buffers, by size
+    std::vector<std::vector<char *>> free;
+};
+
+} // namespace UV
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_UV_BUFFER_POOL_H
@@ -1,10 +1,12 @@
 #include "ServerImpl.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <stdexcept>
-#include <sys/mman.h>
+#include <thread>
 
+#include <afina/Executor.h>
 #include <afina/Storage.h>
 
 namespace Afina {
@@ -12,7 +14,11 @@ namespace Network {
 namespace UV {
 
 // See Server.h
-ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps) : Server(ps) {}
+ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps, int executors) : Server(ps), executors(executors) {
+    if (this->executors <= 0) {
+        this->executors = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
 
 // See Server.h
 ServerImpl::~ServerImpl() { assert(workers.size() == 0); }
@@ -27,8 +33,9 @@ void ServerImpl::Start(uint32_t port, uint16_t n_workers) {
         throw std::runtime_error("Failed to call uv_ip4_addr");
     }
 
+    executor = std::make_shared<Afina::Executor>("uv-executor", executors);
     for (auto i = 0; i < n_workers; i++) {
-        workers.push_back(new Worker(pStorage));
+        workers.push_back(new Worker(pStorage, executor));
         workers[i]->Start(address);
     }
 }
@@ -44,6 +51,14 @@ void ServerImpl::Stop() {
 void ServerImpl::Join() {
     for (auto worker : workers) {
         worker->Join();
+        delete worker;
+    }
+    workers.clear();
+
+    // Workers wait for all their commands before stop, so executor has nothing left to do
+    if (executor) {
+        executor->Stop(true);
+        executor.reset();
     }
 }
 
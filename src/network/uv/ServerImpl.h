@@ -9,17 +9,22 @@
 #include "Worker.h"
 
 namespace Afina {
+class Executor;
 class Storage;
 namespace Network {
 namespace UV {
 
 /**
  * # Network resource manager implementation
- * Implementation on top of lib uv library
+ * Implementation on top of lib uv library. Event loops only do network IO, commands are executed on the
+ * thread pool shared by all workers
  */
 class ServerImpl : public Server {
 public:
-    ServerImpl(std::shared_ptr<Afina::Storage> ps);
+    /**
+     * @param executors number of threads executing commands, by default one per CPU
+     */
+    ServerImpl(std::shared_ptr<Afina::Storage> ps, int executors = 0);
     ~ServerImpl();
 
     // See Server.h
@@ -36,6 +41,16 @@ protected:
      * List of all workers created for this instance of server
      */
     std::vector<Worker *> workers;
+
+    /**
+     * Number of threads in the executor
+     */
+    int executors;
+
+    /**
+     * Thread pool executing commands
+     */
+    std::shared_ptr<Afina::Executor> executor;
 };
 
 } // namespace UV
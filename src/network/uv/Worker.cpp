@@ -1,14 +1,17 @@
 #include "Worker.h"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <cassert>
 #include <cstring>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
+#include <vector>
 
+#include <afina/Executor.h>
 #include <afina/Storage.h>
-#include <afina/execute/Command.h>
+#include <afina/execute/CommandSlot.h>
 
 namespace Afina {
 namespace Network {
@@ -53,6 +56,16 @@ template <typename T, typename... Types> struct delegate {
 
 void noop(uv_signal_t *handle, int signum) {}
 
+// Ends each response, written straight from here. libuv never modifies data it writes
+static char ResponseTrailer[] = "\r\n";
+
+// See Worker.h
+Worker::~Worker() {
+    for (ExecuteTask *ptask : freeTasks) {
+        delete ptask;
+    }
+}
+
 // See Worker.h
 void Worker::Start(const struct sockaddr_storage &address) {
     // Init loop
@@ -73,6 +86,15 @@ void Worker::Start(const struct sockaddr_storage &address) {
     }
     uvStopAsync.data = this;
 
+    // Init completion queue
+    rc = uv_async_init(&uvLoop, &uvDoneAsync, delegate<Worker>::callback<&Worker::OnExecutionDone>);
+    if (rc != 0) {
+        std::stringstream ss;
+        ss << "Failed to call uv_async_init: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
+        throw std::runtime_error(ss.str());
+    }
+    uvDoneAsync.data = this;
+
     // Init signals
     rc = uv_signal_init(&uvLoop, &uvSigPipe);
     if (rc != 0) {
@@ -164,6 +186,7 @@ void Worker::OnRun() {
 // See Worker.h
 void Worker::OnStop(uv_async_t *async) {
     std::cout << "network debug:" << __PRETTY_FUNCTION__ << std::endl;
+    stopping = true;
 
     // Stop accept new incomming connections
     uv_close((uv_handle_t *)&uvStopAsync, delegate<Worker>::callback<&Worker::OnHandleClosed>);
@@ -177,7 +200,7 @@ void Worker::OnStop(uv_async_t *async) {
         uv_read_stop((uv_stream_t *)conn);
 
         // Try to close connections if possible
-        if (conn->runningTasks == 0) {
+        if (conn->runningTasks == 0 && !uv_is_closing((uv_handle_t *)conn)) {
             uv_close((uv_handle_t *)conn, delegate<Worker>::callback<&Worker::OnConnectionClosed>);
         }
     }
@@ -200,6 +223,12 @@ void Worker::OnConnectionClosed(uv_handle_t *h) {
     Connection *pconn = reinterpret_cast<Connection *>(h);
     assert(pconn->runningTasks == 0);
 
+    // Connection could be closed in the middle of command
+    if (pconn->task != nullptr) {
+        ReleaseTask(pconn->task);
+        pconn->task = nullptr;
+    }
+
     if (alive.erase(pconn) != 0) {
         delete pconn;
     }
@@ -214,6 +243,12 @@ void Worker::OnConnectionClosed(uv_handle_t *h) {
 // See Worker.h
 void Worker::CloseEventLoppIfPossible() {
     if (alive.empty()) {
+        // No connection means no task on executor, so nobody could signal completion anymore
+        if (stopping && !uv_is_closing((uv_handle_t *)&uvDoneAsync)) {
+            std::lock_guard<std::mutex> lock(doneLock);
+            uv_close((uv_handle_t *)&uvDoneAsync, delegate<Worker>::callback<&Worker::OnHandleClosed>);
+        }
+
         // Loop can't be closed until at least one handler exists, so even code
         // below executed each time last connection closed it wont leads to
         // event loop close until there are onStopAsync,SigPipe and uvNetwork
@@ -240,7 +275,7 @@ void Worker::OnConnectionOpen(uv_stream_t *server, int status) {
     int rc = uv_accept(server, (uv_stream_t *)pconn);
     if (rc != 0) {
         std::cerr << "Failed to call uv_accept: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
-        uv_close((uv_handle_t *)(pconn), delegate<Worker>::callback<&Worker::OnHandleClosed>);
+        uv_close((uv_handle_t *)(pconn), delegate<Worker>::callback<&Worker::OnConnectionClosed>);
         return;
     }
 
@@ -249,32 +284,54 @@ void Worker::OnConnectionOpen(uv_stream_t *server, int status) {
                        delegate<Worker, ssize_t, const uv_buf_t *>::callback<&Worker::OnRead>);
     if (rc != 0) {
         std::cerr << "Failed to call uv_read_start: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
-        uv_close((uv_handle_t *)(pconn), delegate<Worker>::callback<&Worker::OnHandleClosed>);
+        uv_close((uv_handle_t *)(pconn), delegate<Worker>::callback<&Worker::OnConnectionClosed>);
         return;
     }
 }
 
 // Just before read, libuv calls that method to allocate some memory chunk where read copies socket data.
-// We are always allocate memorythere until all incoming data fits, parse it and deallocate buffer just after that.
+// Buffer is taken from the worker pool and given back as soon as read data is parsed, so idle connections
+// hold no memory. Parser and body reader always consume everything, so nothing is carried over between reads
 // See Worker.h
 void Worker::OnAllocate(uv_handle_t *conn, size_t suggested_size, uv_buf_t *buf) {
     assert(conn);
 
     Connection *pconn = (Connection *)(conn);
-    assert(pconn->input_parsed <= pconn->input_used);
-
-    size_t unparsed = pconn->input_used - pconn->input_parsed;
-    std::memmove(pconn->input, pconn->input + pconn->input_parsed, unparsed);
+    assert(pconn->input == nullptr);
 
+    pconn->input_size = pconn->input_hint;
+    pconn->input = inputBuffers.Get(pconn->input_size);
     pconn->input_parsed = 0;
-    pconn->input_used = unparsed;
+    pconn->input_used = 0;
+
+    buf->base = pconn->input;
+    buf->len = pconn->input_size;
+}
+
+// See Worker.h
+void Worker::ReleaseInput(Connection &pconn, ssize_t nread) {
+    if (pconn.input == nullptr) {
+        return;
+    }
+    assert(pconn.input_parsed == pconn.input_used);
+
+    // Next read gets larger buffer if this one was filled up, and smaller one if it was mostly empty. Socket
+    // drained (nread == 0) says nothing about the size of data
+    if (nread > 0 && size_t(nread) == pconn.input_size) {
+        pconn.input_hint = BufferPool::Fit(pconn.input_size + 1);
+    } else if (nread > 0 && size_t(nread) < pconn.input_size / 4) {
+        pconn.input_hint = BufferPool::Fit(pconn.input_size / 4);
+    }
 
-    buf->base = &pconn->input[unparsed];
-    buf->len = ConnectionInputBufferSize - unparsed;
+    inputBuffers.Put(pconn.input, pconn.input_size);
+    pconn.input = nullptr;
+    pconn.input_size = 0;
+    pconn.input_parsed = 0;
+    pconn.input_used = 0;
 }
 
 // Once soket is ready to give some bytes back to application libuv calls that method,
-// buf that we received points somewere inside connection input buffer, so once some
+// buf that we received points to the connection input buffer, so once some
 // data read, pconn->in writer position must be updated
 // See Worker.h
 void Worker::OnRead(uv_stream_t *conn, ssize_t nread, const uv_buf_t *buf) {
@@ -282,11 +339,18 @@ void Worker::OnRead(uv_stream_t *conn, ssize_t nread, const uv_buf_t *buf) {
     assert(conn != nullptr);
     Connection *pconn = (Connection *)(conn);
 
-    // negative nread indicates that socket has been closed
+    // negative nread indicates that socket has been closed, connection could be released only once
+    // all its commands are done
     if (nread < 0) {
-        uv_close((uv_handle_t *)(pconn), delegate<Worker>::callback<&Worker::OnConnectionClosed>);
+        ReleaseInput(*pconn, nread);
+        pconn->state = ConnectionState::sClosed;
+        uv_read_stop(conn);
+        if (pconn->runningTasks == 0) {
+            uv_close((uv_handle_t *)(pconn), delegate<Worker>::callback<&Worker::OnConnectionClosed>);
+        }
         return;
     } else if (pconn->state == ConnectionState::sClosed) {
+        ReleaseInput(*pconn, -1);
         return;
     }
 
@@ -297,30 +361,53 @@ void Worker::OnRead(uv_stream_t *conn, ssize_t nread, const uv_buf_t *buf) {
         while (pconn->input_parsed < pconn->input_used) {
             // Read header or body if needs
             if (pconn->state == ConnectionState::sRecvHeader) {
-                // Try to parse command out
-                if (!pconn->parser.Parse(pconn->input, pconn->input_used, pconn->input_parsed)) {
+                // Try to parse command out. Parser reports number of bytes consumed from the given
+                // chunk, not from the buffer start
+                size_t parsed = 0;
+                bool complete = pconn->parser.Parse(pconn->input + pconn->input_parsed,
+                                                    pconn->input_used - pconn->input_parsed, parsed);
+                pconn->input_parsed += parsed;
+                if (!complete) {
                     continue;
                 }
 
                 // Command has been parsed form input
-                pconn->cmd = pconn->parser.Build(pconn->body_size);
+                pconn->task = NewTask(*pconn);
+                pconn->parser.Build(pconn->body_size, pconn->task->cmd, pconn->task->keys, pconn->task->key_ends);
+                if (pconn->body_size > MaxBodySize) {
+                    throw std::runtime_error("Data block is too large");
+                }
 
                 // Command has argument that needs to be read from the network connection before execution could take
-                // place
+                // place. Empty data block still has its trailer
                 if (pconn->body_size > 0) {
-                    pconn->body.clear();
                     pconn->state = ConnectionState::sRecvBody;
+
+                    // Large value of set is collected right into the reserved storage value instead of the task
+                    // argument, so it is copied once and never reallocated
+                    Execute::Set *set = pconn->task->cmd.As<Execute::Set>();
+                    if (set != nullptr && pconn->body_size >= DirectBodySize) {
+                        set->Reserve(*pStorage, pconn->body_size);
+                        pconn->body_direct = set;
+                    }
+                } else if (pconn->parser.HasBody()) {
+                    pconn->state = ConnectionState::sRecvTrailerCR;
                 } else {
                     pconn->state = ConnectionState::sExecute;
                 }
             } else if (pconn->state == ConnectionState::sRecvBody) {
                 size_t for_copy = std::min(uint32_t(pconn->input_used - pconn->input_parsed), pconn->body_size);
-                pconn->body.append(pconn->input + pconn->input_parsed, for_copy);
+                if (pconn->body_direct != nullptr) {
+                    pconn->body_direct->Append(pconn->input + pconn->input_parsed, for_copy);
+                } else {
+                    pconn->task->argument.append(pconn->input + pconn->input_parsed, for_copy);
+                }
 
                 pconn->body_size -= for_copy;
                 pconn->input_parsed += for_copy;
 
                 if (pconn->body_size == 0) {
+                    pconn->body_direct = nullptr;
                     pconn->state = ConnectionState::sRecvTrailerCR;
                 }
             } else if (pconn->state == ConnectionState::sRecvTrailerCR) {
@@ -339,37 +426,39 @@ void Worker::OnRead(uv_stream_t *conn, ssize_t nread, const uv_buf_t *buf) {
 
             if (pconn->state == ConnectionState::sExecute) {
                 Execute(*pconn);
-
-                pconn->cmd.reset();
-                pconn->body.clear();
                 pconn->parser.Reset();
                 pconn->state = ConnectionState::sRecvHeader;
             }
         }
     } catch (std::runtime_error &ex) {
-        // Parser throws exception in case if something goes wrong with input data format
-        // TODO: That code duplicates too much of OnExecutionDone - refactor
+        // Parser throws exception in case if something goes wrong with input data format. Stream can't be
+        // parsed any further, so error is the last response
         std::stringstream ss;
         ss << "CLIENT_ERROR " << ex.what();
+        Abort(*pconn, ss.str());
+    } catch (std::exception &ex) {
+        // Command couldn't be taken in, e.g there is no memory for its data block
+        std::stringstream ss;
+        ss << "SERVER_ERROR " << ex.what();
+        Abort(*pconn, ss.str());
+    }
 
-        std::string output = ss.str();
-
-        ExecuteTask *ptask = new ExecuteTask();
-        ptask->connection = pconn;
-        uv_async_init(&uvLoop, &ptask->done, delegate<Worker>::callback<&Worker::OnExecutionDone>);
-        ptask->done.data = this;
+    ReleaseInput(*pconn, nread);
+    Dispatch(*pconn);
+}
 
-        size_t size = output.size() + 2;
-        ptask->result.base = new char[size];
-        ptask->result.len = size;
+// See Worker.h
+void Worker::Abort(Connection &pconn, const std::string &output) {
+    Respond(pconn, output);
 
-        std::memcpy(ptask->result.base, &output[0], size - 2);
-        ptask->result.base[size - 2] = '\r';
-        ptask->result.base[size - 1] = '\n';
+    pconn.state = ConnectionState::sClosed;
+    pconn.input_parsed = pconn.input_used;
+    pconn.body_direct = nullptr;
+    uv_read_stop(&pconn.handler);
 
-        pconn->runningTasks++;
-        pconn->state = ConnectionState::sClosed;
-        OnExecutionDone(&ptask->done);
+    if (pconn.task != nullptr) {
+        ReleaseTask(pconn.task);
+        pconn.task = nullptr;
     }
 }
 
@@ -377,64 +466,200 @@ void Worker::OnRead(uv_stream_t *conn, ssize_t nread, const uv_buf_t *buf) {
 void Worker::Execute(Connection &pconn) {
     std::cout << "network debug:" << __PRETTY_FUNCTION__ << std::endl;
 
-    // Setup execution params
-    ExecuteTask *ptask = new ExecuteTask();
-    ptask->connection = &pconn;
-    ptask->cmd = std::move(pconn.cmd);
-    ptask->argument = std::move(pconn.body);
+    // Task waits in the connection queue until previous commands are done
+    ExecuteTask *ptask = pconn.task;
+    pconn.task = nullptr;
+
+    pconn.runningTasks++;
+    pconn.waiting.push_back(ptask);
+}
+
+// See Worker.h
+void Worker::Respond(Connection &pconn, const std::string &output) {
+    ExecuteTask *ptask = NewTask(pconn);
+    ptask->output.text = output;
+
     pconn.runningTasks++;
+    pconn.waiting.push_back(ptask);
+}
 
-    // Setup async signal to be called once task execution is complete
-    int rc = uv_async_init(&uvLoop, &ptask->done, delegate<Worker>::callback<&Worker::OnExecutionDone>);
-    if (rc != 0) {
-        throw std::runtime_error("Failed to call uv_async_init for the task");
+// See Worker.h
+Worker::ExecuteTask *Worker::NewTask(Connection &pconn) {
+    ExecuteTask *ptask;
+    if (freeTasks.empty()) {
+        ptask = new ExecuteTask();
+    } else {
+        ptask = freeTasks.back();
+        freeTasks.pop_back();
     }
-    ptask->done.data = this;
 
-    // TODO: That should be in another thread
-    {
-        std::string output;
-        try {
-            ptask->cmd->Execute(*pStorage, ptask->argument, output);
-        } catch (std::runtime_error &ex) {
-            std::cerr << "Failed to execute command: " << ex.what() << std::endl;
-
-            std::stringstream ss;
-            ss << "SERVER_ERROR " << ex.what();
-            output = ss.str();
+    ptask->connection = &pconn;
+    return ptask;
+}
+
+// See Worker.h
+void Worker::ReleaseTask(ExecuteTask *ptask) {
+    if (freeTasks.size() >= MaxFreeTasks) {
+        delete ptask;
+        return;
+    }
+
+    // Strings keep their memory for the next command, unless it is too much to keep around
+    ptask->cmd.Reset();
+    if (ptask->argument.capacity() > DirectBodySize) {
+        std::string().swap(ptask->argument);
+    }
+    if (ptask->keys.capacity() > DirectBodySize) {
+        std::string().swap(ptask->keys);
+        std::vector<uint32_t>().swap(ptask->key_ends);
+    }
+    if (ptask->output.text.capacity() > DirectBodySize) {
+        std::string().swap(ptask->output.text);
+    }
+    ptask->argument.clear();
+    ptask->keys.clear();
+    ptask->key_ends.clear();
+    ptask->output.clear(); // unpins values
+    ptask->connection = nullptr;
+    ptask->complete = false;
+    ptask->last = false;
+    freeTasks.push_back(ptask);
+}
+
+// See Worker.h
+void Worker::Dispatch(Connection &pconn) {
+    if (pconn.busy || pconn.waiting.empty()) {
+        return;
+    }
+
+    std::vector<ExecuteTask *> batch(pconn.waiting.begin(), pconn.waiting.end());
+    pconn.executing.insert(pconn.executing.end(), batch.begin(), batch.end());
+    batch.back()->last = true;
+    pconn.waiting.clear();
+    pconn.busy = true;
+
+    // Commands run one after another, so pipelined ones see effects of the previous. Each task is reported back
+    // as soon as it is done
+    std::shared_ptr<Afina::Storage> storage = pStorage;
+    auto run = [this, storage, batch]() {
+        for (ExecuteTask *ptask : batch) {
+            RunTask(*storage, ptask);
+            Complete(ptask);
         }
+    };
+
+    // Executor is stopped after all workers, but run inline anyway rather than lose commands
+    if (!pExecutor->Execute(run)) {
+        run();
+    }
+}
 
-        // Prepare output
-        size_t size = output.size() + 2;
-        ptask->result.base = new char[size];
-        ptask->result.len = size;
+// See Worker.h
+void Worker::RunTask(Afina::Storage &storage, ExecuteTask *ptask) {
+    // Tasks without command carry prepared response
+    if (!ptask->cmd) {
+        return;
+    }
 
-        std::memcpy(ptask->result.base, &output[0], size - 2);
-        ptask->result.base[size - 2] = '\r';
-        ptask->result.base[size - 1] = '\n';
+    // Whatever command throws, task has to be completed with a reply, or connection would wait for it forever
+    try {
+        ptask->cmd.Execute(storage, ptask->argument, ptask->output);
+    } catch (std::exception &ex) {
+        std::cerr << "Failed to execute command: " << ex.what() << std::endl;
 
-        // Notify event loop about task completition
-        uv_async_send(&ptask->done);
+        std::stringstream ss;
+        ss << "SERVER_ERROR " << ex.what();
+        ptask->output.clear();
+        ptask->output.text = ss.str();
+    } catch (...) {
+        std::cerr << "Failed to execute command: unknown error" << std::endl;
+        ptask->output.clear();
+        ptask->output.text = "SERVER_ERROR unknown error";
+    }
+}
+
+// See Worker.h
+void Worker::Complete(ExecuteTask *ptask) {
+    std::lock_guard<std::mutex> lock(doneLock);
+
+    // Loop has been woken up already if queue isn't empty, it will take this task as well
+    bool wakeup = doneTasks.empty();
+    doneTasks.push_back(ptask);
+    if (wakeup) {
+        uv_async_send(&uvDoneAsync);
     }
 }
 
 // See Worker.h
 void Worker::OnExecutionDone(uv_async_t *handle) {
     std::cout << "network debug:" << __PRETTY_FUNCTION__ << std::endl;
+    assert(handle == &uvDoneAsync);
+
+    {
+        std::lock_guard<std::mutex> lock(doneLock);
+        doneBatch.swap(doneTasks);
+    }
+
+    for (ExecuteTask *ptask : doneBatch) {
+        Connection *pconn = ptask->connection;
+        ptask->complete = true;
+
+        // Once batch is done, commands arrived meanwhile could be executed
+        if (ptask->last) {
+            pconn->busy = false;
+            Dispatch(*pconn);
+        }
+
+        if (!pconn->flushing) {
+            pconn->flushing = true;
+            doneConnections.push_back(pconn);
+        }
+    }
+    doneBatch.clear();
+
+    // Everything done for the connection on this wakeup goes out by a single write
+    for (Connection *pconn : doneConnections) {
+        pconn->flushing = false;
+        Flush(*pconn);
+    }
+    doneConnections.clear();
+}
 
-    assert(handle);
-    ExecuteTask *task = (ExecuteTask *)((uint8_t *)handle - offsetof(ExecuteTask, done));
-    assert(&task->done == handle);
+// See Worker.h
+void Worker::Flush(Connection &pconn) {
+    if (pconn.executing.empty() || !pconn.executing.front()->complete) {
+        return;
+    }
 
-    // We don't need async anymore
-    uv_close((uv_handle_t *)&task->done, delegate<Worker>::callback<&Worker::OnHandleClosed>);
+    // Send buffers to socket in order commands arrived. Even if connection is already closed we are still try
+    // to write data out, that would lead to possible write error which is ok and will be handled in the OnWriteDone
+    WriteRequest *preq = new WriteRequest();
+    preq->handler.data = this;
+    preq->connection = &pconn;
+
+    writeBuffers.clear();
+    while (!pconn.executing.empty() && pconn.executing.front()->complete) {
+        ExecuteTask *ptask = pconn.executing.front();
+        pconn.executing.pop_front();
+
+        preq->tasks.push_back(ptask);
+
+        // Values are written right from the storage memory, task keeps them pinned until OnWriteDone
+        std::string &text = ptask->output.text;
+        size_t pos = 0;
+        for (auto &value : ptask->output.values) {
+            writeBuffers.push_back(uv_buf_init(&text[pos], value.first - pos));
+            writeBuffers.push_back(uv_buf_init(const_cast<char *>(value.second.data()), value.second.size()));
+            pos = value.first;
+        }
+        writeBuffers.push_back(uv_buf_init(&text[pos], text.size() - pos));
+        writeBuffers.push_back(uv_buf_init(ResponseTrailer, sizeof(ResponseTrailer) - 1));
+    }
 
-    // Send buffer to socket. Even if connection is already closed we are still try to write data out,
-    // that would lead to possible write error which is ok and will be handled in the OnWriteDone
-    int rc = uv_write(&task->handler, &task->connection->handler, &task->result, 1,
+    int rc = uv_write(&preq->handler, &pconn.handler, writeBuffers.data(), writeBuffers.size(),
                       delegate<Worker, int>::callback<&Worker::OnWriteDone>);
     if (rc != 0) {
-        throw std::runtime_error("Failed to write request");
+        OnWriteDone(&preq->handler, rc);
     }
 }
 
@@ -442,16 +667,18 @@ void Worker::OnExecutionDone(uv_async_t *handle) {
 void Worker::OnWriteDone(uv_write_t *req, int status) {
     std::cout << "network debug:" << __PRETTY_FUNCTION__ << std::endl;
     assert(req != nullptr);
-    ExecuteTask *task = (ExecuteTask *)req;
-    Connection *pconn = task->connection;
+    WriteRequest *preq = (WriteRequest *)req;
+    Connection *pconn = preq->connection;
 
-    task->connection->runningTasks--;
-    if (task->connection->state == ConnectionState::sClosed && task->connection->runningTasks == 0) {
-        uv_close((uv_handle_t *)(task->connection), delegate<Worker>::callback<&Worker::OnConnectionClosed>);
+    pconn->runningTasks -= preq->tasks.size();
+    if (pconn->state == ConnectionState::sClosed && pconn->runningTasks == 0) {
+        uv_close((uv_handle_t *)(pconn), delegate<Worker>::callback<&Worker::OnConnectionClosed>);
     }
 
-    delete[] task->result.base;
-    delete task;
+    for (ExecuteTask *ptask : preq->tasks) {
+        ReleaseTask(ptask);
+    }
+    delete preq;
 }
 
 } // namespace UV
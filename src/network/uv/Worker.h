@@ -1,19 +1,22 @@
 #ifndef AFINA_NETWORK_UV_WORKER_H
 #define AFINA_NETWORK_UV_WORKER_H
 
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_set>
 #include <uv.h>
 #include <vector>
 
-#include <afina/execute/Command.h>
+#include <afina/execute/CommandSlot.h>
 #include <protocol/Parser.h>
 
+#include "BufferPool.h"
+
 namespace Afina {
+class Executor;
 class Storage;
-namespace Execute {
-class Command;
-}
 namespace Network {
 namespace UV {
 
@@ -21,11 +24,17 @@ namespace UV {
  * # Basic network data processor
  * Reads and writes byte streams from/to clients, parse protocol and submit commands to the execution. Implements
  * logic protocol
+ *
+ * Commands are executed on the thread pool shared by all workers, so slow command doesn't stall event loop. Commands
+ * of the same connection are executed one after another in the order they arrived, and responses are written in the
+ * same order. Executor threads report done tasks through the completion queue of the worker, loop picks up everything
+ * queued on a single wakeup
  */
 class Worker {
 public:
-    Worker(std::shared_ptr<Afina::Storage> pStorage) : pStorage(pStorage) {}
-    ~Worker() {}
+    Worker(std::shared_ptr<Afina::Storage> pStorage, std::shared_ptr<Afina::Executor> pExecutor)
+        : stopping(false), pStorage(pStorage), pExecutor(pExecutor) {}
+    ~Worker();
 
     Worker(const Worker &) = delete;
     Worker &operator=(const Worker &) = delete;
@@ -48,8 +57,14 @@ public:
     void Join();
 
 protected:
-    // Size of input buffer
-    const static size_t ConnectionInputBufferSize = 64 * 1024L;
+    // Data blocks of set that large are collected directly into the storage value
+    const static size_t DirectBodySize = 16 * 1024L;
+
+    // Largest data block accepted from the client
+    const static uint32_t MaxBodySize = 64 * 1024 * 1024L;
+
+    // How many released tasks are kept for reuse
+    const static size_t MaxFreeTasks = 1024;
 
     // Determinates how connection reacts on different async events, such as
     // new input data or command execution complete
@@ -75,6 +90,9 @@ protected:
         sClosed
     };
 
+    // Forward declaration, see below
+    struct ExecuteTask;
+
     /**
      * Holds information about single connection from the client
      */
@@ -86,9 +104,15 @@ protected:
         // Current connection state, defines how buffered data processed
         ConnectionState state;
 
-        // Buffer for input
+        // Buffer for input, taken from the worker pool only for the time of a single read
         char *input;
 
+        // Size of the input buffer
+        size_t input_size;
+
+        // Size of the buffer to take for the next read, adapts to how much data each read brings
+        size_t input_hint;
+
         // HOw many bytes in input buffer if already used
         size_t input_used;
 
@@ -98,26 +122,39 @@ protected:
         // State of the header parser
         Protocol::Parser parser;
 
-        // Command parsed out from the input
-        std::unique_ptr<Execute::Command> cmd;
+        // Task being read: command parsed out from the input and its argument, nullptr until command header
+        // is parsed
+        ExecuteTask *task;
 
         // Number of bytes left to read to get command
         uint32_t body_size;
 
-        // Argument for the command
-        std::string body;
+        // Command of the current task if its data block is collected directly into the storage value, nullptr
+        // otherwise
+        Execute::Set *body_direct;
 
-        // Number of tasks that are running now
+        // Number of tasks created for the connection and not written out yet
         size_t runningTasks;
 
+        // Tasks waiting for the previous batch to be executed, in order of arrival
+        std::deque<ExecuteTask *> waiting;
+
+        // Tasks passed to the executor, in order of arrival. Responses are written from the front as soon as
+        // tasks there get done
+        std::deque<ExecuteTask *> executing;
+
+        // Batch of tasks of this connection is running on the executor
+        bool busy;
+
+        // Connection has done tasks to be written out at the end of current loop iteration
+        bool flushing;
+
         Connection()
-            : state(ConnectionState::sRecvHeader), input(nullptr), input_used(0), input_parsed(0), cmd(nullptr),
-              body_size(0), body(""), runningTasks(0) {
-            input = new char[ConnectionInputBufferSize];
+            : state(ConnectionState::sRecvHeader), input(nullptr), input_size(0), input_hint(BufferPool::MinSize),
+              input_used(0), input_parsed(0), task(nullptr), body_size(0), body_direct(nullptr),
+              runningTasks(0), busy(false), flushing(false) {
             parser.Reset();
         }
-
-        ~Connection() { delete[] input; }
     } Connection;
 
     /**
@@ -125,25 +162,47 @@ protected:
      * some command
      */
     typedef struct ExecuteTask {
-        // Write handler, used to send this task through the libuv write pipeline
-        uv_write_t handler;
-
-        // Async signal to be called once task execution is complete
-        uv_async_t done;
-
         // Connection that received command, used to write out response
         Connection *connection;
 
-        // Command to execute
-        std::unique_ptr<Execute::Command> cmd;
+        // Command to execute, empty for the prepared responses
+        Execute::CommandSlot cmd;
+
+        // Key bytes of the command and offset past the end of each key, taken from the parser so that command
+        // could borrow them while parser goes on with the next one
+        std::string keys;
+        std::vector<uint32_t> key_ends;
 
         // Argument for the command
         std::string argument;
 
-        // Execution result
-        uv_buf_t result;
+        // Execution result, without \r\n trailer. Values referenced by the result stay pinned until it
+        // is written out
+        Execute::Response output;
+
+        // Command has been executed and result could be written
+        bool complete;
+
+        // Task is the last one in the batch passed to executor
+        bool last;
     } ExecuteTask;
 
+    /**
+     * Responses of several tasks of the same connection written out by a single uv_write call. Each task
+     * contributes pieces of its output text, values it references and trailer as separate buffers, so
+     * neither output nor storage values are copied
+     */
+    typedef struct WriteRequest {
+        // Write handler, used to send responses through the libuv write pipeline
+        uv_write_t handler;
+
+        // Connection responses are written to
+        Connection *connection;
+
+        // Tasks which responses are written, released once write is done
+        std::vector<ExecuteTask *> tasks;
+    } WriteRequest;
+
     /**
      * Called by thread once started, while this method is running Worker considered as alive
      */
@@ -181,25 +240,72 @@ protected:
      */
     void OnAllocate(uv_handle_t *, size_t suggested_size, uv_buf_t *buf);
 
+    /**
+     * Gives input buffer of the connection back to the pool once read data is parsed. Number of bytes read
+     * is used to pick buffer size for the next read, negative if nothing was read
+     */
+    void ReleaseInput(Connection &pconn, ssize_t nread);
+
     /**
      * Connection is ready to read data
      */
     void OnRead(uv_stream_t *, ssize_t nread, const uv_buf_t *buf);
 
     /**
-     * Execute last command readed from the connection. Once method return all fields in connection allocated for the
-     * command will be released, so implementation must take care to copy/move data somewhere else in case it needs
-     * for a time  longer then function execution
+     * Queues task readed from the connection for the execution, connection starts reading next one
      */
     void Execute(Connection &pconn);
 
     /**
-     * Called once command execution is complete
+     * Queues response to the connection without executing anything, used to report errors
+     */
+    void Respond(Connection &pconn, const std::string &output);
+
+    /**
+     * Responds with the error and closes connection once response is written, command being read is dropped
+     */
+    void Abort(Connection &pconn, const std::string &output);
+
+    /**
+     * Passes all waiting tasks of the connection to the executor as a single batch, unless previous batch is
+     * still running
+     */
+    void Dispatch(Connection &pconn);
+
+    /**
+     * Returns task for the connection, reusing one released before if possible
+     */
+    ExecuteTask *NewTask(Connection &pconn);
+
+    /**
+     * Gives task back for reuse once its response is written or it won't be executed at all
+     */
+    void ReleaseTask(ExecuteTask *ptask);
+
+    /**
+     * Runs command of the task, called on executor thread
+     */
+    static void RunTask(Afina::Storage &storage, ExecuteTask *ptask);
+
+    /**
+     * Puts executed task into the completion queue and wakes up event loop if queue was empty. Called on executor
+     * thread, task must not be touched after that
+     */
+    void Complete(ExecuteTask *ptask);
+
+    /**
+     * Called once some commands execution is complete, takes all tasks from the completion queue
      */
     void OnExecutionDone(uv_async_t *handle);
 
     /**
-     * Called by libuv once ExecuteTask output buffer has been written to the output connection
+     * Writes out responses of all the connection tasks that are done by a single request, in order commands
+     * arrived
+     */
+    void Flush(Connection &pconn);
+
+    /**
+     * Called by libuv once WriteRequest buffers has been written to the output connection
      */
     void OnWriteDone(uv_write_t *req, int status);
 
@@ -234,11 +340,55 @@ private:
      */
     uv_async_t uvStopAsync;
 
+    /**
+     * Async used by executor threads to report done tasks, closed once the last connection is gone
+     */
+    uv_async_t uvDoneAsync;
+
+    /**
+     * Completion queue: executed tasks not seen by the event loop yet. Executor threads signal uvDoneAsync
+     * while holding the lock, so loop can't close the handle in between
+     */
+    std::mutex doneLock;
+    std::vector<ExecuteTask *> doneTasks;
+
+    /**
+     * Tasks taken out of the completion queue on the last wakeup, kept to reuse its memory. Accessed only by the
+     * event loop
+     */
+    std::vector<ExecuteTask *> doneBatch;
+
+    /**
+     * Connections got done tasks on the last wakeup, each one is flushed once all tasks are processed
+     */
+    std::vector<Connection *> doneConnections;
+
+    /**
+     * Buffers of the write request being built, kept to reuse its memory. libuv copies them on uv_write
+     */
+    std::vector<uv_buf_t> writeBuffers;
+
+    /**
+     * Stop has been requested, loop shuts down as soon as all connections are closed
+     */
+    bool stopping;
+
     /**
      * TCP/IP socket used by server to listen for incomming connection
      */
     uv_tcp_t uvNetwork;
 
+    /**
+     * Released tasks ready for reuse, so that command gets to the executor without heap allocations. Accessed
+     * only by the event loop
+     */
+    std::vector<ExecuteTask *> freeTasks;
+
+    /**
+     * Input buffers shared by all connections of the worker
+     */
+    BufferPool inputBuffers;
+
     /**
      * List of all "alive" connections, some of it could be in closed state, but can't be removed yet
      * due to running commands
@@ -249,6 +399,11 @@ private:
      * Storage instance to execute commands on
      */
     std::shared_ptr<Afina::Storage> pStorage;
+
+    /**
+     * Thread pool to execute commands on, shared by all workers
+     */
+    std::shared_ptr<Afina::Executor> pExecutor;
 };
 
 } // namespace UV
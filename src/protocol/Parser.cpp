@@ -1,40 +1,102 @@
 #include "Parser.h"
 
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 
-#include <afina/execute/Add.h>
-#include <afina/execute/Append.h>
-#include <afina/execute/Command.h>
-#include <afina/execute/Delete.h>
-#include <afina/execute/Get.h>
-#include <afina/execute/Set.h>
-#include <afina/execute/Stats.h>
+#include <afina/execute/CommandSlot.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 namespace Afina {
 namespace Protocol {
 
+// Input shorter than that is parsed char by char even if parser is vectorized
+static const size_t VectorizedMinInput = 16;
+
+// Returns position of the first space or \r in the input, or size if there is none
+static size_t FindDelimiter(const char *input, size_t size) {
+    size_t pos = 0;
+
+#ifdef __AVX2__
+    const __m256i space32 = _mm256_set1_epi8(' ');
+    const __m256i cr32 = _mm256_set1_epi8('\r');
+    for (; pos + 32 <= size; pos += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + pos));
+        __m256i found = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, space32), _mm256_cmpeq_epi8(chunk, cr32));
+        uint32_t mask = _mm256_movemask_epi8(found);
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+#ifdef __SSE2__
+    const __m128i space16 = _mm_set1_epi8(' ');
+    const __m128i cr16 = _mm_set1_epi8('\r');
+    for (; pos + 16 <= size; pos += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + pos));
+        __m128i found = _mm_or_si128(_mm_cmpeq_epi8(chunk, space16), _mm_cmpeq_epi8(chunk, cr16));
+        uint32_t mask = _mm_movemask_epi8(found);
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    for (; pos < size; pos++) {
+        if (input[pos] == ' ' || input[pos] == '\r') {
+            return pos;
+        }
+    }
+    return size;
+}
+
 // See Parse.h
 bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
     size_t pos;
     parsed = 0;
 
     for (pos = 0; pos < size && !parse_complete; pos++) {
+        // Name and keys end at space or \r, everything before it goes to the token at once. Token could
+        // continue in the next chunk, state stays the same then. Short tail is cheaper to handle char by char
+        if (vectorized && size - pos >= VectorizedMinInput &&
+            (state == State::sName || state == State::spKey || state == State::sgKey)) {
+            size_t end = pos + FindDelimiter(input + pos, size - pos);
+            (state == State::sName ? name : keys).append(input + pos, end - pos);
+            pos = end;
+            if (pos == size) {
+                break;
+            }
+        }
+
         char c = input[pos];
 
         switch (state) {
         case State::sName: {
             if (c == ' ' || c == '\r') {
                 // std::cout << "parser debug: name='" << name << "'" << std::endl;
-                if (name == "set" || name == "add" || name == "append" || name == "prepend") {
+                op = Lookup(name);
+                switch (op) {
+                case Op::kSet:
+                case Op::kAdd:
+                case Op::kReplace:
+                case Op::kAppend:
+                case Op::kPrepend:
+                case Op::kCas:
                     state = State::spKey;
-                } else if (name == "get" || name == "gets") {
+                    break;
+                case Op::kGet:
+                case Op::kGets:
                     state = State::sgKey;
-                } else if (name == "stats") {
+                    break;
+                case Op::kStats:
                     state = State::sLF;
                     continue;
-                } else {
+                default:
                     throw std::runtime_error("Unknown command name");
                 }
             } else {
@@ -46,32 +108,31 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
         case State::spKey: {
             if (c == ' ') {
                 state = State::spFlags;
-                keys.push_back(curKey);
-                // std::cout << "parser debug: key[" << keys.size() - 1 << "]='" << curKey << "'" << std::endl;
+                key_ends.push_back(keys.size());
+                // std::cout << "parser debug: key='" << keys << "'" << std::endl;
             } else {
-                curKey.push_back(c);
+                keys.push_back(c);
             }
             break;
         }
 
         case State::sgKey: {
             if (c == '\r') {
-                keys.push_back(curKey);
-                // std::cout << "parser debug: total '" << keys.size() << " keys" << std::endl;
+                key_ends.push_back(keys.size());
+                // std::cout << "parser debug: total '" << key_ends.size() << " keys" << std::endl;
 
-                if (keys.size() == 0) {
+                if (key_ends.size() == 0) {
                     throw std::runtime_error("Client provides no key to retrive");
                 }
 
-                curKey.clear();
                 state = State::sLF;
             } else if (c == ' ') {
-                // std::cout << "parser debug: key[" << keys.size() << "]='" << curKey << "'" << std::endl;
+                // std::cout << "parser debug: key[" << key_ends.size() << "] ends at " << keys.size() << std::endl;
                 state = State::sgKey;
-                keys.push_back(curKey);
-                curKey.clear();
+                key_ends.push_back(keys.size());
+                keys.push_back(' ');
             } else {
-                curKey.push_back(c);
+                keys.push_back(c);
             }
             break;
         }
@@ -108,17 +169,9 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
                 state = State::spBytes;
                 // std::cout << "parser debug: ExprTime='" << exprtime << "'" << std::endl;
             } else if (c >= '0' && c <= '9') {
-                int32_t et = exprtime;
-                if (negative) {
-                    et -= (c - '0');
-                    if (et > exprtime) {
-                        throw std::runtime_error("Expire time field overflow");
-                    }
-                } else {
-                    et += (c - '0');
-                    if (et < exprtime) {
-                        throw std::runtime_error("Expire time field overflow");
-                    }
+                int64_t et = int64_t(exprtime) * 10 + (negative ? -(c - '0') : (c - '0'));
+                if (et > INT32_MAX || et < INT32_MIN) {
+                    throw std::runtime_error("Expire time field overflow");
                 }
                 exprtime = et;
             }
@@ -129,6 +182,8 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
             if (c == '\r') {
                 state = State::sLF;
                 // std::cout << "parser debug: bytes='" << bytes << "'" << std::endl;
+            } else if (c == ' ' && op == Op::kCas) {
+                state = State::spCasUnique;
             } else if (c >= '0' && c <= '9') {
                 uint32_t b = (bytes * 10) + (c - '0');
                 if (b < bytes) {
@@ -140,6 +195,20 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
             break;
         }
 
+        case State::spCasUnique: {
+            if (c == '\r') {
+                state = State::sLF;
+            } else if (c >= '0' && c <= '9') {
+                uint64_t u = (cas_unique * 10) + (c - '0');
+                if (u < cas_unique) {
+                    // Overflow
+                    throw std::runtime_error("Cas unique field overflow");
+                }
+                cas_unique = u;
+            }
+            break;
+        }
+
         case State::sLF: {
             if (c == '\n') {
                 parse_complete = true;
@@ -161,37 +230,120 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
 }
 
 // See Parse.h
-std::unique_ptr<Execute::Command> Parser::Build(uint32_t &body_size) const {
+bool Parser::Build(uint32_t &body_size, Execute::CommandSlot &slot, std::string &keys_out,
+                   std::vector<uint32_t> &ends_out) {
     if (state != State::sLF) {
-        return std::unique_ptr<Execute::Command>(nullptr);
+        return false;
     }
 
+    keys.swap(keys_out);
+    key_ends.swap(ends_out);
+    keys.clear();
+    key_ends.clear();
+
     body_size = bytes;
-    if (name == "set") {
-        return std::unique_ptr<Execute::Command>(new Execute::Set(keys[0], flags, exprtime));
-    } else if (name == "add") {
-        return std::unique_ptr<Execute::Command>(new Execute::Add(keys[0], flags, exprtime));
-    } else if (name == "append") {
-        return std::unique_ptr<Execute::Command>(new Execute::Append(keys[0], flags, exprtime));
-    } else if (name == "get") {
-        return std::unique_ptr<Execute::Command>(new Execute::Get(keys));
-    } else if (name == "stats") {
-        return std::unique_ptr<Execute::Command>(new Execute::Stats());
-    } else {
+    Emplace(slot, keys_out, ends_out);
+    return true;
+}
+
+// Commands with data block have a single key, so all key bytes are that key
+void Parser::Emplace(Execute::CommandSlot &slot, const std::string &key_bytes,
+                     const std::vector<uint32_t> &ends) const {
+    switch (op) {
+    case Op::kSet:
+        slot.Emplace<Execute::Set>(key_bytes, flags, exprtime);
+        break;
+    case Op::kAdd:
+        slot.Emplace<Execute::Add>(key_bytes, flags, exprtime);
+        break;
+    case Op::kReplace:
+        slot.Emplace<Execute::Replace>(key_bytes, flags, exprtime);
+        break;
+    case Op::kAppend:
+        slot.Emplace<Execute::Append>(key_bytes, flags, exprtime);
+        break;
+    case Op::kPrepend:
+        slot.Emplace<Execute::Prepend>(key_bytes, flags, exprtime);
+        break;
+    case Op::kCas:
+        slot.Emplace<Execute::Cas>(key_bytes, flags, exprtime, cas_unique);
+        break;
+    case Op::kGet:
+        slot.Emplace<Execute::Get>(key_bytes, ends);
+        break;
+    case Op::kGets:
+        slot.Emplace<Execute::Get>(key_bytes, ends, true);
+        break;
+    case Op::kStats:
+        slot.Emplace<Execute::Stats>();
+        break;
+    default:
         throw std::runtime_error("Unsupported command");
     }
 }
 
+// See Parse.h
+bool Parser::HasBody() const {
+    switch (op) {
+    case Op::kGet:
+    case Op::kGets:
+    case Op::kStats:
+        return false;
+    default:
+        return true;
+    }
+}
+
+// See Parse.h
+Parser::Op Parser::Lookup(const std::string &name) {
+    // Length is known to match once we got here
+    auto match = [&name](const char *expected, Op op) {
+        return std::memcmp(name.data(), expected, name.size()) == 0 ? op : Op::kUnknown;
+    };
+
+    switch (name.size()) {
+    case 3:
+        switch (name[0]) {
+        case 's':
+            return match("set", Op::kSet);
+        case 'a':
+            return match("add", Op::kAdd);
+        case 'c':
+            return match("cas", Op::kCas);
+        case 'g':
+            return match("get", Op::kGet);
+        }
+        break;
+    case 4:
+        return match("gets", Op::kGets);
+    case 5:
+        return match("stats", Op::kStats);
+    case 6:
+        return match("append", Op::kAppend);
+    case 7:
+        switch (name[0]) {
+        case 'r':
+            return match("replace", Op::kReplace);
+        case 'p':
+            return match("prepend", Op::kPrepend);
+        }
+        break;
+    }
+    return Op::kUnknown;
+}
+
 // See Parse.h
 void Parser::Reset() {
     state = State::sName;
+    op = Op::kUnknown;
     name.clear();
     keys.clear();
-    curKey.clear();
+    key_ends.clear();
     parse_complete = false;
     flags = 0;
     bytes = 0;
     exprtime = 0;
+    cas_unique = 0;
 }
 
 } // namespace Protocol
@@ -1,7 +1,6 @@
 #ifndef AFINA_PROTOCOL_PARSER_H
 #define AFINA_PROTOCOL_PARSER_H
 
-#include <memory>
 #include <string>
 #include <vector>
 
@@ -10,17 +9,23 @@
 
 namespace Afina {
 namespace Execute {
-class Command;
+class CommandSlot;
 } // namespace Execute
 namespace Protocol {
 
 /**
  * # Memcached protocol parser
  * Parser supports subset of memcached protocol
+ *
+ * Command name and keys are sliced out of the input by searching delimiters 16 or 32 bytes at a time
+ * with SSE2/AVX2 when the build targets them, or by a plain scan otherwise
  */
 class Parser {
 public:
-    Parser() { Reset(); }
+    /**
+     * @param vectorized search token delimiters in bulk, otherwise input is handled one char at a time
+     */
+    explicit Parser(bool vectorized = true) : vectorized(vectorized) { Reset(); }
     /**
      * Push given string into parser input. Method returns true if it was a command parsed out
      * from comulative input. In a such case method Build will return new command
@@ -43,10 +48,21 @@ public:
     bool Parse(const char *input, const size_t size, size_t &parsed);
 
     /**
-     * Builds new command from parsed input. In case if it wasn't enough input to prse command out
-     * method return nullptr
+     * Builds new command from parsed input into the given slot, replacing command it held. In case if it
+     * wasn't enough input to prse command out method returns false and leaves slot untouched
+     *
+     * Key bytes are swapped into the given buffers and command borrows them from there, so buffers must be
+     * owned along with the slot and stay untouched until the command is done. Command never points into the
+     * parser, so parser could be reset or fed the next command right away. Parser takes buffers it got in
+     * exchange for the next command, so neither side allocates once warmed up
      */
-    std::unique_ptr<Execute::Command> Build(uint32_t &body_size) const;
+    bool Build(uint32_t &body_size, Execute::CommandSlot &slot, std::string &keys_out,
+               std::vector<uint32_t> &ends_out);
+
+    /**
+     * Returns true if parsed command is followed by the data block, even an empty one
+     */
+    bool HasBody() const;
 
     /**
      * Reset parse so that it could be used to parse out new command
@@ -62,14 +78,40 @@ private:
      * - sp: for PUT commands only
      * - sg: for GET commands only
      */
-    enum State : uint16_t { sCR, sLF, sName, spKey, spFlags, spExprTimeStart, spExprTime, spBytes, sgKey };
+    enum State : uint16_t { sCR, sLF, sName, spKey, spFlags, spExprTimeStart, spExprTime, spBytes, spCasUnique, sgKey };
+
+    // Commands parser knows about
+    enum class Op : uint8_t { kUnknown, kSet, kAdd, kReplace, kAppend, kPrepend, kCas, kGet, kGets, kStats };
+
+    /**
+     * Maps command name to the command. Switches on name length and first char, so it costs a single
+     * comparison of the candidate
+     */
+    static Op Lookup(const std::string &name);
+
+    /**
+     * Builds command of the parsed input taking keys from the given buffers, see Build
+     */
+    void Emplace(Execute::CommandSlot &slot, const std::string &key_bytes, const std::vector<uint32_t> &ends) const;
 
     // Current parser state
     State state;
 
+    // Command found by name
+    Op op;
+
+    // Tokens are sliced out in bulk
+    bool vectorized;
+
     // vrious fields of the command
     std::string name;
-    std::vector<std::string> keys;
+
+    // Bytes of all keys separated by single space, every key is a view into it given by key_ends. Memory is
+    // kept between commands, so parsing even large multiget allocates nothing once parser warmed up
+    std::string keys;
+
+    // Offset just past the end of each key in keys
+    std::vector<uint32_t> key_ends;
 
     // <flags> is an arbitrary 16-bit unsigned integer (written out in decimal) that the server stores along with
     // the data and sends back when the item is retrieved. Clients may use this as a bit field to store data-specific
@@ -88,8 +130,11 @@ private:
     // it's followed by an empty data block).
     uint32_t bytes;
 
+    // <cas unique> is a unique 64-bit value of an existing entry. Clients should use the value
+    // returned from the "gets" command when issuing "cas" updates.
+    uint64_t cas_unique;
+
     bool negative;
-    std::string curKey;
     bool parse_complete;
 };
 
@@ -0,0 +1,448 @@
+#include "ArenaImpl.h"
+
+#include <cstring>
+#include <new>
+
+#include <afina/allocator/Error.h>
+
+#include "Hash.h"
+
+namespace Afina {
+namespace Backend {
+
+// Initial number of buckets in the index
+static const size_t InitialIndexSize = 1024;
+
+// Maximum number of expiration timers processed by a single ReapExpired call
+static const size_t ReapBudget = 1024;
+
+// Amount of compaction work done by a single ReapExpired call, in bytes
+static const size_t DefragBudget = 256 * 1024;
+
+// Allocator block header and alignment plus handle table slot
+static const size_t BlockOverhead = 32 + sizeof(void *);
+
+// See ArenaImpl.h
+ArenaImpl::ArenaImpl(size_t max_memory, Allocator::HugePages huge_pages, bool populate)
+    : _max_memory(max_memory), _arena(max_memory, huge_pages, populate), _allocator(_arena.data(), max_memory),
+      _used_memory(0), _size(0), _version(0), _index(InitialIndexSize), _expiry(time(nullptr)) {}
+
+// See ArenaImpl.h
+bool ArenaImpl::Put(const std::string &key, const std::string &value, time_t expire_at) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    uint64_t hash = HashBytes(key.data(), key.size());
+    Pointer p = Find(key, hash);
+    if (At(p) != nullptr) {
+        return Update(p, value, expire_at);
+    }
+    return Insert(key, hash, value, expire_at, value.size());
+}
+
+// See ArenaImpl.h
+bool ArenaImpl::PutIfAbsent(const std::string &key, const std::string &value, time_t expire_at) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    uint64_t hash = HashBytes(key.data(), key.size());
+    Pointer p = Find(key, hash);
+    if (At(p) != nullptr) {
+        if (!At(p)->Expired()) {
+            return false;
+        }
+        return Update(p, value, expire_at);
+    }
+    return Insert(key, hash, value, expire_at, value.size());
+}
+
+// See ArenaImpl.h
+bool ArenaImpl::Set(const std::string &key, const std::string &value, time_t expire_at) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    Pointer p = FindLive(key);
+    if (At(p) == nullptr) {
+        return false;
+    }
+    return Update(p, value, expire_at);
+}
+
+// See ArenaImpl.h
+bool ArenaImpl::Append(const std::string &key, const std::string &suffix) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    Pointer p = FindLive(key);
+    if (At(p) == nullptr) {
+        return false;
+    }
+    return Extend(p, suffix, false);
+}
+
+// See ArenaImpl.h
+bool ArenaImpl::Prepend(const std::string &key, const std::string &prefix) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    Pointer p = FindLive(key);
+    if (At(p) == nullptr) {
+        return false;
+    }
+    return Extend(p, prefix, true);
+}
+
+// See ArenaImpl.h
+CasResult ArenaImpl::CompareAndSwap(const std::string &key, const std::string &value, uint64_t version,
+                                    time_t expire_at) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    Pointer p = FindLive(key);
+    if (At(p) == nullptr) {
+        return CasResult::kNotFound;
+    } else if (At(p)->version != version) {
+        return CasResult::kExists;
+    }
+
+    // Update fails only if value doesn't fit into the arena at all, old value is gone by then
+    return Update(p, value, expire_at) ? CasResult::kStored : CasResult::kNotFound;
+}
+
+// See ArenaImpl.h
+bool ArenaImpl::Delete(const std::string &key) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    Pointer p = Find(key, HashBytes(key.data(), key.size()));
+    if (At(p) == nullptr) {
+        return false;
+    }
+
+    bool expired = At(p)->Expired();
+    Remove(p);
+    return !expired;
+}
+
+// See ArenaImpl.h
+bool ArenaImpl::Get(const std::string &key, std::string &value) const {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    Pointer p = FindLive(key);
+    if (At(p) == nullptr) {
+        return false;
+    }
+
+    value.assign(At(p)->value(), At(p)->value_size);
+    ListUnlink(p);
+    ListPushFront(p);
+    return true;
+}
+
+// See ArenaImpl.h
+bool ArenaImpl::GetVersioned(const std::string &key, PinnedValue &value, uint64_t &version) const {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    Pointer p = FindLive(key);
+    if (At(p) == nullptr) {
+        return false;
+    }
+
+    Entry *entry = At(p);
+    value = PinnedValue(std::make_shared<const std::string>(entry->value(), entry->value_size));
+    version = entry->version;
+
+    ListUnlink(p);
+    ListPushFront(p);
+    return true;
+}
+
+// See ArenaImpl.h
+void ArenaImpl::ReapExpired(time_t now) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    _expiry.Advance(now, ReapBudget, [this, now](time_t deadline, const std::string &key) {
+        Pointer p = Find(key, HashBytes(key.data(), key.size()));
+        // Timer is stale if entry has been removed or got an earlier one since it was scheduled
+        Entry *entry = At(p);
+        if (entry == nullptr || entry->timer_at != deadline) {
+            return;
+        }
+
+        entry->timer_at = 0;
+        if (entry->expire_at != 0 && entry->expire_at <= now) {
+            Remove(p);
+        } else {
+            // Expiration time has been moved further meanwhile
+            ScheduleExpiry(entry);
+        }
+    });
+
+    _allocator.defrag(DefragBudget);
+}
+
+// See ArenaImpl.h
+void ArenaImpl::Stats(std::string &out) const {
+    std::string arena;
+    {
+        std::unique_lock<std::mutex> guard(_lock);
+        out.append("curr_items " + std::to_string(_size) + "\n");
+        out.append("bytes " + std::to_string(_used_memory) + "\n");
+        out.append("limit_maxbytes " + std::to_string(_max_memory) + "\n");
+        arena = _allocator.dump();
+    }
+
+    for (size_t pos = 0; pos < arena.size();) {
+        size_t end = arena.find('\n', pos);
+        out.append("arena_");
+        out.append(arena, pos, end - pos + 1);
+        pos = end + 1;
+    }
+}
+
+// See ArenaImpl.h
+size_t ArenaImpl::UsedMemory() const {
+    std::unique_lock<std::mutex> guard(_lock);
+    return _used_memory;
+}
+
+// See ArenaImpl.h
+size_t ArenaImpl::Charge(size_t key_size, size_t capacity) {
+    return sizeof(Entry) + key_size + capacity + BlockOverhead;
+}
+
+// See ArenaImpl.h
+ArenaImpl::Pointer ArenaImpl::Find(const std::string &key, uint64_t hash) const {
+    for (Pointer p = *Bucket(hash); At(p) != nullptr; p = At(p)->hnext) {
+        Entry *entry = At(p);
+        if (entry->hash == hash && entry->key_size == key.size() &&
+            std::memcmp(entry->key(), key.data(), key.size()) == 0) {
+            return p;
+        }
+    }
+    return Pointer();
+}
+
+// See ArenaImpl.h
+ArenaImpl::Pointer ArenaImpl::FindLive(const std::string &key) const {
+    // Expired entries are left in place, they are freed by ReapExpired or pushed out by eviction
+    Pointer p = Find(key, HashBytes(key.data(), key.size()));
+    if (At(p) != nullptr && At(p)->Expired()) {
+        return Pointer();
+    }
+    return p;
+}
+
+// See ArenaImpl.h
+ArenaImpl::Pointer ArenaImpl::Allocate(size_t size) {
+    if (size + BlockOverhead > _max_memory) {
+        return Pointer();
+    }
+
+    // Memory which is free but might be scattered over small holes. Compaction is worth doing only
+    // if the block could fit in there, evicted entries add up to it
+    size_t scattered = _used_memory < _max_memory ? _max_memory - _used_memory : 0;
+    while (true) {
+        try {
+            return _allocator.alloc(size);
+        } catch (Allocator::AllocError &) {
+        }
+
+        if (scattered >= size + BlockOverhead) {
+            _allocator.defrag();
+            scattered = 0;
+        } else if (At(_tail) != nullptr) {
+            scattered += Charge(At(_tail)->key_size, At(_tail)->capacity);
+            Remove(_tail);
+        } else {
+            return Pointer();
+        }
+    }
+}
+
+// See ArenaImpl.h
+bool ArenaImpl::Grow(Pointer p, size_t capacity) {
+    Entry *entry = At(p);
+    size_t charge = Charge(entry->key_size, capacity);
+    size_t old_charge = Charge(entry->key_size, entry->capacity);
+    try {
+        _allocator.realloc(p, sizeof(Entry) + entry->key_size + capacity);
+    } catch (Allocator::AllocError &) {
+        return false;
+    }
+
+    At(p)->capacity = capacity;
+    _used_memory += charge - old_charge;
+    return true;
+}
+
+// See ArenaImpl.h
+bool ArenaImpl::Insert(const std::string &key, uint64_t hash, const std::string &value, time_t expire_at,
+                       size_t capacity, time_t timer_at) {
+    // Extra room is a hint only, don't let it push the entry out of the arena
+    if (Charge(key.size(), capacity) > _max_memory) {
+        capacity = value.size();
+    }
+
+    Pointer p = Allocate(sizeof(Entry) + key.size() + capacity);
+    if (At(p) == nullptr) {
+        return false;
+    }
+
+    Entry *entry = new (p.get()) Entry();
+    entry->hash = hash;
+    entry->key_size = key.size();
+    entry->value_size = value.size();
+    entry->capacity = capacity;
+    entry->expire_at = expire_at;
+    entry->timer_at = timer_at;
+    entry->version = ++_version;
+    std::memcpy(entry->key(), key.data(), key.size());
+    std::memcpy(entry->value(), value.data(), value.size());
+
+    _used_memory += Charge(entry->key_size, entry->capacity);
+    _size++;
+    IndexInsert(p);
+    ListPushFront(p);
+
+    if (_size > _index.size()) {
+        IndexGrow();
+    }
+    ScheduleExpiry(At(p));
+    return true;
+}
+
+// See ArenaImpl.h
+bool ArenaImpl::Update(Pointer p, const std::string &value, time_t expire_at) {
+    // Block is resized in place or moved by allocator, handle stays the same so links are intact
+    if (value.size() > At(p)->capacity && !Grow(p, value.size())) {
+        // No room without eviction, entry has to be recreated. Old value is dropped first, so
+        // that it doesn't take space new one needs
+        std::string key(At(p)->key(), At(p)->key_size);
+        uint64_t hash = At(p)->hash;
+        time_t timer_at = At(p)->timer_at;
+        Remove(p);
+        return Insert(key, hash, value, expire_at, value.size(), timer_at);
+    }
+
+    Entry *entry = At(p);
+    std::memcpy(entry->value(), value.data(), value.size());
+    entry->value_size = value.size();
+    entry->expire_at = expire_at;
+    entry->version = ++_version;
+    ScheduleExpiry(entry);
+    ListUnlink(p);
+    ListPushFront(p);
+    return true;
+}
+
+// See ArenaImpl.h
+void ArenaImpl::ScheduleExpiry(Entry *entry) {
+    // Pending timer fires no later than the entry expires, it takes care of the rest once fired
+    if (entry->expire_at != 0 && (entry->timer_at == 0 || entry->expire_at < entry->timer_at)) {
+        _expiry.Schedule(entry->expire_at, std::string(entry->key(), entry->key_size));
+        entry->timer_at = entry->expire_at;
+    }
+}
+
+// See ArenaImpl.h
+bool ArenaImpl::Extend(Pointer p, const std::string &data, bool front) {
+    // Reserve room for subsequent appends, as value that has grown once is likely to grow again
+    size_t size = At(p)->value_size + data.size();
+    if (size > At(p)->capacity && !Grow(p, size + size / 2)) {
+        std::string value;
+        value.reserve(size);
+        if (front) {
+            value.append(data);
+        }
+        value.append(At(p)->value(), At(p)->value_size);
+        if (!front) {
+            value.append(data);
+        }
+
+        std::string key(At(p)->key(), At(p)->key_size);
+        uint64_t hash = At(p)->hash;
+        time_t expire_at = At(p)->expire_at;
+        time_t timer_at = At(p)->timer_at;
+        Remove(p);
+        return Insert(key, hash, value, expire_at, size + size / 2, timer_at);
+    }
+
+    Entry *entry = At(p);
+    if (front) {
+        std::memmove(entry->value() + data.size(), entry->value(), entry->value_size);
+        std::memcpy(entry->value(), data.data(), data.size());
+    } else {
+        std::memcpy(entry->value() + entry->value_size, data.data(), data.size());
+    }
+    entry->value_size = size;
+    entry->version = ++_version;
+    ListUnlink(p);
+    ListPushFront(p);
+    return true;
+}
+
+// See ArenaImpl.h
+void ArenaImpl::Remove(Pointer p) {
+    IndexUnlink(p);
+    ListUnlink(p);
+    _used_memory -= Charge(At(p)->key_size, At(p)->capacity);
+    _size--;
+    _allocator.free(p);
+}
+
+// See ArenaImpl.h
+void ArenaImpl::ListUnlink(Pointer p) const {
+    Entry *entry = At(p);
+    if (At(entry->prev) != nullptr) {
+        At(entry->prev)->next = entry->next;
+    } else {
+        _head = entry->next;
+    }
+
+    if (At(entry->next) != nullptr) {
+        At(entry->next)->prev = entry->prev;
+    } else {
+        _tail = entry->prev;
+    }
+}
+
+// See ArenaImpl.h
+void ArenaImpl::ListPushFront(Pointer p) const {
+    Entry *entry = At(p);
+    entry->prev = Pointer();
+    entry->next = _head;
+    if (At(_head) != nullptr) {
+        At(_head)->prev = p;
+    } else {
+        _tail = p;
+    }
+    _head = p;
+}
+
+// See ArenaImpl.h
+void ArenaImpl::IndexUnlink(Pointer p) {
+    Entry *entry = At(p);
+    Pointer *pos = Bucket(entry->hash);
+    while (At(*pos) != entry) {
+        pos = &At(*pos)->hnext;
+    }
+    *pos = entry->hnext;
+}
+
+// See ArenaImpl.h
+void ArenaImpl::IndexInsert(Pointer p) {
+    Pointer *bucket = Bucket(At(p)->hash);
+    At(p)->hnext = *bucket;
+    *bucket = p;
+}
+
+// See ArenaImpl.h
+void ArenaImpl::IndexGrow() {
+    std::vector<Pointer> old(_index.size() * 2);
+    old.swap(_index);
+
+    for (Pointer &head : old) {
+        while (At(head) != nullptr) {
+            Pointer next = At(head)->hnext;
+            IndexInsert(head);
+            head = next;
+        }
+    }
+}
+
+} // namespace Backend
+} // namespace Afina
@@ -0,0 +1,219 @@
+#ifndef AFINA_STORAGE_ARENA_IMPL_H
+#define AFINA_STORAGE_ARENA_IMPL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <afina/Storage.h>
+#include <afina/allocator/MappedRegion.h>
+#include <afina/allocator/Pointer.h>
+#include <afina/allocator/Simple.h>
+
+#include "TimingWheel.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # LRU cache inside of preallocated arena
+ * Whole memory budget is allocated once on construction and managed by Allocator::Simple. Every
+ * association is a single arena block holding list/index links, key and value bytes, so storage
+ * never grows beyond the budget and its memory doesn't get fragmented by the system allocator.
+ * Only the bucket array of the hash index and expiration timers live outside of the arena.
+ *
+ * Blocks are referenced by allocator handles, links between entries are handles as well. That
+ * allows arena to be compacted: when allocation fails while there is enough free memory in small
+ * holes, arena gets defragmented, least recently used entries are evicted only if there is really
+ * no space left. Besides that ReapExpired performs bounded step of incremental compaction, so
+ * that free memory is kept contiguous in background.
+ *
+ * Arena is mapped directly from the kernel, optionally with huge pages and pre-faulted, see
+ * Allocator::MappedRegion.
+ *
+ * Values get moved by compaction, so GetPinned returns a copy. All operations are serialized on
+ * the single mutex
+ */
+class ArenaImpl : public Afina::Storage {
+public:
+    ArenaImpl(size_t max_memory = 64 * 1024 * 1024, Allocator::HugePages huge_pages = Allocator::HugePages::None,
+              bool populate = false);
+    ~ArenaImpl() {}
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Append(const std::string &key, const std::string &suffix) override;
+
+    // Implements Afina::Storage interface
+    bool Prepend(const std::string &key, const std::string &prefix) override;
+
+    // Implements Afina::Storage interface
+    CasResult CompareAndSwap(const std::string &key, const std::string &value, uint64_t version,
+                             time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override;
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) const override;
+
+    // Implements Afina::Storage interface
+    bool GetVersioned(const std::string &key, PinnedValue &value, uint64_t &version) const override;
+
+    // Implements Afina::Storage interface
+    void ReapExpired(time_t now) override;
+
+    // Implements Afina::Storage interface, reports allocator statistics with arena_ prefix
+    void Stats(std::string &out) const override;
+
+    /**
+     * Number of arena bytes taken by entries currently in cache
+     */
+    size_t UsedMemory() const;
+
+private:
+    using Pointer = Allocator::Pointer;
+
+    /**
+     * Header of the entry block, key and value bytes follow it in the same block
+     */
+    struct Entry {
+        // Next entry in the same hash bucket
+        Pointer hnext;
+
+        // Neighbours in the recency list, head is the most recently used
+        Pointer prev;
+        Pointer next;
+
+        uint64_t hash;
+        uint32_t key_size;
+        size_t value_size;
+
+        // Number of bytes available for the value in this block
+        size_t capacity;
+
+        time_t expire_at;
+        uint64_t version;
+
+        // Deadline of the timer pending for the key, 0 if there is none
+        time_t timer_at;
+
+        char *key() { return reinterpret_cast<char *>(this + 1); }
+        char *value() { return key() + key_size; }
+
+        bool Expired() const { return expire_at != 0 && expire_at <= time(nullptr); }
+    };
+
+    /**
+     * Returns entry referenced by the handle or nullptr. Address stays valid until the next
+     * allocation or compaction
+     */
+    static Entry *At(const Pointer &p) { return static_cast<Entry *>(p.get()); }
+
+    /**
+     * Arena bytes taken by entry with given key and value capacity, including allocator overhead
+     */
+    static size_t Charge(size_t key_size, size_t capacity);
+
+    /**
+     * Returns handle of the entry for the key or empty one, expired entries are returned as well.
+     * Must be called under the lock
+     */
+    Pointer Find(const std::string &key, uint64_t hash) const;
+
+    /**
+     * Returns handle of the live entry for the key or empty one. Must be called under the lock
+     */
+    Pointer FindLive(const std::string &key) const;
+
+    /**
+     * Allocates arena block, compacting arena and evicting old entries if needed. Returns empty
+     * handle if block doesn't fit into the arena at all. Must be called under the lock
+     */
+    Pointer Allocate(size_t size);
+
+    /**
+     * Enlarges value capacity of the entry without evicting anything. Must be called under the lock
+     */
+    bool Grow(Pointer p, size_t capacity);
+
+    /**
+     * Creates new entry. Must be called under the lock and only for keys not present in cache.
+     * Entry recreated in place of removed one takes over its pending timer, see ScheduleExpiry
+     */
+    bool Insert(const std::string &key, uint64_t hash, const std::string &value, time_t expire_at,
+                size_t capacity, time_t timer_at = 0);
+
+    /**
+     * Replaces value of the existing entry. Must be called under the lock
+     */
+    bool Update(Pointer p, const std::string &value, time_t expire_at);
+
+    /**
+     * Adds data to the beginning or to the end of the entry value. Must be called under the lock
+     */
+    bool Extend(Pointer p, const std::string &data, bool front);
+
+    /**
+     * Makes sure a timer fires by the time entry expires, key keeps at most one timer pending.
+     * Must be called under the lock
+     */
+    void ScheduleExpiry(Entry *entry);
+
+    /**
+     * Unlinks entry from index and recency list and releases its block. Must be called under the lock
+     */
+    void Remove(Pointer p);
+
+    // Recency list manipulation
+    void ListUnlink(Pointer p) const;
+    void ListPushFront(Pointer p) const;
+
+    // Index manipulation
+    Pointer *Bucket(uint64_t hash) const { return const_cast<Pointer *>(&_index[hash & (_index.size() - 1)]); }
+    void IndexUnlink(Pointer p);
+    void IndexInsert(Pointer p);
+    void IndexGrow();
+
+    mutable std::mutex _lock;
+
+    const size_t _max_memory;
+
+    // Memory wrapped by the allocator, must be initialized first
+    Allocator::MappedRegion _arena;
+    Allocator::Simple _allocator;
+
+    size_t _used_memory;
+
+    size_t _size;
+
+    // Last version given to an entry
+    uint64_t _version;
+
+    // Hash index, size is always power of two
+    std::vector<Pointer> _index;
+
+    // Recency list
+    mutable Pointer _head;
+    mutable Pointer _tail;
+
+    // Keys of entries with expiration time
+    TimingWheel<std::string> _expiry;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_ARENA_IMPL_H
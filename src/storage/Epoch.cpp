@@ -0,0 +1,177 @@
+#include "Epoch.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+// Marks thread which is not inside of critical section
+const uint64_t Idle = UINT64_MAX;
+
+// How many objects thread retires before trying to reclaim memory
+const size_t CollectThreshold = 64;
+
+struct Retired {
+    void *p;
+    void (*deleter)(void *);
+
+    // Global epoch at the moment object was retired
+    uint64_t epoch;
+};
+
+/**
+ * Per thread state, records are never freed but could be reused by another thread once owner exits
+ */
+struct Record {
+    // Epoch thread is pinned at or Idle
+    std::atomic<uint64_t> epoch;
+
+    // True while record is owned by some thread
+    std::atomic<bool> in_use;
+
+    // Next record in the global list, list is append only
+    Record *next;
+
+    Record() : epoch(Idle), in_use(true), next(nullptr) {}
+};
+
+std::atomic<uint64_t> global_epoch(0);
+std::atomic<Record *> records(nullptr);
+
+// Objects left by exited threads
+std::mutex orphans_lock;
+std::vector<Retired> orphans;
+
+Record *Acquire() {
+    for (Record *r = records.load(std::memory_order_acquire); r != nullptr; r = r->next) {
+        bool expected = false;
+        if (!r->in_use.load(std::memory_order_relaxed) && r->in_use.compare_exchange_strong(expected, true)) {
+            return r;
+        }
+    }
+
+    Record *r = new Record();
+    Record *head = records.load(std::memory_order_relaxed);
+    do {
+        r->next = head;
+    } while (!records.compare_exchange_weak(head, r, std::memory_order_release, std::memory_order_relaxed));
+    return r;
+}
+
+// Global epoch could be advanced only if every pinned thread has observed current one
+void TryAdvance() {
+    uint64_t current = global_epoch.load(std::memory_order_seq_cst);
+    for (Record *r = records.load(std::memory_order_acquire); r != nullptr; r = r->next) {
+        uint64_t e = r->epoch.load(std::memory_order_seq_cst);
+        if (e != Idle && e != current) {
+            return;
+        }
+    }
+    global_epoch.compare_exchange_strong(current, current + 1);
+}
+
+// Deletes objects retired at least two epochs ago, nobody could reference them anymore
+void Reclaim(std::vector<Retired> &limbo) {
+    uint64_t current = global_epoch.load(std::memory_order_seq_cst);
+    size_t kept = 0;
+    for (size_t i = 0; i < limbo.size(); i++) {
+        if (limbo[i].epoch + 2 <= current) {
+            limbo[i].deleter(limbo[i].p);
+        } else {
+            limbo[kept++] = limbo[i];
+        }
+    }
+    limbo.resize(kept);
+}
+
+struct ThreadState {
+    Record *record;
+    unsigned depth;
+    size_t retired_since_collect;
+    std::vector<Retired> limbo;
+
+    ThreadState() : record(Acquire()), depth(0), retired_since_collect(0) {}
+
+    ~ThreadState() {
+        // Objects retired at current epoch need two advances to become reclaimable
+        record->epoch.store(Idle, std::memory_order_seq_cst);
+        TryAdvance();
+        TryAdvance();
+        Reclaim(limbo);
+        if (!limbo.empty()) {
+            std::unique_lock<std::mutex> guard(orphans_lock);
+            orphans.insert(orphans.end(), limbo.begin(), limbo.end());
+        }
+        record->in_use.store(false, std::memory_order_release);
+    }
+};
+
+ThreadState &Local() {
+    static thread_local ThreadState state;
+    return state;
+}
+
+} // namespace
+
+// See Epoch.h
+void Epoch::Enter() {
+    ThreadState &state = Local();
+    if (state.depth++ > 0) {
+        return;
+    }
+
+    // Publish epoch and make sure it is still current one, otherwise advancing thread could
+    // miss us
+    uint64_t e = global_epoch.load(std::memory_order_seq_cst);
+    while (true) {
+        state.record->epoch.store(e, std::memory_order_seq_cst);
+        uint64_t now = global_epoch.load(std::memory_order_seq_cst);
+        if (now == e) {
+            break;
+        }
+        e = now;
+    }
+}
+
+// See Epoch.h
+void Epoch::Exit() {
+    ThreadState &state = Local();
+    if (--state.depth == 0) {
+        state.record->epoch.store(Idle, std::memory_order_release);
+    }
+}
+
+// See Epoch.h
+void Epoch::Retire(void *p, void (*deleter)(void *)) {
+    ThreadState &state = Local();
+    state.limbo.push_back(Retired{p, deleter, global_epoch.load(std::memory_order_seq_cst)});
+
+    if (++state.retired_since_collect >= CollectThreshold) {
+        state.retired_since_collect = 0;
+        TryAdvance();
+        Reclaim(state.limbo);
+
+        std::unique_lock<std::mutex> guard(orphans_lock, std::try_to_lock);
+        if (guard.owns_lock() && !orphans.empty()) {
+            Reclaim(orphans);
+        }
+    }
+}
+
+// See Epoch.h
+void Epoch::Collect() {
+    ThreadState &state = Local();
+    TryAdvance();
+    TryAdvance();
+    Reclaim(state.limbo);
+
+    std::unique_lock<std::mutex> guard(orphans_lock);
+    Reclaim(orphans);
+}
+
+} // namespace Backend
+} // namespace Afina
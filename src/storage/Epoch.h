@@ -0,0 +1,65 @@
+#ifndef AFINA_STORAGE_EPOCH_H
+#define AFINA_STORAGE_EPOCH_H
+
+#include <cstdint>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Epoch based memory reclamation
+ * Lets lock-free structures free memory that concurrent readers may still hold a reference to.
+ * Reader pins the current thread for the time it dereferences shared pointers by creating
+ * EpochGuard on the stack. Writer unlinks object from the structure and passes it to
+ * Epoch::Retire instead of deleting it immediately: the object will be deleted only once every
+ * thread that might have seen it leaves its critical section.
+ *
+ * There is a single process wide epoch domain, threads are registered lazily on first use
+ */
+class Epoch {
+public:
+    /**
+     * Schedules object for deletion once no pinned thread could reference it. Calling thread
+     * must be pinned by EpochGuard
+     *
+     * @param p object to delete
+     * @param deleter function which releases memory of the object
+     */
+    static void Retire(void *p, void (*deleter)(void *));
+
+    /**
+     * Helper for objects allocated by new
+     */
+    template <typename T> static void Retire(T *p) {
+        Retire(static_cast<void *>(p), [](void *o) { delete static_cast<T *>(o); });
+    }
+
+    /**
+     * Tries to advance global epoch and deletes all objects of the calling thread that are safe
+     * to delete. Used by tests to avoid waiting for the next retire
+     */
+    static void Collect();
+
+private:
+    friend class EpochGuard;
+
+    static void Enter();
+    static void Exit();
+};
+
+/**
+ * RAII helper which pins current thread to the current epoch. Guards might be nested
+ */
+class EpochGuard {
+public:
+    EpochGuard() { Epoch::Enter(); }
+    ~EpochGuard() { Epoch::Exit(); }
+
+    EpochGuard(const EpochGuard &) = delete;
+    EpochGuard &operator=(const EpochGuard &) = delete;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_EPOCH_H
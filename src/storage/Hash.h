@@ -0,0 +1,25 @@
+#ifndef AFINA_STORAGE_HASH_H
+#define AFINA_STORAGE_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * FNV-1a hash of the given bytes, good enough to spread memcached style keys over buckets
+ */
+inline uint64_t HashBytes(const char *data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_HASH_H
@@ -0,0 +1,437 @@
+#include "LRUCacheImpl.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include "Hash.h"
+
+namespace Afina {
+namespace Backend {
+
+// Initial number of buckets in the index
+static const size_t InitialIndexSize = 1024;
+
+// Maximum number of expiration timers processed by a single ReapExpired call
+static const size_t ReapBudget = 1024;
+
+// Unused room of the entry block tolerated on update, block is reallocated once it is wasting more than
+// that and more than value itself takes
+static const size_t ShrinkSlack = 256;
+
+// See LRUCacheImpl.h
+LRUCacheImpl::LRUCacheImpl(size_t max_memory)
+    : _max_memory(max_memory), _used_memory(0), _size(0), _version(0), _index(InitialIndexSize, nullptr), _head(nullptr),
+      _tail(nullptr), _expiry(time(nullptr)) {}
+
+// See LRUCacheImpl.h
+LRUCacheImpl::~LRUCacheImpl() {
+    while (_head != nullptr) {
+        Node *next = _head->next;
+        Release(_head);
+        _head = next;
+    }
+}
+
+// See LRUCacheImpl.h
+bool LRUCacheImpl::Put(const std::string &key, const std::string &value, time_t expire_at) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    uint64_t hash = HashBytes(key.data(), key.size());
+    Node *node = Find(key, hash);
+    if (node != nullptr) {
+        return Update(node, value, expire_at);
+    }
+    return Insert(key, hash, value, expire_at, value.size());
+}
+
+// See LRUCacheImpl.h
+bool LRUCacheImpl::PutIfAbsent(const std::string &key, const std::string &value, time_t expire_at) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    uint64_t hash = HashBytes(key.data(), key.size());
+    Node *node = Find(key, hash);
+    if (node != nullptr) {
+        if (!node->Expired()) {
+            return false;
+        }
+        return Update(node, value, expire_at);
+    }
+    return Insert(key, hash, value, expire_at, value.size());
+}
+
+// See LRUCacheImpl.h
+bool LRUCacheImpl::Set(const std::string &key, const std::string &value, time_t expire_at) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    Node *node = FindLive(key);
+    if (node == nullptr) {
+        return false;
+    }
+    return Update(node, value, expire_at);
+}
+
+// See LRUCacheImpl.h
+bool LRUCacheImpl::Append(const std::string &key, const std::string &suffix) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    Node *node = FindLive(key);
+    if (node == nullptr) {
+        return false;
+    }
+    return Extend(node, suffix, false);
+}
+
+// See LRUCacheImpl.h
+bool LRUCacheImpl::Prepend(const std::string &key, const std::string &prefix) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    Node *node = FindLive(key);
+    if (node == nullptr) {
+        return false;
+    }
+    return Extend(node, prefix, true);
+}
+
+// See LRUCacheImpl.h
+CasResult LRUCacheImpl::CompareAndSwap(const std::string &key, const std::string &value, uint64_t version,
+                                       time_t expire_at) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    Node *node = FindLive(key);
+    if (node == nullptr) {
+        return CasResult::kNotFound;
+    } else if (node->version != version) {
+        return CasResult::kExists;
+    }
+
+    // Update fails only if value doesn't fit into the cache at all, old value is gone by then
+    return Update(node, value, expire_at) ? CasResult::kStored : CasResult::kNotFound;
+}
+
+// See LRUCacheImpl.h
+bool LRUCacheImpl::Delete(const std::string &key) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    Node *node = Find(key, HashBytes(key.data(), key.size()));
+    if (node == nullptr) {
+        return false;
+    }
+
+    bool expired = node->Expired();
+    Remove(node);
+    return !expired;
+}
+
+// See LRUCacheImpl.h
+bool LRUCacheImpl::Get(const std::string &key, std::string &value) const {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    Node *node = FindLive(key);
+    if (node == nullptr) {
+        return false;
+    }
+
+    value.assign(node->value(), node->value_size);
+    ListUnlink(node);
+    ListPushFront(node);
+    return true;
+}
+
+// See LRUCacheImpl.h
+bool LRUCacheImpl::GetPinned(const std::string &key, PinnedValue &value) const {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    Node *node = FindLive(key);
+    if (node == nullptr) {
+        return false;
+    }
+
+    node->refs.fetch_add(1, std::memory_order_relaxed);
+    value = PinnedValue(std::shared_ptr<const char>(node->value(), [node](const char *) { Release(node); }),
+                        node->value_size);
+
+    ListUnlink(node);
+    ListPushFront(node);
+    return true;
+}
+
+// See LRUCacheImpl.h
+bool LRUCacheImpl::GetVersioned(const std::string &key, PinnedValue &value, uint64_t &version) const {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    Node *node = FindLive(key);
+    if (node == nullptr) {
+        return false;
+    }
+
+    node->refs.fetch_add(1, std::memory_order_relaxed);
+    value = PinnedValue(std::shared_ptr<const char>(node->value(), [node](const char *) { Release(node); }),
+                        node->value_size);
+    version = node->version;
+
+    ListUnlink(node);
+    ListPushFront(node);
+    return true;
+}
+
+// See LRUCacheImpl.h
+void LRUCacheImpl::ReapExpired(time_t now) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    _expiry.Advance(now, ReapBudget, [this, now](time_t deadline, const std::string &key) {
+        Node *node = Find(key, HashBytes(key.data(), key.size()));
+        // Timer is stale if entry has been removed or got an earlier one since it was scheduled
+        if (node == nullptr || node->timer_at != deadline) {
+            return;
+        }
+
+        node->timer_at = 0;
+        if (node->expire_at != 0 && node->expire_at <= now) {
+            Remove(node);
+        } else {
+            // Expiration time has been moved further meanwhile
+            ScheduleExpiry(node);
+        }
+    });
+}
+
+// See LRUCacheImpl.h
+size_t LRUCacheImpl::UsedMemory() const {
+    std::unique_lock<std::mutex> guard(_lock);
+    return _used_memory;
+}
+
+// See LRUCacheImpl.h
+LRUCacheImpl::Node *LRUCacheImpl::Find(const std::string &key, uint64_t hash) const {
+    for (Node *node = *Bucket(hash); node != nullptr; node = node->hnext) {
+        if (node->hash == hash && node->key_size == key.size() &&
+            std::memcmp(node->key(), key.data(), key.size()) == 0) {
+            return node;
+        }
+    }
+    return nullptr;
+}
+
+// See LRUCacheImpl.h
+LRUCacheImpl::Node *LRUCacheImpl::FindLive(const std::string &key) const {
+    // Expired nodes are left in place, they are freed by ReapExpired or pushed out by eviction
+    Node *node = Find(key, HashBytes(key.data(), key.size()));
+    if (node != nullptr && node->Expired()) {
+        return nullptr;
+    }
+    return node;
+}
+
+// See LRUCacheImpl.h
+bool LRUCacheImpl::Insert(const std::string &key, uint64_t hash, const std::string &value, time_t expire_at,
+                          size_t capacity) {
+    // Extra room is a hint only, don't let it push the entry out of the budget
+    if (Charge(key.size(), capacity) > _max_memory) {
+        capacity = value.size();
+    }
+    if (!Reserve(Charge(key.size(), capacity))) {
+        return false;
+    }
+
+    Link(Allocate(key.data(), key.size(), hash, value, expire_at, capacity, 0));
+    return true;
+}
+
+// See LRUCacheImpl.h
+bool LRUCacheImpl::Update(Node *node, const std::string &value, time_t expire_at) {
+    // Bytes of pinned entry must stay intact. New pins are taken under the lock, so if cache
+    // holds the only reference nobody could observe the change. Block left mostly unused is
+    // reallocated, otherwise entry would be charged for its largest value ever
+    size_t waste = node->capacity - std::min(node->capacity, value.size());
+    if (value.size() <= node->capacity && waste <= std::max(value.size(), ShrinkSlack) &&
+        node->refs.load(std::memory_order_acquire) == 1) {
+        std::memcpy(node->value(), value.data(), value.size());
+        node->value_size = value.size();
+        node->expire_at = expire_at;
+        node->version = ++_version;
+        ScheduleExpiry(node);
+        ListUnlink(node);
+        ListPushFront(node);
+        return true;
+    }
+
+    return Recreate(node, value, expire_at, value.size());
+}
+
+// See LRUCacheImpl.h
+bool LRUCacheImpl::Extend(Node *node, const std::string &data, bool front) {
+    size_t size = node->value_size + data.size();
+    if (size <= node->capacity && node->refs.load(std::memory_order_acquire) == 1) {
+        if (front) {
+            std::memmove(node->value() + data.size(), node->value(), node->value_size);
+            std::memcpy(node->value(), data.data(), data.size());
+        } else {
+            std::memcpy(node->value() + node->value_size, data.data(), data.size());
+        }
+        node->value_size = size;
+        node->version = ++_version;
+        ListUnlink(node);
+        ListPushFront(node);
+        return true;
+    }
+
+    std::string value;
+    value.reserve(size);
+    if (front) {
+        value.append(data);
+    }
+    value.append(node->value(), node->value_size);
+    if (!front) {
+        value.append(data);
+    }
+
+    // Reserve room for subsequent appends, as value that has grown once is likely to grow again
+    return Recreate(node, value, node->expire_at, size + size / 2);
+}
+
+// See LRUCacheImpl.h
+bool LRUCacheImpl::Recreate(Node *node, const std::string &value, time_t expire_at, size_t capacity) {
+    if (Charge(node->key_size, capacity) > _max_memory) {
+        capacity = value.size();
+    }
+    if (Charge(node->key_size, capacity) > _max_memory) {
+        return false;
+    }
+
+    // New block is allocated first, so that failure leaves the old entry in place. Old one is dropped
+    // before eviction, so that it doesn't take space new one needs. Pending timer of the key is taken over
+    Node *fresh = Allocate(node->key(), node->key_size, node->hash, value, expire_at, capacity, node->timer_at);
+    Remove(node);
+    Reserve(Charge(fresh->key_size, fresh->capacity));
+    Link(fresh);
+    return true;
+}
+
+// See LRUCacheImpl.h
+LRUCacheImpl::Node *LRUCacheImpl::Allocate(const char *key, size_t key_size, uint64_t hash, const std::string &value,
+                                           time_t expire_at, size_t capacity, time_t timer_at) {
+    Node *node = new (::operator new(sizeof(Node) + key_size + capacity)) Node();
+    node->refs.store(1, std::memory_order_relaxed);
+    node->hash = hash;
+    node->key_size = key_size;
+    node->value_size = value.size();
+    node->capacity = capacity;
+    node->expire_at = expire_at;
+    node->timer_at = timer_at;
+    node->version = ++_version;
+    std::memcpy(node->key(), key, key_size);
+    std::memcpy(node->value(), value.data(), value.size());
+    return node;
+}
+
+// See LRUCacheImpl.h
+void LRUCacheImpl::Link(Node *node) {
+    _used_memory += Charge(node->key_size, node->capacity);
+    _size++;
+    IndexInsert(node);
+    ListPushFront(node);
+
+    if (_size > _index.size()) {
+        IndexGrow();
+    }
+    ScheduleExpiry(node);
+}
+
+// See LRUCacheImpl.h
+void LRUCacheImpl::ScheduleExpiry(Node *node) {
+    // Pending timer fires no later than the entry expires, it takes care of the rest once fired
+    if (node->expire_at != 0 && (node->timer_at == 0 || node->expire_at < node->timer_at)) {
+        _expiry.Schedule(node->expire_at, std::string(node->key(), node->key_size));
+        node->timer_at = node->expire_at;
+    }
+}
+
+// See LRUCacheImpl.h
+void LRUCacheImpl::Remove(Node *node) {
+    IndexUnlink(node);
+    ListUnlink(node);
+    _used_memory -= Charge(node->key_size, node->capacity);
+    _size--;
+    Release(node);
+}
+
+// See LRUCacheImpl.h
+void LRUCacheImpl::Release(Node *node) {
+    if (node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        node->~Node();
+        ::operator delete(node);
+    }
+}
+
+// See LRUCacheImpl.h
+bool LRUCacheImpl::Reserve(size_t charge) {
+    if (charge > _max_memory) {
+        return false;
+    }
+
+    while (_used_memory + charge > _max_memory) {
+        Remove(_tail);
+    }
+    return true;
+}
+
+// See LRUCacheImpl.h
+void LRUCacheImpl::ListUnlink(Node *node) const {
+    if (node->prev != nullptr) {
+        node->prev->next = node->next;
+    } else {
+        _head = node->next;
+    }
+
+    if (node->next != nullptr) {
+        node->next->prev = node->prev;
+    } else {
+        _tail = node->prev;
+    }
+}
+
+// See LRUCacheImpl.h
+void LRUCacheImpl::ListPushFront(Node *node) const {
+    node->prev = nullptr;
+    node->next = _head;
+    if (_head != nullptr) {
+        _head->prev = node;
+    } else {
+        _tail = node;
+    }
+    _head = node;
+}
+
+// See LRUCacheImpl.h
+void LRUCacheImpl::IndexUnlink(Node *node) {
+    Node **pos = Bucket(node->hash);
+    while (*pos != node) {
+        pos = &(*pos)->hnext;
+    }
+    *pos = node->hnext;
+}
+
+// See LRUCacheImpl.h
+void LRUCacheImpl::IndexInsert(Node *node) {
+    Node **bucket = Bucket(node->hash);
+    node->hnext = *bucket;
+    *bucket = node;
+}
+
+// See LRUCacheImpl.h
+void LRUCacheImpl::IndexGrow() {
+    std::vector<Node *> old(_index.size() * 2, nullptr);
+    old.swap(_index);
+
+    for (Node *head : old) {
+        while (head != nullptr) {
+            Node *next = head->hnext;
+            IndexInsert(head);
+            head = next;
+        }
+    }
+}
+
+} // namespace Backend
+} // namespace Afina
@@ -0,0 +1,224 @@
+#ifndef AFINA_STORAGE_LRU_CACHE_IMPL_H
+#define AFINA_STORAGE_LRU_CACHE_IMPL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <afina/Storage.h>
+
+#include "TimingWheel.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Intrusive LRU cache with memory budget
+ * Every association lives in a single heap block holding list/index links, key and value
+ * bytes. Blocks are threaded into a chained hash index and into a doubly-linked recency list,
+ * so lookup, update, touch and eviction are all O(1).
+ *
+ * Capacity is measured in bytes rather than in entries: each entry is charged for its key,
+ * value and bookkeeping overhead, and the least recently used entries get evicted until the
+ * total fits into max_memory. All operations are serialized on the single mutex
+ *
+ * Entries are reference counted, so GetPinned shares value bytes without copying. Pinned entry
+ * is never modified in place: update allocates new block and the old one is released once the
+ * last handle goes away
+ *
+ * Append and Prepend grow value inside its block while there is spare capacity, block is
+ * reallocated with extra room otherwise, so series of appends costs amortized O(1) per byte
+ */
+class LRUCacheImpl : public Afina::Storage {
+public:
+    LRUCacheImpl(size_t max_memory = 64 * 1024 * 1024);
+    ~LRUCacheImpl();
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Append(const std::string &key, const std::string &suffix) override;
+
+    // Implements Afina::Storage interface
+    bool Prepend(const std::string &key, const std::string &prefix) override;
+
+    // Implements Afina::Storage interface
+    CasResult CompareAndSwap(const std::string &key, const std::string &value, uint64_t version,
+                             time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override;
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) const override;
+
+    // Implements Afina::Storage interface
+    bool GetPinned(const std::string &key, PinnedValue &value) const override;
+
+    // Implements Afina::Storage interface
+    bool GetVersioned(const std::string &key, PinnedValue &value, uint64_t &version) const override;
+
+    // Implements Afina::Storage interface
+    void ReapExpired(time_t now) override;
+
+    /**
+     * Number of bytes charged for all entries currently in cache
+     */
+    size_t UsedMemory() const;
+
+private:
+    /**
+     * Header of the entry block, key and value bytes follow it in the same allocation
+     */
+    struct Node {
+        // Next entry in the same hash bucket
+        Node *hnext;
+
+        // Neighbours in the recency list, head is the most recently used
+        Node *prev;
+        Node *next;
+
+        uint64_t hash;
+        uint32_t key_size;
+        size_t value_size;
+
+        // Number of bytes available for the value in this block
+        size_t capacity;
+
+        time_t expire_at;
+        uint64_t version;
+
+        // Deadline of the timer pending for the key, 0 if there is none
+        time_t timer_at;
+
+        // One reference is held by the cache while entry is linked, others by pinned values
+        std::atomic<uint32_t> refs;
+
+        char *key() { return reinterpret_cast<char *>(this + 1); }
+        char *value() { return key() + key_size; }
+
+        bool Expired() const { return expire_at != 0 && expire_at <= time(nullptr); }
+    };
+
+    /**
+     * Bytes charged for entry with given key and value capacity
+     */
+    static size_t Charge(size_t key_size, size_t capacity) {
+        return sizeof(Node) + key_size + capacity + sizeof(Node *);
+    }
+
+    /**
+     * Drops reference to the node, releasing memory once the last one is gone
+     */
+    static void Release(Node *node);
+
+    /**
+     * Returns node for the key or nullptr, expired nodes are returned as well. Must be called
+     * under the lock
+     */
+    Node *Find(const std::string &key, uint64_t hash) const;
+
+    /**
+     * Returns live node for the key or nullptr. Must be called under the lock
+     */
+    Node *FindLive(const std::string &key) const;
+
+    /**
+     * Creates new entry, evicting old ones if needed. Must be called under the lock and only
+     * for keys not present in cache
+     */
+    bool Insert(const std::string &key, uint64_t hash, const std::string &value, time_t expire_at,
+                size_t capacity);
+
+    /**
+     * Replaces value of the existing entry, might reallocate node. Must be called under the lock
+     */
+    bool Update(Node *node, const std::string &value, time_t expire_at);
+
+    /**
+     * Adds data to the beginning or to the end of the entry value, might reallocate node. Must be
+     * called under the lock
+     */
+    bool Extend(Node *node, const std::string &data, bool front);
+
+    /**
+     * Makes sure a timer fires by the time entry expires, key keeps at most one timer pending.
+     * Must be called under the lock
+     */
+    void ScheduleExpiry(Node *node);
+
+    /**
+     * Replaces node by a new one with the given value and capacity, evicting other entries if needed.
+     * If new entry doesn't fit, the old one is left intact and false is returned. Must be called under
+     * the lock
+     */
+    bool Recreate(Node *node, const std::string &value, time_t expire_at, size_t capacity);
+
+    /**
+     * Allocates node not linked anywhere yet. Takes over timer pending for the key, see ScheduleExpiry
+     */
+    Node *Allocate(const char *key, size_t key_size, uint64_t hash, const std::string &value, time_t expire_at,
+                   size_t capacity, time_t timer_at);
+
+    /**
+     * Links node into index and recency list and charges it. Must be called under the lock
+     */
+    void Link(Node *node);
+
+    /**
+     * Unlinks node from index and recency list and releases its memory. Must be called under the lock
+     */
+    void Remove(Node *node);
+
+    /**
+     * Evicts least recently used entries until given number of bytes could be charged
+     */
+    bool Reserve(size_t charge);
+
+    // Recency list manipulation
+    void ListUnlink(Node *node) const;
+    void ListPushFront(Node *node) const;
+
+    // Index manipulation
+    Node **Bucket(uint64_t hash) const { return const_cast<Node **>(&_index[hash & (_index.size() - 1)]); }
+    void IndexUnlink(Node *node);
+    void IndexInsert(Node *node);
+    void IndexGrow();
+
+    mutable std::mutex _lock;
+
+    const size_t _max_memory;
+
+    size_t _used_memory;
+
+    size_t _size;
+
+    // Last version given to an entry
+    uint64_t _version;
+
+    // Hash index, size is always power of two
+    std::vector<Node *> _index;
+
+    // Recency list
+    mutable Node *_head;
+    mutable Node *_tail;
+
+    // Keys of entries with expiration time
+    TimingWheel<std::string> _expiry;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_LRU_CACHE_IMPL_H
@@ -0,0 +1,467 @@
+#include "LockFreeHashImpl.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#include "Epoch.h"
+#include "Hash.h"
+
+namespace Afina {
+namespace Backend {
+
+// Table gets rebuilt once that share of slots is used by live items and tombstones
+static const size_t RebuildNumerator = 3;
+static const size_t RebuildDenominator = 4;
+
+// Maximum number of slots inspected by a single ReapExpired call
+static const size_t ReapBudget = 4096;
+
+// See LockFreeHashImpl.h
+LockFreeHashImpl::Item *LockFreeHashImpl::Item::Create(uint64_t hash, const char *key, size_t key_size,
+                                                       const char *value, size_t value_size, time_t expire_at,
+                                                       uint64_t version) {
+    void *mem = ::operator new(sizeof(Item) + key_size + value_size);
+    Item *item = new (mem) Item();
+    item->hash = hash;
+    item->key_size = key_size;
+    item->value_size = value_size;
+    item->expire_at = expire_at;
+    item->version = version;
+    item->referenced.store(false, std::memory_order_relaxed);
+    item->refs.store(1, std::memory_order_relaxed);
+
+    char *data = reinterpret_cast<char *>(item + 1);
+    std::memcpy(data, key, key_size);
+    if (value != nullptr) {
+        std::memcpy(data + key_size, value, value_size);
+    }
+    return item;
+}
+
+// See LockFreeHashImpl.h
+void LockFreeHashImpl::Item::Destroy(void *p) {
+    Item *item = static_cast<Item *>(p);
+    item->~Item();
+    ::operator delete(p);
+}
+
+// See LockFreeHashImpl.h
+void LockFreeHashImpl::Item::Release(void *p) {
+    Item *item = static_cast<Item *>(p);
+    if (item->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        Destroy(p);
+    }
+}
+
+// See LockFreeHashImpl.h
+LockFreeHashImpl::Table::Table(size_t capacity) : capacity(capacity), used(0) {
+    slots = new std::atomic<slot_type>[capacity];
+    for (size_t i = 0; i < capacity; i++) {
+        slots[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+// See LockFreeHashImpl.h
+LockFreeHashImpl::Table::~Table() { delete[] slots; }
+
+// See LockFreeHashImpl.h
+LockFreeHashImpl::LockFreeHashImpl(size_t max_size) : _max_size(max_size), _size(0), _hand(0), _reap_cursor(0), _version(0) {
+    // Keep load factor of live items below 1/2
+    size_t capacity = 16;
+    while (capacity < 2 * max_size) {
+        capacity *= 2;
+    }
+    _table.store(new Table(capacity));
+}
+
+// See LockFreeHashImpl.h
+LockFreeHashImpl::~LockFreeHashImpl() {
+    Table *table = _table.load();
+    for (size_t i = 0; i < table->capacity; i++) {
+        slot_type s = table->slots[i].load();
+        if (s != 0) {
+            Item::Release(ItemOf(s));
+        }
+    }
+    delete table;
+}
+
+// See LockFreeHashImpl.h
+bool LockFreeHashImpl::Put(const std::string &key, const std::string &value, time_t expire_at) {
+    return Update(key, &value, expire_at, Mode::kAny);
+}
+
+// See LockFreeHashImpl.h
+bool LockFreeHashImpl::PutIfAbsent(const std::string &key, const std::string &value, time_t expire_at) {
+    return Update(key, &value, expire_at, Mode::kIfAbsent);
+}
+
+// See LockFreeHashImpl.h
+bool LockFreeHashImpl::Set(const std::string &key, const std::string &value, time_t expire_at) {
+    return Update(key, &value, expire_at, Mode::kIfPresent);
+}
+
+// See LockFreeHashImpl.h
+bool LockFreeHashImpl::Delete(const std::string &key) { return Update(key, nullptr, 0, Mode::kDelete); }
+
+// See LockFreeHashImpl.h
+bool LockFreeHashImpl::Get(const std::string &key, std::string &value) const {
+    EpochGuard epoch;
+    Item *item = Find(key);
+    if (item == nullptr) {
+        return false;
+    }
+
+    value.assign(item->value(), item->value_size);
+    return true;
+}
+
+// See LockFreeHashImpl.h
+bool LockFreeHashImpl::GetPinned(const std::string &key, PinnedValue &value) const {
+    return Pin(key, value, nullptr);
+}
+
+// See LockFreeHashImpl.h
+bool LockFreeHashImpl::GetVersioned(const std::string &key, PinnedValue &value, uint64_t &version) const {
+    return Pin(key, value, &version);
+}
+
+// See LockFreeHashImpl.h
+bool LockFreeHashImpl::Append(const std::string &key, const std::string &suffix) {
+    return Modify(key, [this, &suffix](const Item *item) {
+        Item *next = Item::Create(item->hash, item->key(), item->key_size, nullptr, item->value_size + suffix.size(),
+                                  item->expire_at, _version.fetch_add(1, std::memory_order_relaxed) + 1);
+        char *value = const_cast<char *>(next->value());
+        std::memcpy(value, item->value(), item->value_size);
+        std::memcpy(value + item->value_size, suffix.data(), suffix.size());
+        return next;
+    });
+}
+
+// See LockFreeHashImpl.h
+bool LockFreeHashImpl::Prepend(const std::string &key, const std::string &prefix) {
+    return Modify(key, [this, &prefix](const Item *item) {
+        Item *next = Item::Create(item->hash, item->key(), item->key_size, nullptr, item->value_size + prefix.size(),
+                                  item->expire_at, _version.fetch_add(1, std::memory_order_relaxed) + 1);
+        char *value = const_cast<char *>(next->value());
+        std::memcpy(value, prefix.data(), prefix.size());
+        std::memcpy(value + prefix.size(), item->value(), item->value_size);
+        return next;
+    });
+}
+
+// See LockFreeHashImpl.h
+CasResult LockFreeHashImpl::CompareAndSwap(const std::string &key, const std::string &value, uint64_t version,
+                                           time_t expire_at) {
+    bool found = false;
+    bool stored = Modify(key, [&](const Item *item) -> Item * {
+        found = true;
+        if (item->version != version) {
+            return nullptr;
+        }
+        return Item::Create(item->hash, item->key(), item->key_size, value.data(), value.size(), expire_at,
+                            _version.fetch_add(1, std::memory_order_relaxed) + 1);
+    });
+
+    if (stored) {
+        return CasResult::kStored;
+    }
+    return found ? CasResult::kExists : CasResult::kNotFound;
+}
+
+// See LockFreeHashImpl.h
+void LockFreeHashImpl::ReapExpired(time_t now) {
+    SharedLock<SharedMutex> writer(_rebuild_lock);
+    EpochGuard epoch;
+    Table *table = _table.load(std::memory_order_acquire);
+
+    size_t mask = table->capacity - 1;
+    size_t budget = std::min(ReapBudget, table->capacity);
+    size_t start = _reap_cursor.fetch_add(budget, std::memory_order_relaxed);
+    for (size_t i = 0; i < budget; i++) {
+        std::atomic<slot_type> &slot = table->slots[(start + i) & mask];
+        slot_type s = slot.load(std::memory_order_acquire);
+        if (IsLive(s) && ItemOf(s)->ExpiredBy(now)) {
+            Kill(slot, s);
+        }
+    }
+}
+
+// See LockFreeHashImpl.h
+bool LockFreeHashImpl::Pin(const std::string &key, PinnedValue &value, uint64_t *version) const {
+    EpochGuard epoch;
+    Item *item = Find(key);
+    if (item == nullptr) {
+        return false;
+    }
+
+    // Item can't be released while we are in critical section, so it is safe to take reference
+    item->refs.fetch_add(1, std::memory_order_relaxed);
+    value = PinnedValue(std::shared_ptr<const char>(item->value(), [item](const char *) { Item::Release(item); }),
+                        item->value_size);
+    if (version != nullptr) {
+        *version = item->version;
+    }
+    return true;
+}
+
+// See LockFreeHashImpl.h
+LockFreeHashImpl::Item *LockFreeHashImpl::Find(const std::string &key) const {
+    Table *table = _table.load(std::memory_order_acquire);
+
+    bool claimed;
+    std::atomic<slot_type> *slot = Lookup(table, HashBytes(key.data(), key.size()), key, nullptr, claimed);
+    if (slot == nullptr) {
+        return nullptr;
+    }
+
+    slot_type s = slot->load(std::memory_order_acquire);
+    if (!IsVisible(s)) {
+        return nullptr;
+    }
+
+    // Avoid writing cache line shared between readers if bit is set already
+    Item *item = ItemOf(s);
+    if (!item->referenced.load(std::memory_order_relaxed)) {
+        item->referenced.store(true, std::memory_order_relaxed);
+    }
+    return item;
+}
+
+// See LockFreeHashImpl.h
+std::atomic<LockFreeHashImpl::slot_type> *LockFreeHashImpl::Lookup(Table *table, uint64_t hash,
+                                                                   const std::string &key, Item *claim,
+                                                                   bool &claimed) const {
+    claimed = false;
+    size_t mask = table->capacity - 1;
+    for (size_t i = 0, idx = hash & mask; i < table->capacity; i++, idx = (idx + 1) & mask) {
+        std::atomic<slot_type> &slot = table->slots[idx];
+        slot_type s = slot.load(std::memory_order_acquire);
+
+        if (s == 0) {
+            // Key is not in the table, slots are never emptied except by rebuild
+            if (claim == nullptr) {
+                return nullptr;
+            }
+
+            if (slot.compare_exchange_strong(s, reinterpret_cast<slot_type>(claim), std::memory_order_acq_rel,
+                                             std::memory_order_acquire)) {
+                table->used.fetch_add(1, std::memory_order_relaxed);
+                claimed = true;
+                return &slot;
+            }
+
+            // Lost the race, check whom slot has been given to
+        }
+
+        if (Matches(ItemOf(s), hash, key)) {
+            return &slot;
+        }
+    }
+
+    // Table is full
+    return nullptr;
+}
+
+// See LockFreeHashImpl.h
+bool LockFreeHashImpl::Update(const std::string &key, const std::string *value, time_t expire_at, Mode mode) {
+    bool inserted = false;
+    {
+        SharedLock<SharedMutex> writer(_rebuild_lock);
+        EpochGuard epoch;
+        Table *table = _table.load(std::memory_order_acquire);
+
+        uint64_t hash = HashBytes(key.data(), key.size());
+        Item *item = nullptr;
+        if (value != nullptr) {
+            item = Item::Create(hash, key.data(), key.size(), value->data(), value->size(), expire_at,
+                                _version.fetch_add(1, std::memory_order_relaxed) + 1);
+        } else {
+            item = Item::Create(hash, key.data(), key.size(), nullptr, 0, 0, 0);
+        }
+
+        bool may_insert = (mode == Mode::kAny || mode == Mode::kIfAbsent);
+        bool claimed;
+        std::atomic<slot_type> *slot = Lookup(table, hash, key, may_insert ? item : nullptr, claimed);
+        if (slot == nullptr) {
+            Item::Destroy(item);
+            return false;
+        }
+
+        if (claimed) {
+            _size.fetch_add(1, std::memory_order_relaxed);
+            inserted = true;
+        } else {
+            slot_type desired = reinterpret_cast<slot_type>(item) | (mode == Mode::kDelete ? Tombstone : 0);
+            slot_type s = slot->load(std::memory_order_acquire);
+            while (true) {
+                // Expired item is treated as absent, though it could still be overwritten
+                bool visible = IsVisible(s);
+                if ((mode == Mode::kIfAbsent && visible) ||
+                    ((mode == Mode::kIfPresent || mode == Mode::kDelete) && !visible)) {
+                    Item::Destroy(item);
+                    return false;
+                }
+
+                if (slot->compare_exchange_weak(s, desired, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    break;
+                }
+            }
+
+            Epoch::Retire(ItemOf(s), Item::Release);
+            if (mode == Mode::kDelete) {
+                _size.fetch_sub(1, std::memory_order_relaxed);
+            } else if (!IsLive(s)) {
+                _size.fetch_add(1, std::memory_order_relaxed);
+                inserted = true;
+            }
+        }
+    }
+
+    if (inserted) {
+        AfterInsert();
+    }
+    return true;
+}
+
+// See LockFreeHashImpl.h
+template <typename F> bool LockFreeHashImpl::Modify(const std::string &key, F &&build) {
+    SharedLock<SharedMutex> writer(_rebuild_lock);
+    EpochGuard epoch;
+    Table *table = _table.load(std::memory_order_acquire);
+
+    bool claimed;
+    std::atomic<slot_type> *slot = Lookup(table, HashBytes(key.data(), key.size()), key, nullptr, claimed);
+    if (slot == nullptr) {
+        return false;
+    }
+
+    slot_type s = slot->load(std::memory_order_acquire);
+    while (true) {
+        if (!IsVisible(s)) {
+            return false;
+        }
+
+        Item *item = build(ItemOf(s));
+        if (item == nullptr) {
+            return false;
+        }
+
+        // Live item replaces live one, so number of items stays the same
+        if (slot->compare_exchange_strong(s, reinterpret_cast<slot_type>(item), std::memory_order_acq_rel,
+                                          std::memory_order_acquire)) {
+            Epoch::Retire(ItemOf(s), Item::Release);
+            return true;
+        }
+        Item::Destroy(item);
+    }
+}
+
+// See LockFreeHashImpl.h
+void LockFreeHashImpl::AfterInsert() {
+    // Concurrent deletes might make it unnecessary, so don't try forever
+    for (int attempt = 0; attempt < 4 && _size.load(std::memory_order_relaxed) > _max_size; attempt++) {
+        Evict();
+    }
+
+    // Table might be replaced and retired by concurrent rebuild
+    Table *table;
+    bool full;
+    {
+        EpochGuard epoch;
+        table = _table.load(std::memory_order_acquire);
+        full = table->used.load(std::memory_order_relaxed) * RebuildDenominator > table->capacity * RebuildNumerator;
+    }
+
+    if (full) {
+        std::unique_lock<SharedMutex> guard(_rebuild_lock);
+        if (_table.load(std::memory_order_relaxed) == table) {
+            Rebuild();
+        }
+    }
+}
+
+// See LockFreeHashImpl.h
+void LockFreeHashImpl::Evict() {
+    SharedLock<SharedMutex> writer(_rebuild_lock);
+    EpochGuard epoch;
+    Table *table = _table.load(std::memory_order_acquire);
+
+    size_t mask = table->capacity - 1;
+    for (size_t step = 0; step < 2 * table->capacity; step++) {
+        std::atomic<slot_type> &slot = table->slots[_hand.fetch_add(1, std::memory_order_relaxed) & mask];
+        slot_type s = slot.load(std::memory_order_acquire);
+        if (!IsLive(s)) {
+            continue;
+        }
+
+        // Expired items don't deserve second chance
+        Item *item = ItemOf(s);
+        if (item->referenced.load(std::memory_order_relaxed) && !item->Expired()) {
+            item->referenced.store(false, std::memory_order_relaxed);
+            continue;
+        }
+
+        if (Kill(slot, s)) {
+            return;
+        }
+    }
+}
+
+// See LockFreeHashImpl.h
+bool LockFreeHashImpl::Kill(std::atomic<slot_type> &slot, slot_type s) {
+    Item *item = ItemOf(s);
+    Item *tomb = Item::Create(item->hash, item->key(), item->key_size, nullptr, 0, 0, 0);
+    if (slot.compare_exchange_strong(s, reinterpret_cast<slot_type>(tomb) | Tombstone, std::memory_order_acq_rel)) {
+        Epoch::Retire(item, Item::Release);
+        _size.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    Item::Destroy(tomb);
+    return false;
+}
+
+// See LockFreeHashImpl.h
+void LockFreeHashImpl::Rebuild() {
+    EpochGuard epoch;
+    Table *old = _table.load(std::memory_order_relaxed);
+
+    size_t capacity = old->capacity;
+    while (_size.load(std::memory_order_relaxed) * 2 > capacity) {
+        capacity *= 2;
+    }
+
+    // No writers are running, so live items could be moved as is. Readers might still look
+    // into the old table, so tombstones and the table itself must survive grace period
+    Table *fresh = new Table(capacity);
+    size_t mask = capacity - 1;
+    for (size_t i = 0; i < old->capacity; i++) {
+        slot_type s = old->slots[i].load(std::memory_order_relaxed);
+        if (s == 0) {
+            continue;
+        } else if (!IsLive(s)) {
+            Epoch::Retire(ItemOf(s), Item::Release);
+            continue;
+        } else if (ItemOf(s)->Expired()) {
+            // Free to drop, expired items are invisible to readers anyway
+            Epoch::Retire(ItemOf(s), Item::Release);
+            _size.fetch_sub(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        size_t idx = ItemOf(s)->hash & mask;
+        while (fresh->slots[idx].load(std::memory_order_relaxed) != 0) {
+            idx = (idx + 1) & mask;
+        }
+        fresh->slots[idx].store(s, std::memory_order_relaxed);
+        fresh->used.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    _table.store(fresh, std::memory_order_release);
+    Epoch::Retire(old);
+}
+
+} // namespace Backend
+} // namespace Afina
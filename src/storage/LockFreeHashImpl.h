@@ -0,0 +1,229 @@
+#ifndef AFINA_STORAGE_LOCK_FREE_HASH_IMPL_H
+#define AFINA_STORAGE_LOCK_FREE_HASH_IMPL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+#include <afina/Storage.h>
+
+#include "SharedMutex.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Lock-free hash table
+ * Open addressing table with linear probing where each slot is an atomic pointer to an
+ * immutable item holding key and value. Updates build a new item and CAS it into the slot,
+ * replaced items are reclaimed through Epoch once no reader could see them anymore.
+ *
+ * Get never blocks and never writes shared memory except for the CLOCK reference bit.
+ * Put/PutIfAbsent/Set/Delete are lock-free with respect to each other, they only wait for the
+ * rare table rebuild which purges accumulated tombstones.
+ *
+ * Once slot is taken by a key it stays bound to that key until the next rebuild: delete puts
+ * key-only tombstone there, so probe sequences are never broken and concurrent inserts of the
+ * same key always meet in the same slot.
+ *
+ * Number of live items is limited by max_size, extra ones are evicted by CLOCK approximation
+ * of LRU
+ *
+ * Read-modify-write operations such as Append build the new item from the current one and CAS
+ * it over, retrying if the slot has changed meanwhile. Items are immutable, so values never grow
+ * in place here
+ *
+ * Expired items stay in their slots until overwritten, evicted or swept by ReapExpired, which
+ * scans a bounded number of slots per call from where the previous one stopped
+ *
+ * Items are reference counted on top of epoch protection, so GetPinned could share value bytes
+ * beyond the reader's critical section: table reference is dropped once grace period of the
+ * replaced item passes, memory is released when the last pinned value goes away
+ */
+class LockFreeHashImpl : public Afina::Storage {
+public:
+    LockFreeHashImpl(size_t max_size = 1024);
+    ~LockFreeHashImpl();
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Append(const std::string &key, const std::string &suffix) override;
+
+    // Implements Afina::Storage interface
+    bool Prepend(const std::string &key, const std::string &prefix) override;
+
+    // Implements Afina::Storage interface
+    CasResult CompareAndSwap(const std::string &key, const std::string &value, uint64_t version,
+                             time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override;
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) const override;
+
+    // Implements Afina::Storage interface
+    bool GetPinned(const std::string &key, PinnedValue &value) const override;
+
+    // Implements Afina::Storage interface
+    bool GetVersioned(const std::string &key, PinnedValue &value, uint64_t &version) const override;
+
+    // Implements Afina::Storage interface
+    void ReapExpired(time_t now) override;
+
+private:
+    /**
+     * Immutable key/value pair, key and value bytes follow the header
+     */
+    struct Item {
+        uint64_t hash;
+        uint32_t key_size;
+        size_t value_size;
+        time_t expire_at;
+        uint64_t version;
+
+        // CLOCK reference bit
+        std::atomic<bool> referenced;
+
+        // One reference is held by the table, others by pinned values
+        std::atomic<uint32_t> refs;
+
+        const char *key() const { return reinterpret_cast<const char *>(this + 1); }
+        const char *value() const { return key() + key_size; }
+
+        bool ExpiredBy(time_t now) const { return expire_at != 0 && expire_at <= now; }
+        bool Expired() const { return expire_at != 0 && expire_at <= time(nullptr); }
+
+        // Value bytes are left uninitialized if value is nullptr, so that caller could fill them
+        // before publishing the item
+        static Item *Create(uint64_t hash, const char *key, size_t key_size, const char *value, size_t value_size,
+                            time_t expire_at, uint64_t version);
+
+        // Releases item that has never been published
+        static void Destroy(void *p);
+
+        // Drops reference to the item, releases memory once the last one is gone
+        static void Release(void *p);
+    };
+
+    /**
+     * Slot content: 0 is an empty slot, otherwise pointer to item, lowest bit marks tombstone
+     */
+    typedef uintptr_t slot_type;
+    static const slot_type Tombstone = 1;
+
+    static Item *ItemOf(slot_type s) { return reinterpret_cast<Item *>(s & ~Tombstone); }
+    static bool IsLive(slot_type s) { return s != 0 && (s & Tombstone) == 0; }
+
+    // Live and not expired, expired items are visible to nobody but still counted in _size
+    static bool IsVisible(slot_type s) { return IsLive(s) && !ItemOf(s)->Expired(); }
+
+    struct Table {
+        size_t capacity;
+
+        // Number of non empty slots, including tombstones
+        std::atomic<size_t> used;
+
+        std::atomic<slot_type> *slots;
+
+        Table(size_t capacity);
+        ~Table();
+    };
+
+    static bool Matches(const Item *item, uint64_t hash, const std::string &key) {
+        return item->hash == hash && item->key_size == key.size() &&
+               key.compare(0, key.size(), item->key(), item->key_size) == 0;
+    }
+
+    /**
+     * Returns live item for the key or nullptr. Caller must be pinned by EpochGuard
+     */
+    Item *Find(const std::string &key) const;
+
+    /**
+     * Finds slot bound to the key, or claims an empty one for it if claim is given. Returns
+     * nullptr if key is not found and no slot is claimed. Caller must be pinned by EpochGuard
+     *
+     * @param claim item to place into empty slot, stays owned by caller if not placed
+     * @param claimed output flag, set if claim has been placed
+     */
+    std::atomic<slot_type> *Lookup(Table *table, uint64_t hash, const std::string &key, Item *claim,
+                                   bool &claimed) const;
+
+    /**
+     * Common part of all updates: CAS new item into key's slot if current state is accepted
+     * by the given mode
+     */
+    enum class Mode { kAny, kIfAbsent, kIfPresent, kDelete };
+    bool Update(const std::string &key, const std::string *value, time_t expire_at, Mode mode);
+
+    /**
+     * Replaces visible item of the key by the one built from it. Builder is called with the
+     * current item and returns the replacement or nullptr to give up, it might be called several
+     * times if slot gets changed concurrently. Returns false if key is absent or builder gave up
+     */
+    template <typename F> bool Modify(const std::string &key, F &&build);
+
+    /**
+     * Common part of GetPinned and GetVersioned: references value of the key by the handle and
+     * stores its version if requested
+     */
+    bool Pin(const std::string &key, PinnedValue &value, uint64_t *version) const;
+
+    /**
+     * Called after live item has been added, evicts items exceeding the limit and rebuilds
+     * the table if it is too full of tombstones
+     */
+    void AfterInsert();
+
+    /**
+     * Turns one live item into a tombstone according to CLOCK policy
+     */
+    void Evict();
+
+    /**
+     * Turns live item in the given slot into a tombstone unless slot has changed meanwhile.
+     * Caller must hold _rebuild_lock shared and be pinned by EpochGuard
+     */
+    bool Kill(std::atomic<slot_type> &slot, slot_type s);
+
+    /**
+     * Replaces current table with a new one containing live items only. Must be called
+     * under exclusive _rebuild_lock
+     */
+    void Rebuild();
+
+    const size_t _max_size;
+
+    // Number of live items
+    std::atomic<size_t> _size;
+
+    // CLOCK hand
+    std::atomic<size_t> _hand;
+
+    // Position where the next ReapExpired sweep starts
+    std::atomic<size_t> _reap_cursor;
+
+    // Last version given to an item
+    std::atomic<uint64_t> _version;
+
+    std::atomic<Table *> _table;
+
+    // Writers hold it shared, rebuild takes it exclusively
+    mutable SharedMutex _rebuild_lock;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_LOCK_FREE_HASH_IMPL_H
@@ -1,39 +1,279 @@
 #include "MapBasedGlobalLockImpl.h"
 
+#include <atomic>
 #include <mutex>
 
 namespace Afina {
 namespace Backend {
 
+// Maximum number of expiration timers processed by a single ReapExpired call
+static const size_t ReapBudget = 1024;
+
 // See MapBasedGlobalLockImpl.h
-bool MapBasedGlobalLockImpl::Put(const std::string &key, const std::string &value) {
+bool MapBasedGlobalLockImpl::Put(const std::string &key, const std::string &value, time_t expire_at) {
     std::unique_lock<std::mutex> guard(_lock);
-    return false;
+
+    auto it = _backend.find(key);
+    if (it != _backend.end()) {
+        Update(it, value, expire_at);
+        return true;
+    }
+
+    return Insert(key, value, expire_at);
 }
 
 // See MapBasedGlobalLockImpl.h
-bool MapBasedGlobalLockImpl::PutIfAbsent(const std::string &key, const std::string &value) {
+bool MapBasedGlobalLockImpl::PutReserved(const std::string &key, std::shared_ptr<std::string> value, time_t expire_at) {
     std::unique_lock<std::mutex> guard(_lock);
-    return false;
+
+    auto it = _backend.find(key);
+    if (it != _backend.end()) {
+        Update(it, std::move(value), expire_at);
+        return true;
+    }
+
+    return Insert(key, std::move(value), expire_at);
 }
 
 // See MapBasedGlobalLockImpl.h
-bool MapBasedGlobalLockImpl::Set(const std::string &key, const std::string &value) {
+bool MapBasedGlobalLockImpl::PutIfAbsent(const std::string &key, const std::string &value, time_t expire_at) {
     std::unique_lock<std::mutex> guard(_lock);
-    return false;
+
+    auto it = _backend.find(key);
+    if (it != _backend.end()) {
+        if (!it->second.Expired()) {
+            return false;
+        }
+        Update(it, value, expire_at);
+        return true;
+    }
+
+    return Insert(key, value, expire_at);
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Set(const std::string &key, const std::string &value, time_t expire_at) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    auto it = Find(key);
+    if (it == _backend.end()) {
+        return false;
+    }
+
+    Update(it, value, expire_at);
+    return true;
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Append(const std::string &key, const std::string &suffix) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    auto it = Find(key);
+    if (it == _backend.end()) {
+        return false;
+    }
+
+    Writable(it->second, it->second.value->size() + suffix.size()).append(suffix);
+    it->second.version = ++_version;
+    Touch(it->second);
+    return true;
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Prepend(const std::string &key, const std::string &prefix) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    auto it = Find(key);
+    if (it == _backend.end()) {
+        return false;
+    }
+
+    Writable(it->second, it->second.value->size() + prefix.size()).insert(0, prefix);
+    it->second.version = ++_version;
+    Touch(it->second);
+    return true;
+}
+
+// See MapBasedGlobalLockImpl.h
+CasResult MapBasedGlobalLockImpl::CompareAndSwap(const std::string &key, const std::string &value, uint64_t version,
+                                                 time_t expire_at) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    auto it = Find(key);
+    if (it == _backend.end()) {
+        return CasResult::kNotFound;
+    } else if (it->second.version != version) {
+        return CasResult::kExists;
+    }
+
+    Update(it, value, expire_at);
+    return CasResult::kStored;
 }
 
 // See MapBasedGlobalLockImpl.h
 bool MapBasedGlobalLockImpl::Delete(const std::string &key) {
     std::unique_lock<std::mutex> guard(_lock);
-    return false;
+
+    auto it = _backend.find(key);
+    if (it == _backend.end()) {
+        return false;
+    }
+
+    bool expired = it->second.Expired();
+    Erase(it);
+    return !expired;
 }
 
 // See MapBasedGlobalLockImpl.h
 bool MapBasedGlobalLockImpl::Get(const std::string &key, std::string &value) const {
     std::unique_lock<std::mutex> guard(*const_cast<std::mutex *>(&_lock));
-    return false;
+
+    auto it = Find(key);
+    if (it == _backend.end()) {
+        return false;
+    }
+
+    value = *it->second.value;
+    Touch(it->second);
+    return true;
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::GetPinned(const std::string &key, PinnedValue &value) const {
+    std::unique_lock<std::mutex> guard(*const_cast<std::mutex *>(&_lock));
+
+    auto it = Find(key);
+    if (it == _backend.end()) {
+        return false;
+    }
+
+    value = PinnedValue(it->second.value);
+    Touch(it->second);
+    return true;
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::GetVersioned(const std::string &key, PinnedValue &value, uint64_t &version) const {
+    std::unique_lock<std::mutex> guard(*const_cast<std::mutex *>(&_lock));
+
+    auto it = Find(key);
+    if (it == _backend.end()) {
+        return false;
+    }
+
+    value = PinnedValue(it->second.value);
+    version = it->second.version;
+    Touch(it->second);
+    return true;
 }
 
+// See MapBasedGlobalLockImpl.h
+void MapBasedGlobalLockImpl::ReapExpired(time_t now) {
+    std::unique_lock<std::mutex> guard(_lock);
+
+    _expiry.Advance(now, ReapBudget, [this, now](time_t deadline, const std::string &key) {
+        auto it = _backend.find(key);
+        // Timer is stale if entry has been recreated or got an earlier one since it was scheduled
+        if (it == _backend.end() || it->second.timer_at != deadline) {
+            return;
+        }
+
+        it->second.timer_at = 0;
+        if (it->second.expire_at != 0 && it->second.expire_at <= now) {
+            Erase(it);
+        } else {
+            // Expiration time has been moved further meanwhile
+            ScheduleExpiry(it);
+        }
+    });
+}
+
+// See MapBasedGlobalLockImpl.h
+MapBasedGlobalLockImpl::backend_type::iterator MapBasedGlobalLockImpl::Find(const std::string &key) const {
+    // Expired entries are left in place for ReapExpired, so Get stays free of map changes
+    auto &backend = const_cast<backend_type &>(_backend);
+    auto it = backend.find(key);
+    if (it != backend.end() && it->second.Expired()) {
+        return backend.end();
+    }
+    return it;
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Insert(const std::string &key, const std::string &value, time_t expire_at) {
+    return Insert(key, std::make_shared<std::string>(value), expire_at);
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Insert(const std::string &key, std::shared_ptr<std::string> value, time_t expire_at) {
+    if (_max_size == 0) {
+        return false;
+    }
+
+    while (_backend.size() >= _max_size) {
+        Erase(_backend.find(*_lru.back()));
+    }
+
+    Entry entry{std::move(value), _lru.end(), expire_at, ++_version, 0};
+    auto it = _backend.emplace(key, std::move(entry)).first;
+    it->second.lru = _lru.insert(_lru.begin(), &it->first);
+    ScheduleExpiry(it);
+    return true;
+}
+
+// See MapBasedGlobalLockImpl.h
+void MapBasedGlobalLockImpl::Update(backend_type::iterator it, const std::string &value, time_t expire_at) {
+    if (it->second.value.use_count() == 1) {
+        Writable(it->second, 0).assign(value);
+        Update(it, it->second.value, expire_at);
+    } else {
+        Update(it, std::make_shared<std::string>(value), expire_at);
+    }
+}
+
+// See MapBasedGlobalLockImpl.h
+void MapBasedGlobalLockImpl::Update(backend_type::iterator it, std::shared_ptr<std::string> value, time_t expire_at) {
+    it->second.value = std::move(value);
+    it->second.expire_at = expire_at;
+    it->second.version = ++_version;
+    ScheduleExpiry(it);
+    Touch(it->second);
+}
+
+// See MapBasedGlobalLockImpl.h
+void MapBasedGlobalLockImpl::ScheduleExpiry(backend_type::iterator it) {
+    // Pending timer fires no later than the entry expires, it takes care of the rest once fired
+    Entry &entry = it->second;
+    if (entry.expire_at != 0 && (entry.timer_at == 0 || entry.expire_at < entry.timer_at)) {
+        _expiry.Schedule(entry.expire_at, it->first);
+        entry.timer_at = entry.expire_at;
+    }
+}
+
+// See MapBasedGlobalLockImpl.h
+std::string &MapBasedGlobalLockImpl::Writable(Entry &entry, size_t capacity) {
+    if (entry.value.use_count() == 1) {
+        // Pins are taken under the lock, so no new one could appear. Fence pairs with the
+        // release of the last foreign reference, making its reads happen before our writes
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return *entry.value;
+    }
+
+    std::shared_ptr<std::string> copy = std::make_shared<std::string>();
+    copy->reserve(capacity);
+    copy->append(*entry.value);
+    entry.value = std::move(copy);
+    return *entry.value;
+}
+
+// See MapBasedGlobalLockImpl.h
+void MapBasedGlobalLockImpl::Erase(backend_type::iterator it) {
+    _lru.erase(it->second.lru);
+    _backend.erase(it);
+}
+
+// See MapBasedGlobalLockImpl.h
+void MapBasedGlobalLockImpl::Touch(Entry &entry) const { _lru.splice(_lru.begin(), _lru, entry.lru); }
+
 } // namespace Backend
 } // namespace Afina
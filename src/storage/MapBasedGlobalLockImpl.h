@@ -1,33 +1,54 @@
 #ifndef AFINA_STORAGE_MAP_BASED_GLOBAL_LOCK_IMPL_H
 #define AFINA_STORAGE_MAP_BASED_GLOBAL_LOCK_IMPL_H
 
+#include <cstdint>
+#include <ctime>
+#include <list>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 
 #include <afina/Storage.h>
 
+#include "TimingWheel.h"
+
 namespace Afina {
 namespace Backend {
 
 /**
  * # Map based implementation with global lock
+ * Keeps at most max_size associations, once limit is reached the least recently used
+ * one gets evicted to free space for the new key.
  *
- *
+ * All operations are serialized on the single mutex
  */
 class MapBasedGlobalLockImpl : public Afina::Storage {
 public:
-    MapBasedGlobalLockImpl(size_t max_size = 1024) : _max_size(max_size) {}
+    MapBasedGlobalLockImpl(size_t max_size = 1024) : _max_size(max_size), _version(0), _expiry(time(nullptr)) {}
     ~MapBasedGlobalLockImpl() {}
 
     // Implements Afina::Storage interface
-    bool Put(const std::string &key, const std::string &value) override;
+    bool Put(const std::string &key, const std::string &value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool PutReserved(const std::string &key, std::shared_ptr<std::string> value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value, time_t expire_at = 0) override;
 
     // Implements Afina::Storage interface
-    bool PutIfAbsent(const std::string &key, const std::string &value) override;
+    bool Append(const std::string &key, const std::string &suffix) override;
 
     // Implements Afina::Storage interface
-    bool Set(const std::string &key, const std::string &value) override;
+    bool Prepend(const std::string &key, const std::string &prefix) override;
+
+    // Implements Afina::Storage interface
+    CasResult CompareAndSwap(const std::string &key, const std::string &value, uint64_t version,
+                             time_t expire_at = 0) override;
 
     // Implements Afina::Storage interface
     bool Delete(const std::string &key) override;
@@ -35,12 +56,92 @@ public:
     // Implements Afina::Storage interface
     bool Get(const std::string &key, std::string &value) const override;
 
+    // Implements Afina::Storage interface
+    bool GetPinned(const std::string &key, PinnedValue &value) const override;
+
+    // Implements Afina::Storage interface
+    bool GetVersioned(const std::string &key, PinnedValue &value, uint64_t &version) const override;
+
+    // Implements Afina::Storage interface
+    void ReapExpired(time_t now) override;
+
 private:
+    struct Entry;
+    typedef std::map<std::string, Entry> backend_type;
+
+    // Recency list, most recently used key is in the front. Points to keys owned by _backend
+    // nodes, those are stable until erased
+    typedef std::list<const std::string *> lru_type;
+
+    struct Entry {
+        // Changed in place only while entry holds the only reference, pinned strings are
+        // replaced by a modified copy instead
+        std::shared_ptr<std::string> value;
+        lru_type::iterator lru;
+        time_t expire_at;
+        uint64_t version;
+
+        // Deadline of the timer pending for the entry, 0 if there is none
+        time_t timer_at;
+
+        bool Expired() const { return expire_at != 0 && expire_at <= time(nullptr); }
+    };
+
+    /**
+     * Returns iterator to the live entry for the key or end() if there is no such one.
+     * Must be called under the lock
+     */
+    backend_type::iterator Find(const std::string &key) const;
+
+    /**
+     * Creates new association, evicting the least recently used one if storage is full.
+     * Must be called under the lock and only for keys not present in storage
+     */
+    bool Insert(const std::string &key, const std::string &value, time_t expire_at);
+    bool Insert(const std::string &key, std::shared_ptr<std::string> value, time_t expire_at);
+
+    /**
+     * Replaces value of the existing entry. Must be called under the lock
+     */
+    void Update(backend_type::iterator it, const std::string &value, time_t expire_at);
+    void Update(backend_type::iterator it, std::shared_ptr<std::string> value, time_t expire_at);
+
+    /**
+     * Makes sure a timer fires by the time entry expires, entry keeps at most one timer pending.
+     * Must be called under the lock
+     */
+    void ScheduleExpiry(backend_type::iterator it);
+
+    /**
+     * Returns value of the entry that could be modified in place, copying it first if it is
+     * pinned. Copy gets given capacity. Must be called under the lock
+     */
+    std::string &Writable(Entry &entry, size_t capacity);
+
+    /**
+     * Removes entry. Must be called under the lock
+     */
+    void Erase(backend_type::iterator it);
+
+    /**
+     * Marks given entry as the most recently used one. Must be called under the lock
+     */
+    void Touch(Entry &entry) const;
+
     std::mutex _lock;
 
     size_t _max_size;
 
-    std::map<std::string, std::string> _backend;
+    backend_type _backend;
+
+    // Last version given to an entry
+    uint64_t _version;
+
+    // Get is logically read-only but still updates recency order
+    mutable lru_type _lru;
+
+    // Keys of entries with expiration time
+    TimingWheel<std::string> _expiry;
 };
 
 } // namespace Backend
@@ -0,0 +1,305 @@
+#include "MapBasedRWLockImpl.h"
+
+#include <atomic>
+#include <mutex>
+#include <tuple>
+
+namespace Afina {
+namespace Backend {
+
+// Maximum number of expiration timers processed by a single ReapExpired call
+static const size_t ReapBudget = 1024;
+
+// See MapBasedRWLockImpl.h
+bool MapBasedRWLockImpl::Put(const std::string &key, const std::string &value, time_t expire_at) {
+    std::unique_lock<SharedMutex> guard(_lock);
+
+    auto it = _backend.find(key);
+    if (it != _backend.end()) {
+        Update(it, value, expire_at);
+        return true;
+    }
+
+    return Insert(key, value, expire_at);
+}
+
+// See MapBasedRWLockImpl.h
+bool MapBasedRWLockImpl::PutReserved(const std::string &key, std::shared_ptr<std::string> value, time_t expire_at) {
+    std::unique_lock<SharedMutex> guard(_lock);
+
+    auto it = _backend.find(key);
+    if (it != _backend.end()) {
+        Update(it, std::move(value), expire_at);
+        return true;
+    }
+
+    return Insert(key, std::move(value), expire_at);
+}
+
+// See MapBasedRWLockImpl.h
+bool MapBasedRWLockImpl::PutIfAbsent(const std::string &key, const std::string &value, time_t expire_at) {
+    std::unique_lock<SharedMutex> guard(_lock);
+
+    auto it = _backend.find(key);
+    if (it != _backend.end()) {
+        if (!it->second.Expired()) {
+            return false;
+        }
+        Update(it, value, expire_at);
+        return true;
+    }
+
+    return Insert(key, value, expire_at);
+}
+
+// See MapBasedRWLockImpl.h
+bool MapBasedRWLockImpl::Set(const std::string &key, const std::string &value, time_t expire_at) {
+    std::unique_lock<SharedMutex> guard(_lock);
+
+    auto it = _backend.find(key);
+    if (it == _backend.end() || it->second.Expired()) {
+        return false;
+    }
+
+    Update(it, value, expire_at);
+    return true;
+}
+
+// See MapBasedRWLockImpl.h
+bool MapBasedRWLockImpl::Append(const std::string &key, const std::string &suffix) {
+    std::unique_lock<SharedMutex> guard(_lock);
+
+    auto it = _backend.find(key);
+    if (it == _backend.end() || it->second.Expired()) {
+        return false;
+    }
+
+    Writable(it->second, it->second.value->size() + suffix.size()).append(suffix);
+    it->second.version = ++_version;
+    it->second.referenced.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+// See MapBasedRWLockImpl.h
+bool MapBasedRWLockImpl::Prepend(const std::string &key, const std::string &prefix) {
+    std::unique_lock<SharedMutex> guard(_lock);
+
+    auto it = _backend.find(key);
+    if (it == _backend.end() || it->second.Expired()) {
+        return false;
+    }
+
+    Writable(it->second, it->second.value->size() + prefix.size()).insert(0, prefix);
+    it->second.version = ++_version;
+    it->second.referenced.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+// See MapBasedRWLockImpl.h
+CasResult MapBasedRWLockImpl::CompareAndSwap(const std::string &key, const std::string &value, uint64_t version,
+                                             time_t expire_at) {
+    std::unique_lock<SharedMutex> guard(_lock);
+
+    auto it = _backend.find(key);
+    if (it == _backend.end() || it->second.Expired()) {
+        return CasResult::kNotFound;
+    } else if (it->second.version != version) {
+        return CasResult::kExists;
+    }
+
+    Update(it, value, expire_at);
+    return CasResult::kStored;
+}
+
+// See MapBasedRWLockImpl.h
+bool MapBasedRWLockImpl::Delete(const std::string &key) {
+    std::unique_lock<SharedMutex> guard(_lock);
+
+    auto it = _backend.find(key);
+    if (it == _backend.end()) {
+        return false;
+    }
+
+    bool expired = it->second.Expired();
+    Erase(it);
+    return !expired;
+}
+
+// See MapBasedRWLockImpl.h
+bool MapBasedRWLockImpl::Get(const std::string &key, std::string &value) const {
+    SharedLock<SharedMutex> guard(_lock);
+
+    auto it = Find(key);
+    if (it == _backend.end()) {
+        return false;
+    }
+
+    value = *it->second.value;
+
+    // Avoid writing cache line shared between readers if bit is set already
+    if (!it->second.referenced.load(std::memory_order_relaxed)) {
+        it->second.referenced.store(true, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+// See MapBasedRWLockImpl.h
+bool MapBasedRWLockImpl::GetPinned(const std::string &key, PinnedValue &value) const {
+    SharedLock<SharedMutex> guard(_lock);
+
+    auto it = Find(key);
+    if (it == _backend.end()) {
+        return false;
+    }
+
+    value = PinnedValue(it->second.value);
+    if (!it->second.referenced.load(std::memory_order_relaxed)) {
+        it->second.referenced.store(true, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+// See MapBasedRWLockImpl.h
+bool MapBasedRWLockImpl::GetVersioned(const std::string &key, PinnedValue &value, uint64_t &version) const {
+    SharedLock<SharedMutex> guard(_lock);
+
+    auto it = Find(key);
+    if (it == _backend.end()) {
+        return false;
+    }
+
+    value = PinnedValue(it->second.value);
+    version = it->second.version;
+    if (!it->second.referenced.load(std::memory_order_relaxed)) {
+        it->second.referenced.store(true, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+// See MapBasedRWLockImpl.h
+void MapBasedRWLockImpl::ReapExpired(time_t now) {
+    std::unique_lock<SharedMutex> guard(_lock);
+
+    _expiry.Advance(now, ReapBudget, [this, now](time_t deadline, const std::string &key) {
+        auto it = _backend.find(key);
+        // Timer is stale if entry has been recreated or got an earlier one since it was scheduled
+        if (it == _backend.end() || it->second.timer_at != deadline) {
+            return;
+        }
+
+        it->second.timer_at = 0;
+        if (it->second.expire_at != 0 && it->second.expire_at <= now) {
+            Erase(it);
+        } else {
+            // Expiration time has been moved further meanwhile
+            ScheduleExpiry(it);
+        }
+    });
+}
+
+// See MapBasedRWLockImpl.h
+MapBasedRWLockImpl::backend_type::const_iterator MapBasedRWLockImpl::Find(const std::string &key) const {
+    // Readers can't erase under the shared lock, expired entries wait for writers or ReapExpired
+    auto it = _backend.find(key);
+    if (it != _backend.end() && it->second.Expired()) {
+        return _backend.end();
+    }
+    return it;
+}
+
+// See MapBasedRWLockImpl.h
+bool MapBasedRWLockImpl::Insert(const std::string &key, const std::string &value, time_t expire_at) {
+    return Insert(key, std::make_shared<std::string>(value), expire_at);
+}
+
+// See MapBasedRWLockImpl.h
+bool MapBasedRWLockImpl::Insert(const std::string &key, std::shared_ptr<std::string> value, time_t expire_at) {
+    if (_max_size == 0) {
+        return false;
+    }
+
+    while (_backend.size() >= _max_size) {
+        Evict();
+    }
+
+    auto it = _backend.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple()).first;
+    it->second.value = std::move(value);
+    it->second.pos = _clock.insert(_clock.end(), &it->first);
+    it->second.expire_at = expire_at;
+    it->second.version = ++_version;
+    ScheduleExpiry(it);
+    return true;
+}
+
+// See MapBasedRWLockImpl.h
+void MapBasedRWLockImpl::Update(backend_type::iterator it, const std::string &value, time_t expire_at) {
+    if (it->second.value.use_count() == 1) {
+        Writable(it->second, 0).assign(value);
+        Update(it, it->second.value, expire_at);
+    } else {
+        Update(it, std::make_shared<std::string>(value), expire_at);
+    }
+}
+
+// See MapBasedRWLockImpl.h
+void MapBasedRWLockImpl::Update(backend_type::iterator it, std::shared_ptr<std::string> value, time_t expire_at) {
+    it->second.value = std::move(value);
+    it->second.referenced.store(true, std::memory_order_relaxed);
+    it->second.expire_at = expire_at;
+    it->second.version = ++_version;
+    ScheduleExpiry(it);
+}
+
+// See MapBasedRWLockImpl.h
+void MapBasedRWLockImpl::ScheduleExpiry(backend_type::iterator it) {
+    // Pending timer fires no later than the entry expires, it takes care of the rest once fired
+    Entry &entry = it->second;
+    if (entry.expire_at != 0 && (entry.timer_at == 0 || entry.expire_at < entry.timer_at)) {
+        _expiry.Schedule(entry.expire_at, it->first);
+        entry.timer_at = entry.expire_at;
+    }
+}
+
+// See MapBasedRWLockImpl.h
+std::string &MapBasedRWLockImpl::Writable(Entry &entry, size_t capacity) {
+    if (entry.value.use_count() == 1) {
+        // Readers pin values under the shared lock, so no new pin could appear. Fence pairs with
+        // the release of the last foreign reference, making its reads happen before our writes
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return *entry.value;
+    }
+
+    std::shared_ptr<std::string> copy = std::make_shared<std::string>();
+    copy->reserve(capacity);
+    copy->append(*entry.value);
+    entry.value = std::move(copy);
+    return *entry.value;
+}
+
+// See MapBasedRWLockImpl.h
+void MapBasedRWLockImpl::Erase(backend_type::iterator it) {
+    _clock.erase(it->second.pos);
+    _backend.erase(it);
+}
+
+// See MapBasedRWLockImpl.h
+void MapBasedRWLockImpl::Evict() {
+    // Terminates after at most one full round: every referenced entry gets its bit
+    // cleared when hand passes it
+    while (true) {
+        const std::string *key = _clock.front();
+        auto it = _backend.find(*key);
+        if (it->second.referenced.load(std::memory_order_relaxed) && !it->second.Expired()) {
+            it->second.referenced.store(false, std::memory_order_relaxed);
+            _clock.splice(_clock.end(), _clock, _clock.begin());
+            continue;
+        }
+
+        _clock.pop_front();
+        _backend.erase(it);
+        return;
+    }
+}
+
+} // namespace Backend
+} // namespace Afina
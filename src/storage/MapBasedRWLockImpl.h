@@ -0,0 +1,157 @@
+#ifndef AFINA_STORAGE_MAP_BASED_RW_LOCK_IMPL_H
+#define AFINA_STORAGE_MAP_BASED_RW_LOCK_IMPL_H
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <afina/Storage.h>
+
+#include "SharedMutex.h"
+#include "TimingWheel.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Map based implementation with reader/writer lock
+ * Tuned for read-mostly workloads: Get holds the lock in shared mode, so any number of readers
+ * proceed in parallel, while Put/PutIfAbsent/Set/Delete take it exclusively.
+ *
+ * As readers can't reorder a list under the shared lock, eviction uses CLOCK (second chance)
+ * approximation of LRU: Get only raises the entry's reference bit, and eviction walks entries
+ * in insertion order, giving referenced ones another round instead of evicting them
+ */
+class MapBasedRWLockImpl : public Afina::Storage {
+public:
+    MapBasedRWLockImpl(size_t max_size = 1024) : _max_size(max_size), _version(0), _expiry(time(nullptr)) {}
+    ~MapBasedRWLockImpl() {}
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool PutReserved(const std::string &key, std::shared_ptr<std::string> value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Append(const std::string &key, const std::string &suffix) override;
+
+    // Implements Afina::Storage interface
+    bool Prepend(const std::string &key, const std::string &prefix) override;
+
+    // Implements Afina::Storage interface
+    CasResult CompareAndSwap(const std::string &key, const std::string &value, uint64_t version,
+                             time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override;
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) const override;
+
+    // Implements Afina::Storage interface
+    bool GetPinned(const std::string &key, PinnedValue &value) const override;
+
+    // Implements Afina::Storage interface
+    bool GetVersioned(const std::string &key, PinnedValue &value, uint64_t &version) const override;
+
+    // Implements Afina::Storage interface
+    void ReapExpired(time_t now) override;
+
+private:
+    struct Entry;
+    typedef std::unordered_map<std::string, Entry> backend_type;
+
+    // Eviction queue, clock hand is always at the front. Points to keys owned by _backend
+    // nodes, those are stable until erased
+    typedef std::list<const std::string *> clock_type;
+
+    struct Entry {
+        // Changed in place only while entry holds the only reference, pinned strings are
+        // replaced by a modified copy instead
+        std::shared_ptr<std::string> value;
+        clock_type::iterator pos;
+        time_t expire_at;
+        uint64_t version;
+
+        // Deadline of the timer pending for the entry, 0 if there is none
+        time_t timer_at;
+
+        // Set by readers, cleared by the clock hand
+        mutable std::atomic<bool> referenced;
+
+        Entry() : expire_at(0), version(0), timer_at(0), referenced(false) {}
+
+        bool Expired() const { return expire_at != 0 && expire_at <= time(nullptr); }
+    };
+
+    /**
+     * Returns iterator to the live entry for the key or end() if there is no such one.
+     * Must be called under the lock, either shared or exclusive
+     */
+    backend_type::const_iterator Find(const std::string &key) const;
+
+    /**
+     * Creates new association, evicting entries if storage is full. Must be called under
+     * exclusive lock and only for keys not present in storage
+     */
+    bool Insert(const std::string &key, const std::string &value, time_t expire_at);
+    bool Insert(const std::string &key, std::shared_ptr<std::string> value, time_t expire_at);
+
+    /**
+     * Replaces value of the existing entry. Must be called under exclusive lock
+     */
+    void Update(backend_type::iterator it, const std::string &value, time_t expire_at);
+    void Update(backend_type::iterator it, std::shared_ptr<std::string> value, time_t expire_at);
+
+    /**
+     * Makes sure a timer fires by the time entry expires, entry keeps at most one timer pending.
+     * Must be called under exclusive lock
+     */
+    void ScheduleExpiry(backend_type::iterator it);
+
+    /**
+     * Returns value of the entry that could be modified in place, copying it first if it is
+     * pinned. Copy gets given capacity. Must be called under exclusive lock
+     */
+    std::string &Writable(Entry &entry, size_t capacity);
+
+    /**
+     * Removes entry. Must be called under exclusive lock
+     */
+    void Erase(backend_type::iterator it);
+
+    /**
+     * Evicts one entry according to CLOCK policy. Must be called under exclusive lock
+     */
+    void Evict();
+
+    mutable SharedMutex _lock;
+
+    size_t _max_size;
+
+    backend_type _backend;
+
+    // Last version given to an entry
+    uint64_t _version;
+
+    clock_type _clock;
+
+    // Keys of entries with expiration time
+    TimingWheel<std::string> _expiry;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_MAP_BASED_RW_LOCK_IMPL_H
@@ -0,0 +1,68 @@
+#ifndef AFINA_STORAGE_SHARED_MUTEX_H
+#define AFINA_STORAGE_SHARED_MUTEX_H
+
+#include <pthread.h>
+#include <stdexcept>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Reader/writer mutex
+ * Allows either many concurrent shared owners or a single exclusive one. Same interface as
+ * C++17 std::shared_mutex, so it works with std::unique_lock for exclusive ownership and with
+ * SharedLock below for the shared one.
+ *
+ * Writers are preferred: once writer is waiting new readers are blocked, so a constant stream
+ * of readers can't starve updates
+ */
+class SharedMutex {
+public:
+    SharedMutex() {
+        pthread_rwlockattr_t attr;
+        pthread_rwlockattr_init(&attr);
+        pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+        int rc = pthread_rwlock_init(&_lock, &attr);
+        pthread_rwlockattr_destroy(&attr);
+        if (rc != 0) {
+            throw std::runtime_error("Failed to init rwlock");
+        }
+    }
+    ~SharedMutex() { pthread_rwlock_destroy(&_lock); }
+
+    SharedMutex(const SharedMutex &) = delete;
+    SharedMutex &operator=(const SharedMutex &) = delete;
+
+    // Exclusive ownership
+    void lock() { pthread_rwlock_wrlock(&_lock); }
+    bool try_lock() { return pthread_rwlock_trywrlock(&_lock) == 0; }
+    void unlock() { pthread_rwlock_unlock(&_lock); }
+
+    // Shared ownership
+    void lock_shared() { pthread_rwlock_rdlock(&_lock); }
+    bool try_lock_shared() { return pthread_rwlock_tryrdlock(&_lock) == 0; }
+    void unlock_shared() { pthread_rwlock_unlock(&_lock); }
+
+private:
+    pthread_rwlock_t _lock;
+};
+
+/**
+ * RAII wrapper holding shared ownership of the mutex for the scope lifetime
+ */
+template <typename Mutex> class SharedLock {
+public:
+    explicit SharedLock(Mutex &m) : _m(m) { _m.lock_shared(); }
+    ~SharedLock() { _m.unlock_shared(); }
+
+    SharedLock(const SharedLock &) = delete;
+    SharedLock &operator=(const SharedLock &) = delete;
+
+private:
+    Mutex &_m;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_SHARED_MUTEX_H
@@ -0,0 +1,98 @@
+#include "StripedLockImpl.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace Afina {
+namespace Backend {
+
+// See StripedLockImpl.h
+StripedLockImpl::StripedLockImpl(size_t max_size, size_t stripes) {
+    if (stripes == 0) {
+        throw std::invalid_argument("Number of stripes must be positive");
+    }
+
+    // Every shard holds at least one item, otherwise keys hashed to it could never be stored
+    if (max_size > 0 && stripes > max_size) {
+        stripes = max_size;
+    }
+
+    // Shards capacity sums up exactly to max_size, the first max_size % stripes ones take an extra item
+    size_t shard_size = max_size / stripes;
+    size_t remainder = max_size % stripes;
+    _shards.reserve(stripes);
+    for (size_t i = 0; i < stripes; i++) {
+        _shards.emplace_back(new MapBasedGlobalLockImpl(shard_size + (i < remainder ? 1 : 0)));
+    }
+}
+
+// See StripedLockImpl.h
+bool StripedLockImpl::Put(const std::string &key, const std::string &value, time_t expire_at) {
+    return Shard(key).Put(key, value, expire_at);
+}
+
+// Value isn't bound to a key until it is put, all shards reserve it the same way
+std::shared_ptr<std::string> StripedLockImpl::ReserveValue(size_t size) { return _shards.front()->ReserveValue(size); }
+
+// See StripedLockImpl.h
+bool StripedLockImpl::PutReserved(const std::string &key, std::shared_ptr<std::string> value, time_t expire_at) {
+    return Shard(key).PutReserved(key, std::move(value), expire_at);
+}
+
+// See StripedLockImpl.h
+bool StripedLockImpl::PutIfAbsent(const std::string &key, const std::string &value, time_t expire_at) {
+    return Shard(key).PutIfAbsent(key, value, expire_at);
+}
+
+// See StripedLockImpl.h
+bool StripedLockImpl::Set(const std::string &key, const std::string &value, time_t expire_at) {
+    return Shard(key).Set(key, value, expire_at);
+}
+
+// See StripedLockImpl.h
+bool StripedLockImpl::Append(const std::string &key, const std::string &suffix) {
+    return Shard(key).Append(key, suffix);
+}
+
+// See StripedLockImpl.h
+bool StripedLockImpl::Prepend(const std::string &key, const std::string &prefix) {
+    return Shard(key).Prepend(key, prefix);
+}
+
+// See StripedLockImpl.h
+CasResult StripedLockImpl::CompareAndSwap(const std::string &key, const std::string &value, uint64_t version,
+                                          time_t expire_at) {
+    return Shard(key).CompareAndSwap(key, value, version, expire_at);
+}
+
+// See StripedLockImpl.h
+bool StripedLockImpl::Delete(const std::string &key) { return Shard(key).Delete(key); }
+
+// See StripedLockImpl.h
+bool StripedLockImpl::Get(const std::string &key, std::string &value) const { return Shard(key).Get(key, value); }
+
+// See StripedLockImpl.h
+bool StripedLockImpl::GetPinned(const std::string &key, PinnedValue &value) const {
+    return Shard(key).GetPinned(key, value);
+}
+
+// See StripedLockImpl.h
+bool StripedLockImpl::GetVersioned(const std::string &key, PinnedValue &value, uint64_t &version) const {
+    return Shard(key).GetVersioned(key, value, version);
+}
+
+// See StripedLockImpl.h
+void StripedLockImpl::ReapExpired(time_t now) {
+    // Shards are locked one by one, so reaping never stalls the whole storage
+    for (auto &shard : _shards) {
+        shard->ReapExpired(now);
+    }
+}
+
+// See StripedLockImpl.h
+MapBasedGlobalLockImpl &StripedLockImpl::Shard(const std::string &key) const {
+    return *_shards[_hash(key) % _shards.size()];
+}
+
+} // namespace Backend
+} // namespace Afina
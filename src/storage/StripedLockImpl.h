@@ -0,0 +1,84 @@
+#ifndef AFINA_STORAGE_STRIPED_LOCK_IMPL_H
+#define AFINA_STORAGE_STRIPED_LOCK_IMPL_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <afina/Storage.h>
+
+#include "MapBasedGlobalLockImpl.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Lock striped implementation
+ * Keys are hashed onto a fixed number of shards, each shard is an independent map based
+ * storage with its own lock and LRU list. Operations on keys from different shards never
+ * contend with each other.
+ *
+ * Global max_size limit is split evenly between shards, there are never more shards than
+ * max_size. Eviction order is LRU within a shard and only approximates global LRU
+ */
+class StripedLockImpl : public Afina::Storage {
+public:
+    StripedLockImpl(size_t max_size = 1024, size_t stripes = 16);
+    ~StripedLockImpl() {}
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    std::shared_ptr<std::string> ReserveValue(size_t size) override;
+
+    // Implements Afina::Storage interface
+    bool PutReserved(const std::string &key, std::shared_ptr<std::string> value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value, time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Append(const std::string &key, const std::string &suffix) override;
+
+    // Implements Afina::Storage interface
+    bool Prepend(const std::string &key, const std::string &prefix) override;
+
+    // Implements Afina::Storage interface
+    CasResult CompareAndSwap(const std::string &key, const std::string &value, uint64_t version,
+                             time_t expire_at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override;
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) const override;
+
+    // Implements Afina::Storage interface
+    bool GetPinned(const std::string &key, PinnedValue &value) const override;
+
+    // Implements Afina::Storage interface
+    bool GetVersioned(const std::string &key, PinnedValue &value, uint64_t &version) const override;
+
+    // Implements Afina::Storage interface
+    void ReapExpired(time_t now) override;
+
+private:
+    /**
+     * Returns shard responsible for the given key
+     */
+    MapBasedGlobalLockImpl &Shard(const std::string &key) const;
+
+    std::hash<std::string> _hash;
+
+    std::vector<std::unique_ptr<MapBasedGlobalLockImpl>> _shards;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_STRIPED_LOCK_IMPL_H
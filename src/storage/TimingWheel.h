@@ -0,0 +1,132 @@
+#ifndef AFINA_STORAGE_TIMING_WHEEL_H
+#define AFINA_STORAGE_TIMING_WHEEL_H
+
+#include <cstddef>
+#include <ctime>
+#include <utility>
+#include <vector>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Hierarchical timing wheel
+ * Keeps values scheduled to fire at some second in future. Level 0 has a slot per second,
+ * every next level has a slot per whole turn of the previous one. Once time reaches slot of
+ * the upper level its timers are cascaded down, so each timer is touched O(levels) times
+ * and firing never requires scanning all of them.
+ *
+ * Timers can't be cancelled: owner is expected to check whether the fired value is still
+ * relevant, e.g compare its current expiration time against the fired deadline. Not thread safe
+ */
+template <typename T> class TimingWheel {
+public:
+    TimingWheel(time_t now) : _current(now), _size(0) {}
+
+    /**
+     * Schedules value to fire once time reaches deadline. Deadline in the past fires on the
+     * next Advance
+     */
+    void Schedule(time_t deadline, T value) {
+        _size++;
+        Place(Timer{deadline, std::move(value)});
+    }
+
+    /**
+     * Moves time forward up to now, calling expired(deadline, value) for timers that are due.
+     * Stops after budget timers fired, the rest fire on subsequent calls
+     *
+     * @return number of timers fired
+     */
+    template <typename F> size_t Advance(time_t now, size_t budget, F &&expired) {
+        size_t fired = 0;
+        while (_current <= now) {
+            std::vector<Timer> &slot = _slots[0][_current & Mask];
+            while (!slot.empty()) {
+                if (fired == budget) {
+                    return fired;
+                }
+
+                Timer timer = std::move(slot.back());
+                slot.pop_back();
+                if (timer.deadline > now) {
+                    // Deadline was beyond the wheel horizon when scheduled
+                    Place(std::move(timer));
+                    continue;
+                }
+
+                _size--;
+                fired++;
+                expired(timer.deadline, timer.value);
+            }
+
+            if (_current == now) {
+                break;
+            }
+            _current++;
+            Cascade();
+        }
+        return fired;
+    }
+
+    /**
+     * Number of scheduled timers
+     */
+    size_t size() const { return _size; }
+
+private:
+    static const unsigned Bits = 6;
+    static const size_t Slots = 1 << Bits;
+    static const size_t Mask = Slots - 1;
+    static const unsigned Levels = 5;
+
+    struct Timer {
+        time_t deadline;
+        T value;
+    };
+
+    void Place(Timer timer) {
+        if (timer.deadline <= _current) {
+            _slots[0][_current & Mask].push_back(std::move(timer));
+            return;
+        }
+
+        time_t delta = timer.deadline - _current;
+        unsigned level = 0;
+        while (level + 1 < Levels && delta >= (time_t(1) << (Bits * (level + 1)))) {
+            level++;
+        }
+
+        size_t slot = (timer.deadline >> (Bits * level)) & Mask;
+        _slots[level][slot].push_back(std::move(timer));
+    }
+
+    // Called once time moves into the next second: every level whose turn begins right now
+    // redistributes its current slot into lower levels
+    void Cascade() {
+        unsigned level = 1;
+        while (level < Levels && ((_current >> (Bits * (level - 1))) & Mask) == 0) {
+            level++;
+        }
+
+        for (unsigned l = level - 1; l > 0; l--) {
+            std::vector<Timer> timers;
+            timers.swap(_slots[l][(_current >> (Bits * l)) & Mask]);
+            for (auto &timer : timers) {
+                Place(std::move(timer));
+            }
+        }
+    }
+
+    std::vector<Timer> _slots[Levels][Slots];
+
+    // Second being processed, all timers for earlier seconds have fired
+    time_t _current;
+
+    size_t _size;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_TIMING_WHEEL_H
@@ -0,0 +1,151 @@
+#include "gtest/gtest.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <afina/allocator/Concurrent.h>
+#include <afina/allocator/Error.h>
+#include <afina/allocator/Pointer.h>
+#include <afina/allocator/Simple.h>
+
+using namespace std;
+using namespace Afina::Allocator;
+
+static char arena[4 * 1024 * 1024];
+
+TEST(ConcurrentTest, AllocFree) {
+    Concurrent a(arena, sizeof(arena));
+
+    vector<Pointer> ptrs;
+    for (size_t size = 1; size < 4096; size += 37) {
+        ptrs.push_back(a.alloc(size));
+        memset(ptrs.back().get(), char(size), size);
+    }
+
+    size_t size = 1;
+    for (Pointer &p : ptrs) {
+        char *v = static_cast<char *>(p.get());
+        for (size_t i = 0; i < size; i++) {
+            ASSERT_EQ(char(size), v[i]);
+        }
+        a.free(p, size);
+        EXPECT_EQ(nullptr, p.get());
+        size += 37;
+    }
+}
+
+TEST(ConcurrentTest, CrossThreadFree) {
+    Concurrent a(arena, sizeof(arena));
+
+    // Blocks allocated by one thread and freed by another end up in the second thread magazines
+    vector<Pointer> ptrs;
+    for (int i = 0; i < 1000; i++) {
+        ptrs.push_back(a.alloc(100));
+        memset(ptrs.back().get(), 1, 100);
+    }
+
+    std::thread t([&]() {
+        for (Pointer &p : ptrs) {
+            a.free(p, 100);
+        }
+        for (int i = 0; i < 1000; i++) {
+            Pointer p = a.alloc(100);
+            a.free(p, 100);
+        }
+    });
+    t.join();
+}
+
+TEST(ConcurrentTest, ThreadExitDrains) {
+    const size_t size = 256 * 1024;
+    vector<char> small(size);
+    Concurrent a(small.data(), small.size());
+
+    // Exited threads must not keep memory cached
+    for (int round = 0; round < 8; round++) {
+        std::thread t([&]() {
+            vector<Pointer> ptrs;
+            try {
+                while (true) {
+                    ptrs.push_back(a.alloc(500));
+                }
+            } catch (AllocError &) {
+            }
+            EXPECT_GT(ptrs.size(), 100);
+            for (Pointer &p : ptrs) {
+                a.free(p, 500);
+            }
+        });
+        t.join();
+    }
+
+    Pointer p = a.alloc(size / 2);
+    a.free(p, size / 2);
+}
+
+// Runs alloc/free churn of small blocks in the given number of threads, returns operations per second
+template <typename Alloc, typename Free>
+static double Throughput(int threads, long total_ops, Alloc &&alloc_fn, Free &&free_fn) {
+    long ops = total_ops / threads;
+    std::vector<std::thread> workers;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            const size_t slots = 64;
+            vector<Pointer> live(slots);
+            vector<size_t> sizes(slots, 0);
+            unsigned seed = t + 1;
+            for (long i = 0; i < ops; i++) {
+                seed = seed * 1103515245 + 12345;
+                size_t slot = (seed >> 8) % slots;
+                if (sizes[slot] != 0) {
+                    free_fn(live[slot], sizes[slot]);
+                }
+                sizes[slot] = 16 + (seed >> 16) % 496;
+                live[slot] = alloc_fn(sizes[slot]);
+                static_cast<char *>(live[slot].get())[0] = 1;
+            }
+            for (size_t slot = 0; slot < slots; slot++) {
+                if (sizes[slot] != 0) {
+                    free_fn(live[slot], sizes[slot]);
+                }
+            }
+        });
+    }
+    for (std::thread &w : workers) {
+        w.join();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return (ops * threads) / elapsed.count();
+}
+
+TEST(ConcurrentTest, ThroughputScaling) {
+    const long total_ops = 400000;
+    std::cout << "threads\tsimple+mutex ops/s\tmagazines ops/s" << std::endl;
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        Simple simple(arena, sizeof(arena));
+        std::mutex lock;
+        double s = Throughput(threads, total_ops,
+                              [&](size_t size) {
+                                  std::unique_lock<std::mutex> guard(lock);
+                                  return simple.alloc(size);
+                              },
+                              [&](Pointer &p, size_t) {
+                                  std::unique_lock<std::mutex> guard(lock);
+                                  simple.free(p);
+                              });
+
+        Concurrent concurrent(arena, sizeof(arena));
+        double c = Throughput(threads, total_ops, [&](size_t size) { return concurrent.alloc(size); },
+                              [&](Pointer &p, size_t size) { concurrent.free(p, size); });
+
+        std::cout << threads << "\t" << long(s) << "\t\t\t" << long(c) << std::endl;
+        EXPECT_GT(s, 0);
+        EXPECT_GT(c, 0);
+    }
+}
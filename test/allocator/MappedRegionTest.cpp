@@ -0,0 +1,56 @@
+#include "gtest/gtest.h"
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include <afina/allocator/MappedRegion.h>
+#include <afina/allocator/Pointer.h>
+#include <afina/allocator/Simple.h>
+
+using namespace Afina::Allocator;
+
+// Region is writable over its whole size and works as the allocator arena
+static void CheckRegion(MappedRegion &region, size_t size) {
+    ASSERT_NE(nullptr, region.data());
+    ASSERT_GE(region.size(), size);
+
+    char *data = static_cast<char *>(region.data());
+    memset(data, 0x5a, region.size());
+    EXPECT_EQ(0x5a, data[0]);
+    EXPECT_EQ(0x5a, data[region.size() - 1]);
+
+    Simple a(region.data(), size);
+    Pointer p = a.alloc(1024);
+    ASSERT_NE(nullptr, p.get());
+    EXPECT_GE(static_cast<char *>(p.get()), data);
+    EXPECT_LT(static_cast<char *>(p.get()), data + size);
+    a.free(p);
+}
+
+TEST(MappedRegionTest, RegularPages) {
+    MappedRegion region(1000000);
+    EXPECT_EQ(0u, region.size() % 4096);
+    CheckRegion(region, 1000000);
+}
+
+TEST(MappedRegionTest, Populate) {
+    MappedRegion region(8 * 1024 * 1024, HugePages::None, true);
+    CheckRegion(region, 8 * 1024 * 1024);
+}
+
+TEST(MappedRegionTest, TransparentHugePages) {
+    MappedRegion region(5 * 1024 * 1024, HugePages::Transparent, true);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(region.data()) % MappedRegion::HugePageSize);
+    EXPECT_EQ(0u, region.size() % MappedRegion::HugePageSize);
+    CheckRegion(region, 5 * 1024 * 1024);
+}
+
+TEST(MappedRegionTest, ExplicitHugePages) {
+    // Pool of huge pages is usually empty on test machines, then mapping must fail loudly
+    try {
+        MappedRegion region(MappedRegion::HugePageSize, HugePages::Explicit, true);
+        EXPECT_EQ(0u, region.size() % MappedRegion::HugePageSize);
+        CheckRegion(region, MappedRegion::HugePageSize);
+    } catch (std::runtime_error &) {
+    }
+}
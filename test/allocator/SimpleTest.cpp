@@ -1,6 +1,12 @@
 #include "gtest/gtest.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <map>
 #include <set>
+#include <sstream>
+#include <string>
 #include <vector>
 
 #include <afina/allocator/Error.h>
@@ -322,3 +328,292 @@ TEST(SimpleTest, ReallocGrow) {
     a.free(p);
     a.free(p2);
 }
+
+TEST(SimpleTest, RandomizedConsistency) {
+    Simple a(buf, sizeof(buf));
+
+    // Every live block is filled with its own byte, so overlapping blocks get noticed
+    struct Live {
+        Pointer p;
+        size_t size;
+        char tag;
+    };
+    vector<Live> live;
+
+    unsigned seed = 1;
+    for (int i = 0; i < 20000; i++) {
+        seed = seed * 1103515245 + 12345;
+        unsigned op = (seed >> 16) % 4;
+        size_t size = 1 + (seed >> 4) % 2000;
+        char tag = char(i);
+
+        if (op == 3) {
+            // Blocks get moved by compaction, addresses are taken from pointers every time
+            a.defrag(size);
+        } else if (op == 0 || live.empty()) {
+            try {
+                Pointer p = a.alloc(size);
+                EXPECT_TRUE(isValidMemory(p, size));
+                memset(p.get(), tag, size);
+                live.push_back({p, size, tag});
+            } catch (AllocError &e) {
+                EXPECT_EQ(e.getType(), AllocErrorType::NoMemory);
+            }
+        } else {
+            Live &victim = live[(seed >> 8) % live.size()];
+            char *v = reinterpret_cast<char *>(victim.p.get());
+            for (size_t j = 0; j < victim.size; j++) {
+                ASSERT_EQ(victim.tag, v[j]);
+            }
+
+            if (op == 1) {
+                a.free(victim.p);
+                victim = live.back();
+                live.pop_back();
+            } else {
+                try {
+                    a.realloc(victim.p, size);
+                    victim.size = min(victim.size, size);
+                    v = reinterpret_cast<char *>(victim.p.get());
+                    for (size_t j = 0; j < victim.size; j++) {
+                        ASSERT_EQ(victim.tag, v[j]);
+                    }
+                    memset(v, tag, size);
+                    victim.size = size;
+                    victim.tag = tag;
+                } catch (AllocError &e) {
+                    EXPECT_EQ(e.getType(), AllocErrorType::NoMemory);
+                }
+            }
+        }
+    }
+
+    for (Live &l : live) {
+        a.free(l.p);
+    }
+
+    // Everything is merged back into a single block
+    Pointer all = a.alloc(sizeof(buf) / 2);
+    EXPECT_NE(all.get(), nullptr);
+    a.free(all);
+}
+
+TEST(SimpleTest, InvalidFree) {
+    Simple a(buf, sizeof(buf));
+
+    Pointer p = a.alloc(100);
+    Pointer copy = p;
+    a.free(p);
+
+    try {
+        a.free(copy);
+        EXPECT_TRUE(false);
+    } catch (AllocError &e) {
+        EXPECT_EQ(e.getType(), AllocErrorType::InvalidFree);
+    }
+}
+
+// Cache-like size mix: mostly small items with a long tail up to 1MB
+static size_t ItemSize(unsigned &seed) {
+    seed = seed * 1103515245 + 12345;
+    unsigned r = (seed >> 8) % 1000;
+    seed = seed * 1103515245 + 12345;
+    unsigned x = seed >> 8;
+    if (r < 900) {
+        return 32 + x % 1000;
+    } else if (r < 990) {
+        return 1024 + x % (64 * 1024);
+    }
+    return 64 * 1024 + x % (960 * 1024);
+}
+
+template <typename Alloc, typename Free> static double Churn(Alloc &&alloc_fn, Free &&free_fn, long ops) {
+    const size_t slots = 2048;
+    vector<void *> live(slots, nullptr);
+    unsigned seed = 42;
+
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < ops; i++) {
+        size_t slot = (seed >> 4) % slots;
+        if (live[slot] != nullptr) {
+            free_fn(slot, live[slot]);
+        }
+        size_t size = ItemSize(seed);
+        live[slot] = alloc_fn(slot, size);
+        static_cast<char *>(live[slot])[0] = 1;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    for (size_t slot = 0; slot < slots; slot++) {
+        if (live[slot] != nullptr) {
+            free_fn(slot, live[slot]);
+        }
+    }
+    return ops / elapsed.count();
+}
+
+TEST(SimpleTest, ThroughputVsMalloc) {
+    const long ops = 500000;
+    vector<char> arena(256 * 1024 * 1024);
+    Simple a(arena.data(), arena.size());
+
+    vector<Pointer> handles(2048);
+    double simple = Churn(
+        [&](size_t slot, size_t size) {
+            handles[slot] = a.alloc(size);
+            return handles[slot].get();
+        },
+        [&](size_t slot, void *) { a.free(handles[slot]); }, ops);
+
+    double system = Churn([](size_t, size_t size) { return malloc(size); }, [](size_t, void *p) { ::free(p); }, ops);
+
+    std::cout << "allocator\tops/s" << std::endl;
+    std::cout << "Simple\t\t" << long(simple) << std::endl;
+    std::cout << "malloc\t\t" << long(system) << std::endl;
+    EXPECT_GT(simple, 0);
+    EXPECT_GT(system, 0);
+}
+
+TEST(SimpleTest, DefragIncremental) {
+    Simple a(buf, sizeof(buf));
+
+    struct Live {
+        Pointer p;
+        size_t size;
+        char tag;
+    };
+    vector<Live> live;
+
+    unsigned seed = 7;
+    for (int i = 0;; i++) {
+        seed = seed * 1103515245 + 12345;
+        size_t size = 16 + (seed >> 8) % 512;
+        try {
+            Pointer p = a.alloc(size);
+            memset(p.get(), char(i), size);
+            live.push_back({p, size, char(i)});
+        } catch (AllocError &) {
+            break;
+        }
+    }
+
+    // Every other block is freed, so that no hole is large enough for all of them together
+    size_t released = 0;
+    vector<Live> kept;
+    for (size_t i = 0; i < live.size(); i++) {
+        if (i % 2 == 0) {
+            released += live[i].size;
+            a.free(live[i].p);
+        } else {
+            kept.push_back(live[i]);
+        }
+    }
+
+    // Interleave small compaction steps with allocator usage
+    int steps = 0;
+    while (!a.defrag(256)) {
+        Pointer p = a.alloc(64);
+        memset(p.get(), 0, 64);
+        a.free(p);
+        steps++;
+    }
+    EXPECT_GT(steps, 1);
+
+    for (Live &l : kept) {
+        char *v = reinterpret_cast<char *>(l.p.get());
+        for (size_t j = 0; j < l.size; j++) {
+            ASSERT_EQ(l.tag, v[j]);
+        }
+    }
+
+    Pointer big = a.alloc(released);
+    memset(big.get(), 0, released);
+    a.free(big);
+
+    for (Live &l : kept) {
+        a.free(l.p);
+    }
+}
+
+TEST(SimpleTest, PinnedBlocks) {
+    Simple a(buf, sizeof(buf));
+
+    vector<Pointer> ptrs;
+    vector<char *> pinned;
+    for (int i = 0; i < 10; i++) {
+        ptrs.push_back(a.alloc(100));
+        writeTo(ptrs.back(), 100);
+        pinned.push_back(static_cast<char *>(a.alloc_pinned(100)));
+        memset(pinned.back(), i, 100);
+    }
+    for (size_t i = 0; i < ptrs.size(); i += 2) {
+        a.free(ptrs[i]);
+    }
+
+    // Compaction moves handle-based blocks only
+    vector<char *> before = pinned;
+    a.defrag();
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(before[i], pinned[i]);
+        for (int j = 0; j < 100; j++) {
+            ASSERT_EQ(char(i), pinned[i][j]);
+        }
+    }
+
+    // Kinds of blocks can't be mixed up
+    EXPECT_THROW(a.free_pinned(ptrs[1].get()), AllocError);
+    for (size_t i = 1; i < ptrs.size(); i += 2) {
+        EXPECT_TRUE(isDataOk(ptrs[i], 100));
+        a.free(ptrs[i]);
+    }
+    for (char *p : pinned) {
+        a.free_pinned(p);
+    }
+    EXPECT_THROW(a.free_pinned(pinned[0]), AllocError);
+}
+
+static map<string, string> parseDump(const string &dump) {
+    map<string, string> stats;
+    istringstream lines(dump);
+    string name, value;
+    while (lines >> name >> value) {
+        stats[name] = value;
+    }
+    return stats;
+}
+
+TEST(SimpleTest, Dump) {
+    Simple a(buf, sizeof(buf));
+
+    vector<Pointer> ptrs;
+    ASSERT_TRUE(fillUp(a, 200, ptrs));
+    for (size_t i = 0; i < ptrs.size(); i += 2) {
+        a.free(ptrs[i]);
+    }
+
+    map<string, string> stats = parseDump(a.dump());
+    size_t total = stoul(stats["bytes"]);
+    size_t used = stoul(stats["used_bytes"]);
+    size_t free = stoul(stats["free_bytes"]);
+    EXPECT_EQ(total, used + free + stoul(stats["pinned_bytes"]) + stoul(stats["handle_table_bytes"]));
+    EXPECT_GE(stoul(stats["free_blocks"]), (ptrs.size() + 1) / 2);
+    EXPECT_EQ(ptrs.size() / 2, stoul(stats["used_blocks"]));
+    EXPECT_GT(stod(stats["fragmentation"]), 0.9);
+    EXPECT_EQ("0", stats["defrag_moves"]);
+
+    // All blocks of 200 bytes with header fall into the same class
+    EXPECT_EQ(stats["used_blocks"], stats["class_224_used"]);
+
+    a.defrag();
+    stats = parseDump(a.dump());
+    EXPECT_EQ(used, stoul(stats["used_bytes"]));
+    EXPECT_EQ("1", stats["free_blocks"]);
+    EXPECT_EQ(stats["free_bytes"], stats["largest_free"]);
+    EXPECT_EQ(0.0, stod(stats["fragmentation"]));
+    EXPECT_GT(stoul(stats["defrag_moves"]), 0);
+    EXPECT_GT(stoul(stats["defrag_moved_bytes"]), 0);
+
+    for (size_t i = 1; i < ptrs.size(); i += 2) {
+        a.free(ptrs[i]);
+    }
+}
@@ -0,0 +1,141 @@
+#include "gtest/gtest.h"
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <afina/allocator/MemoryResource.h>
+#include <afina/allocator/Pointer.h>
+#include <afina/allocator/Simple.h>
+#include <afina/allocator/StlAllocator.h>
+
+using namespace std;
+using namespace Afina::Allocator;
+
+static char arena[1024 * 1024];
+
+TEST(StlAllocatorTest, Vector) {
+    Simple a(arena, sizeof(arena));
+
+    vector<int, StlAllocator<int>> v{StlAllocator<int>(a)};
+    for (int i = 0; i < 10000; i++) {
+        v.push_back(i);
+    }
+
+    EXPECT_GE(reinterpret_cast<char *>(v.data()), arena);
+    EXPECT_LE(reinterpret_cast<char *>(v.data() + v.size()), arena + sizeof(arena));
+    for (int i = 0; i < 10000; i++) {
+        ASSERT_EQ(i, v[i]);
+    }
+}
+
+TEST(StlAllocatorTest, NoMemory) {
+    Simple a(arena, sizeof(arena));
+
+    vector<char, StlAllocator<char>> v{StlAllocator<char>(a)};
+    EXPECT_THROW(v.resize(2 * sizeof(arena)), std::bad_alloc);
+}
+
+TEST(StlAllocatorTest, SurvivesDefrag) {
+    Simple a(arena, sizeof(arena));
+
+    typedef map<int, int, less<int>, StlAllocator<pair<const int, int>>> Map;
+    Map m{less<int>(), StlAllocator<pair<const int, int>>(a)};
+
+    // Movable blocks interleaved with map nodes get released, so compaction has work to do
+    vector<Pointer> movable;
+    for (int i = 0; i < 1000; i++) {
+        m[i] = i * 2;
+        movable.push_back(a.alloc(100));
+    }
+    for (size_t i = 0; i < movable.size(); i += 2) {
+        a.free(movable[i]);
+    }
+    a.defrag();
+
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_EQ(i * 2, m[i]);
+    }
+    for (size_t i = 1; i < movable.size(); i += 2) {
+        a.free(movable[i]);
+    }
+}
+
+TEST(StlAllocatorTest, Polymorphic) {
+    Simple a(arena, sizeof(arena));
+    SimpleResource resource(a);
+
+    typedef PolymorphicAllocator<pair<const string, int>> Alloc;
+    typedef unordered_map<string, int, hash<string>, equal_to<string>, Alloc> Map;
+
+    Map in_arena(16, hash<string>(), equal_to<string>(), Alloc(&resource));
+    Map on_heap;
+    for (int i = 0; i < 1000; i++) {
+        in_arena["key" + to_string(i)] = i;
+        on_heap["key" + to_string(i)] = i;
+    }
+
+    EXPECT_TRUE(in_arena.get_allocator() != on_heap.get_allocator());
+    EXPECT_TRUE(in_arena.get_allocator() == Alloc(&resource));
+    EXPECT_TRUE(on_heap.get_allocator() == Alloc(MemoryResource::NewDelete()));
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_EQ(i, in_arena["key" + to_string(i)]);
+        ASSERT_EQ(i, on_heap["key" + to_string(i)]);
+    }
+}
+
+// Runs insert/lookup/erase mix over unordered_map, returns operations per second
+template <typename Map> static double MapThroughput(Map &m, long ops) {
+    const long keys = 50000;
+    unsigned seed = 42;
+    long found = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < ops; i++) {
+        seed = seed * 1103515245 + 12345;
+        long key = (seed >> 8) % keys;
+        switch ((seed >> 4) % 4) {
+        case 0:
+            m[key] = i;
+            break;
+        case 1:
+            m.erase(key);
+            break;
+        default:
+            found += m.count(key);
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_GE(found, 0);
+    return ops / elapsed.count();
+}
+
+TEST(StlAllocatorTest, UnorderedMapThroughput) {
+    const long ops = 1000000;
+    vector<char> memory(64 * 1024 * 1024);
+    Simple a(memory.data(), memory.size());
+    SimpleResource resource(a);
+
+    typedef pair<const long, long> Value;
+    unordered_map<long, long> standard;
+    unordered_map<long, long, hash<long>, equal_to<long>, StlAllocator<Value>> arena_map(
+        16, hash<long>(), equal_to<long>(), StlAllocator<Value>(a));
+    unordered_map<long, long, hash<long>, equal_to<long>, PolymorphicAllocator<Value>> resource_map(
+        16, hash<long>(), equal_to<long>(), PolymorphicAllocator<Value>(&resource));
+
+    double s = MapThroughput(standard, ops);
+    double t = MapThroughput(arena_map, ops);
+    double r = MapThroughput(resource_map, ops);
+
+    std::cout << "allocator\t\tops/s" << std::endl;
+    std::cout << "std::allocator\t\t" << long(s) << std::endl;
+    std::cout << "StlAllocator\t\t" << long(t) << std::endl;
+    std::cout << "PolymorphicAllocator\t" << long(r) << std::endl;
+    EXPECT_GT(s, 0);
+    EXPECT_GT(t, 0);
+    EXPECT_GT(r, 0);
+}
@@ -0,0 +1,62 @@
+#include "gtest/gtest.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <afina/Executor.h>
+
+using namespace Afina;
+
+TEST(ExecutorTest, ExecutesTasks) {
+    std::atomic<int> sum(0);
+    {
+        Executor executor("test", 4);
+        for (int i = 1; i <= 1000; i++) {
+            ASSERT_TRUE(executor.Execute([&sum](int v) { sum += v; }, i));
+        }
+        executor.Stop(true);
+    }
+    EXPECT_EQ(500500, sum.load());
+}
+
+TEST(ExecutorTest, FifoOnSingleThread) {
+    std::vector<int> order;
+    Executor executor("test", 1);
+    for (int i = 0; i < 100; i++) {
+        executor.Execute([&order, i]() { order.push_back(i); });
+    }
+    executor.Stop(true);
+
+    ASSERT_EQ(100u, order.size());
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(i, order[i]);
+    }
+}
+
+TEST(ExecutorTest, StopCompletesQueuedTasks) {
+    std::atomic<int> done(0);
+    Executor executor("test", 2);
+    for (int i = 0; i < 10; i++) {
+        executor.Execute([&done]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            done++;
+        });
+    }
+
+    executor.Stop(true);
+    EXPECT_EQ(10, done.load());
+    EXPECT_FALSE(executor.Execute([&done]() { done++; }));
+    EXPECT_EQ(10, done.load());
+}
+
+TEST(ExecutorTest, TaskExceptionDoesntKillThread) {
+    std::atomic<int> done(0);
+    Executor executor("test", 1);
+    executor.Execute([]() { throw std::runtime_error("task fails"); });
+    executor.Execute([&done]() { done++; });
+    executor.Stop(true);
+    EXPECT_EQ(1, done.load());
+}
@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <network/blocking/ServerImpl.h>
+#include <storage/MapBasedGlobalLockImpl.h>
+
+#include "Client.h"
+#include "ThrowingStorage.h"
+
+using namespace Afina::Network::Blocking;
+
+static const uint32_t Port = 18474;
+
+class BlockingTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        storage = std::make_shared<Afina::Backend::MapBasedGlobalLockImpl>();
+        server.reset(new ServerImpl(storage));
+        server->Start(Port, 2);
+    }
+
+    void TearDown() override {
+        server->Stop();
+        server->Join();
+    }
+
+    std::shared_ptr<Afina::Storage> storage;
+    std::unique_ptr<ServerImpl> server;
+};
+
+TEST_F(BlockingTest, Pipelining) {
+    int s = Connect(Port);
+    Send(s, "set a 0 0 3\r\nabc\r\nset b 0 0 0\r\n\r\nget a b c\r\n");
+
+    std::string expected = "STORED\r\nSTORED\r\nVALUE a 0 3\r\nabc\r\nVALUE b 0 0\r\n\r\nEND\r\n";
+    EXPECT_EQ(expected, Recv(s, expected.size()));
+    close(s);
+}
+
+TEST_F(BlockingTest, ClientError) {
+    int s = Connect(Port);
+    Send(s, "bogus key\r\nget key\r\n");
+
+    std::string response = Recv(s, 4096);
+    EXPECT_EQ(0u, response.find("CLIENT_ERROR"));
+    EXPECT_EQ(response.size() - 2, response.find("\r\n"));
+    close(s);
+}
+
+TEST_F(BlockingTest, PoolSaturation) {
+    // Both pool threads are taken by idle clients
+    int first = Connect(Port);
+    int second = Connect(Port);
+    Send(first, "set key 0 0 1\r\nx\r\n");
+    EXPECT_EQ("STORED\r\n", Recv(first, 8));
+    Send(second, "get key\r\n");
+    EXPECT_EQ("VALUE key 0 1\r\nx\r\nEND\r\n", Recv(second, 23));
+
+    // Third one waits in the queue until some thread becomes free
+    int third = Connect(Port);
+    Send(third, "get key\r\n");
+
+    struct timeval timeout = {0, 200 * 1000};
+    setsockopt(third, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    char c;
+    EXPECT_EQ(-1, recv(third, &c, 1, 0));
+
+    close(first);
+    timeout.tv_usec = 0;
+    timeout.tv_sec = 5;
+    setsockopt(third, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    EXPECT_EQ("VALUE key 0 1\r\nx\r\nEND\r\n", Recv(third, 23));
+
+    close(second);
+    close(third);
+}
+
+TEST_F(BlockingTest, StopClosesIdleConnections) {
+    int s = Connect(Port);
+    Send(s, "set key 0 0 1\r\nx\r\n");
+    EXPECT_EQ("STORED\r\n", Recv(s, 8));
+
+    // Worker is blocked reading next command, stop must not wait for the client
+    server->Stop();
+    server->Join();
+
+    EXPECT_EQ("", Recv(s, 1));
+    close(s);
+
+    // Restart, so that TearDown has something to stop
+    server->Start(Port, 2);
+}
+
+TEST(BlockingServerTest, CommandThrows) {
+    ServerImpl server(std::make_shared<ThrowingStorage>());
+    server.Start(Port + 4, 1);
+
+    // Failed command gets a reply of its own, the only pool thread keeps serving
+    int s = Connect(Port + 4);
+    Send(s, "get boom\r\nset a 0 0 1\r\nx\r\n");
+    std::string expected = "SERVER_ERROR unknown error\r\nSTORED\r\n";
+    EXPECT_EQ(expected, Recv(s, expected.size()));
+    close(s);
+
+    s = Connect(Port + 4);
+    Send(s, "get a\r\n");
+    expected = "VALUE a 0 1\r\nx\r\nEND\r\n";
+    EXPECT_EQ(expected, Recv(s, expected.size()));
+    close(s);
+
+    server.Stop();
+    server.Join();
+}
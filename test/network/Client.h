@@ -0,0 +1,61 @@
+#ifndef AFINA_TEST_NETWORK_CLIENT_H
+#define AFINA_TEST_NETWORK_CLIENT_H
+
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// Opens blocking client connection to the local server, retries a bit as server might not listen yet
+inline int Connect(uint32_t port) {
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    for (int i = 0; i < 100; i++) {
+        int s = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
+        EXPECT_NE(-1, s);
+        if (connect(s, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+            return s;
+        }
+        close(s);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ADD_FAILURE() << "Failed to connect";
+    return -1;
+}
+
+inline void Send(int s, const std::string &data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(s, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        ASSERT_GT(n, 0);
+        sent += n;
+    }
+}
+
+// Reads exactly size bytes or until connection is closed
+inline std::string Recv(int s, size_t size) {
+    std::string result;
+    char buf[4096];
+    while (result.size() < size) {
+        ssize_t n = recv(s, buf, std::min(sizeof(buf), size - result.size()), 0);
+        if (n <= 0) {
+            break;
+        }
+        result.append(buf, n);
+    }
+    return result;
+}
+
+#endif // AFINA_TEST_NETWORK_CLIENT_H
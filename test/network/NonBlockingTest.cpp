@@ -0,0 +1,190 @@
+#include "gtest/gtest.h"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <network/nonblocking/ServerImpl.h>
+#include <storage/MapBasedGlobalLockImpl.h>
+
+#include "Client.h"
+#include "ThrowingStorage.h"
+
+using namespace Afina::Network::NonBlocking;
+
+static const uint32_t Port = 18473;
+
+class NonBlockingTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        storage = std::make_shared<Afina::Backend::MapBasedGlobalLockImpl>();
+        server.reset(new ServerImpl(storage));
+        server->Start(Port, 2);
+    }
+
+    void TearDown() override {
+        server->Stop();
+        server->Join();
+    }
+
+    std::shared_ptr<Afina::Storage> storage;
+    std::unique_ptr<ServerImpl> server;
+};
+
+TEST_F(NonBlockingTest, Pipelining) {
+    int s = Connect(Port);
+    Send(s, "set a 0 0 3\r\nabc\r\nset b 0 0 0\r\n\r\nget a b c\r\n");
+
+    std::string expected = "STORED\r\nSTORED\r\nVALUE a 0 3\r\nabc\r\nVALUE b 0 0\r\n\r\nEND\r\n";
+    EXPECT_EQ(expected, Recv(s, expected.size()));
+    close(s);
+}
+
+TEST_F(NonBlockingTest, FragmentedInput) {
+    int s = Connect(Port);
+    std::string request = "set key 0 0 5\r\nvalue\r\nget key\r\n";
+    for (char c : request) {
+        Send(s, std::string(1, c));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::string expected = "STORED\r\nVALUE key 0 5\r\nvalue\r\nEND\r\n";
+    EXPECT_EQ(expected, Recv(s, expected.size()));
+    close(s);
+}
+
+TEST_F(NonBlockingTest, ClientError) {
+    int s = Connect(Port);
+    Send(s, "bogus key\r\nget key\r\n");
+
+    // Stream can't be parsed after bad command, so connection gets closed after error
+    std::string response = Recv(s, 4096);
+    EXPECT_EQ(0u, response.find("CLIENT_ERROR"));
+    EXPECT_EQ(response.size() - 2, response.find("\r\n"));
+    close(s);
+}
+
+TEST_F(NonBlockingTest, ManyClients) {
+    const int clients = 8;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < clients; i++) {
+        threads.emplace_back([i]() {
+            int s = Connect(Port);
+            std::string key = "key" + std::to_string(i);
+            for (int j = 0; j < 100; j++) {
+                std::string value = std::to_string(j);
+                Send(s, "set " + key + " 0 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\nget " + key +
+                            "\r\n");
+
+                std::string expected = "STORED\r\nVALUE " + key + " 0 " + std::to_string(value.size()) + "\r\n" +
+                                       value + "\r\nEND\r\n";
+                ASSERT_EQ(expected, Recv(s, expected.size()));
+            }
+            close(s);
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+}
+
+TEST_F(NonBlockingTest, DrainOnStop) {
+    int s = Connect(Port);
+    std::string value(64 * 1024, 'x');
+    Send(s, "set big 0 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\n");
+    ASSERT_EQ("STORED\r\n", Recv(s, 8));
+
+    // Responses don't fit into socket buffers, so most of them are still queued on server when it
+    // stops. All of them must be delivered before connection is closed
+    const int requests = 64;
+    std::string batch;
+    for (int i = 0; i < requests; i++) {
+        batch += "get big\r\n";
+    }
+    Send(s, batch);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    server->Stop();
+    std::thread join([this]() { server->Join(); });
+
+    std::string item = "VALUE big 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\nEND\r\n";
+    std::string response = Recv(s, requests * item.size() + 1);
+    EXPECT_EQ(requests * item.size(), response.size());
+    EXPECT_EQ(item, response.substr(response.size() - item.size()));
+
+    join.join();
+    close(s);
+}
+
+TEST_F(NonBlockingTest, StuckClientOnStop) {
+    int s = Connect(Port);
+    std::string value(64 * 1024, 'x');
+    Send(s, "set big 0 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\n");
+    ASSERT_EQ("STORED\r\n", Recv(s, 8));
+
+    // Client never reads responses, worker gives up on them after a while rather than waiting forever
+    std::string batch;
+    for (int i = 0; i < 64; i++) {
+        batch += "get big\r\n";
+    }
+    Send(s, batch);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    auto start = std::chrono::steady_clock::now();
+    server->Stop();
+    server->Join();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(10));
+    close(s);
+}
+
+TEST(NonBlockingServerTest, CommandThrows) {
+    ServerImpl server(std::make_shared<ThrowingStorage>());
+    server.Start(Port + 4, 1);
+
+    // Failed command gets a reply of its own, worker keeps serving the connection
+    int s = Connect(Port + 4);
+    Send(s, "get boom\r\nset a 0 0 1\r\nx\r\n");
+    std::string expected = "SERVER_ERROR unknown error\r\nSTORED\r\n";
+    EXPECT_EQ(expected, Recv(s, expected.size()));
+    close(s);
+
+    server.Stop();
+    server.Join();
+}
+
+TEST(NonBlockingReusePortTest, ManyClients) {
+    std::shared_ptr<Afina::Storage> storage = std::make_shared<Afina::Backend::MapBasedGlobalLockImpl>();
+    ServerImpl server(storage, true, true);
+    server.Start(Port, 4);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 16; i++) {
+        threads.emplace_back([i]() {
+            int s = Connect(Port);
+            std::string key = "key" + std::to_string(i);
+            Send(s, "set " + key + " 0 0 1\r\nx\r\nget " + key + "\r\n");
+
+            std::string expected = "STORED\r\nVALUE " + key + " 0 1\r\nx\r\nEND\r\n";
+            EXPECT_EQ(expected, Recv(s, expected.size()));
+            close(s);
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    server.Stop();
+    server.Join();
+
+    // Port is released once server is joined, so it could be started again
+    server.Start(Port, 2);
+    int s = Connect(Port);
+    Send(s, "get key0\r\n");
+
+    std::string expected = "VALUE key0 0 1\r\nx\r\nEND\r\n";
+    EXPECT_EQ(expected, Recv(s, expected.size()));
+    close(s);
+    server.Stop();
+    server.Join();
+}
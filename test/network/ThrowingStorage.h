@@ -0,0 +1,19 @@
+#ifndef AFINA_TEST_NETWORK_THROWING_STORAGE_H
+#define AFINA_TEST_NETWORK_THROWING_STORAGE_H
+
+#include <string>
+
+#include <storage/MapBasedGlobalLockImpl.h>
+
+// Storage failing lookups of the "boom" key with something that isn't an exception at all
+class ThrowingStorage : public Afina::Backend::MapBasedGlobalLockImpl {
+public:
+    bool GetPinned(const std::string &key, Afina::PinnedValue &value) const override {
+        if (key == "boom") {
+            throw 42;
+        }
+        return MapBasedGlobalLockImpl::GetPinned(key, value);
+    }
+};
+
+#endif // AFINA_TEST_NETWORK_THROWING_STORAGE_H
@@ -0,0 +1,162 @@
+#include "gtest/gtest.h"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <network/uv/ServerImpl.h>
+#include <storage/MapBasedGlobalLockImpl.h>
+
+#include "Client.h"
+#include "ThrowingStorage.h"
+
+using namespace Afina::Network::UV;
+
+static const uint32_t Port = 18475;
+
+class UVTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        storage = std::make_shared<Afina::Backend::MapBasedGlobalLockImpl>();
+        server.reset(new ServerImpl(storage, 4));
+        server->Start(Port, 2);
+    }
+
+    void TearDown() override {
+        server->Stop();
+        server->Join();
+    }
+
+    std::shared_ptr<Afina::Storage> storage;
+    std::unique_ptr<ServerImpl> server;
+};
+
+TEST_F(UVTest, Pipelining) {
+    int s = Connect(Port);
+    Send(s, "set a 0 0 3\r\nabc\r\nset b 0 0 0\r\n\r\nget a b c\r\n");
+
+    std::string expected = "STORED\r\nSTORED\r\nVALUE a 0 3\r\nabc\r\nVALUE b 0 0\r\n\r\nEND\r\n";
+    EXPECT_EQ(expected, Recv(s, expected.size()));
+    close(s);
+}
+
+TEST_F(UVTest, PipelinedOrder) {
+    // Commands run on the pool, still each one must see previous and responses come in order
+    int s = Connect(Port);
+    std::string request, expected;
+    for (int i = 0; i < 200; i++) {
+        std::string value = std::to_string(i);
+        request += "set key 0 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\nget key\r\n";
+        expected += "STORED\r\nVALUE key 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\nEND\r\n";
+    }
+    Send(s, request);
+
+    EXPECT_EQ(expected, Recv(s, expected.size()));
+    close(s);
+}
+
+TEST_F(UVTest, FragmentedInput) {
+    int s = Connect(Port);
+    std::string request = "set key 0 0 5\r\nvalue\r\nget key\r\n";
+    for (char c : request) {
+        Send(s, std::string(1, c));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::string expected = "STORED\r\nVALUE key 0 5\r\nvalue\r\nEND\r\n";
+    EXPECT_EQ(expected, Recv(s, expected.size()));
+    close(s);
+}
+
+TEST_F(UVTest, LargeValue) {
+    // Value spans many reads, input buffers grow on the way and go back to the pool between reads
+    int s = Connect(Port);
+    std::string value(1024 * 1024, 'x');
+    for (size_t i = 0; i < value.size(); i += 4093) {
+        value[i] = 'a' + i % 26;
+    }
+    Send(s, "set big 0 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\nget big\r\n");
+
+    std::string expected = "STORED\r\nVALUE big 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\nEND\r\n";
+    EXPECT_EQ(expected, Recv(s, expected.size()));
+    close(s);
+}
+
+TEST_F(UVTest, OverwriteWhileWriting) {
+    // Value is written out of storage memory, overwriting it meanwhile must not change response already made
+    int s = Connect(Port);
+    std::string a(256 * 1024, 'a'), b(256 * 1024, 'b');
+    std::string request = "set key 0 0 " + std::to_string(a.size()) + "\r\n" + a + "\r\n";
+    std::string expected = "STORED\r\n";
+    for (int i = 0; i < 8; i++) {
+        std::string &value = (i % 2 == 0) ? a : b;
+        std::string &next = (i % 2 == 0) ? b : a;
+        request += "get key\r\nset key 0 0 " + std::to_string(next.size()) + "\r\n" + next + "\r\n";
+        expected += "VALUE key 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\nEND\r\nSTORED\r\n";
+    }
+    Send(s, request);
+
+    EXPECT_EQ(expected, Recv(s, expected.size()));
+    close(s);
+}
+
+TEST_F(UVTest, ClientError) {
+    int s = Connect(Port);
+    Send(s, "set key 0 0 1\r\nx\r\nbogus key\r\nget key\r\n");
+
+    // Error follows responses to the previous commands and connection gets closed after it
+    std::string response = Recv(s, 4096);
+    EXPECT_EQ(0u, response.find("STORED\r\nCLIENT_ERROR"));
+    EXPECT_EQ(response.size() - 2, response.find("\r\n", 8));
+    close(s);
+}
+
+TEST_F(UVTest, TooLargeValue) {
+    // Data block size comes from the client, it is refused before anything gets allocated for it
+    int s = Connect(Port);
+    Send(s, "set big 0 0 4000000000\r\n");
+
+    std::string response = Recv(s, 4096);
+    EXPECT_EQ(0u, response.find("CLIENT_ERROR"));
+    close(s);
+}
+
+TEST(UVServerTest, CommandThrows) {
+    ServerImpl server(std::make_shared<ThrowingStorage>(), 2);
+    server.Start(Port + 1, 1);
+
+    // Failed command gets a reply of its own and doesn't hold up the following ones
+    int s = Connect(Port + 1);
+    Send(s, "get boom\r\nset a 0 0 1\r\nx\r\n");
+    std::string expected = "SERVER_ERROR unknown error\r\nSTORED\r\n";
+    EXPECT_EQ(expected, Recv(s, expected.size()));
+    close(s);
+
+    server.Stop();
+    server.Join();
+}
+
+TEST_F(UVTest, DrainOnStop) {
+    int s = Connect(Port);
+    std::string value(64 * 1024, 'x');
+    Send(s, "set big 0 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\n");
+    ASSERT_EQ("STORED\r\n", Recv(s, 8));
+
+    const int requests = 64;
+    std::string batch;
+    for (int i = 0; i < requests; i++) {
+        batch += "get big\r\n";
+    }
+    Send(s, batch);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    server->Stop();
+    std::thread join([this]() { server->Join(); });
+
+    std::string item = "VALUE big 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\nEND\r\n";
+    std::string response = Recv(s, requests * item.size() + 1);
+    EXPECT_EQ(requests * item.size(), response.size());
+
+    join.join();
+    close(s);
+}
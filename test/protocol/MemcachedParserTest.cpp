@@ -1,14 +1,20 @@
 #include <gtest/gtest.h>
 
+#include <cstring>
 #include <memory>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 #include <afina/execute/Add.h>
+#include <afina/execute/Cas.h>
+#include <afina/execute/CommandSlot.h>
 #include <afina/execute/Get.h>
 #include <afina/execute/Set.h>
 #include <afina/execute/Stats.h>
 
 #include <protocol/Parser.h>
+#include <storage/MapBasedGlobalLockImpl.h>
 
 using namespace Afina;
 
@@ -27,8 +33,10 @@ TEST(MemcachedParserTest, SimpleSet) {
     ASSERT_EQ("set", parser.Name());
 
     uint32_t value_size;
-    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
-    ASSERT_FALSE(cmd == nullptr);
+    std::string key_bytes;
+    std::vector<uint32_t> key_ends;
+    Execute::CommandSlot cmd;
+    ASSERT_TRUE(parser.Build(value_size, cmd, key_bytes, key_ends));
     ASSERT_EQ(6, value_size);
 
     Execute::Set *tmp = reinterpret_cast<Execute::Set *>(cmd.get());
@@ -48,8 +56,10 @@ TEST(MemcachedParserTest, SimpleAdd) {
     ASSERT_EQ("add", parser.Name());
 
     uint32_t value_size;
-    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
-    ASSERT_FALSE(cmd == nullptr);
+    std::string key_bytes;
+    std::vector<uint32_t> key_ends;
+    Execute::CommandSlot cmd;
+    ASSERT_TRUE(parser.Build(value_size, cmd, key_bytes, key_ends));
     ASSERT_EQ(60, value_size);
 
     Execute::Add *tmp = reinterpret_cast<Execute::Add *>(cmd.get());
@@ -69,8 +79,10 @@ TEST(MemcachedParserTest, SimpleGet) {
     ASSERT_EQ("get", parser.Name());
 
     uint32_t value_size;
-    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
-    ASSERT_FALSE(cmd == nullptr);
+    std::string key_bytes;
+    std::vector<uint32_t> key_ends;
+    Execute::CommandSlot cmd;
+    ASSERT_TRUE(parser.Build(value_size, cmd, key_bytes, key_ends));
     ASSERT_EQ(0, value_size);
 
     Execute::Get *tmp = reinterpret_cast<Execute::Get *>(cmd.get());
@@ -81,6 +93,50 @@ TEST(MemcachedParserTest, SimpleGet) {
     ASSERT_EQ("super_long_key", keys[2]);
 }
 
+// Verify cas command carries cas unique field
+TEST(MemcachedParserTest, SimpleCas) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    bool cmd_avail = parser.Parse("cas foo 1 100 6 18446744073709551615\r\nfooval\r\n", consumed);
+    ASSERT_TRUE(cmd_avail);
+    ASSERT_EQ(38, consumed);
+    ASSERT_EQ("cas", parser.Name());
+
+    uint32_t value_size;
+    std::string key_bytes;
+    std::vector<uint32_t> key_ends;
+    Execute::CommandSlot cmd;
+    ASSERT_TRUE(parser.Build(value_size, cmd, key_bytes, key_ends));
+    ASSERT_EQ(6, value_size);
+
+    Execute::Cas *tmp = reinterpret_cast<Execute::Cas *>(cmd.get());
+    ASSERT_EQ("foo", tmp->key());
+    ASSERT_EQ(1, tmp->flags());
+    ASSERT_EQ(100, tmp->expire());
+    ASSERT_EQ(18446744073709551615ull, tmp->version());
+}
+
+// Verify gets command asks for versions
+TEST(MemcachedParserTest, SimpleGets) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    bool cmd_avail = parser.Parse("gets foo bar\r\n", consumed);
+    ASSERT_TRUE(cmd_avail);
+    ASSERT_EQ(14, consumed);
+
+    uint32_t value_size;
+    std::string key_bytes;
+    std::vector<uint32_t> key_ends;
+    Execute::CommandSlot cmd;
+    ASSERT_TRUE(parser.Build(value_size, cmd, key_bytes, key_ends));
+
+    Execute::Get *tmp = reinterpret_cast<Execute::Get *>(cmd.get());
+    ASSERT_EQ(2, tmp->keys().size());
+    ASSERT_TRUE(tmp->versions());
+}
+
 TEST(MemcachedParserTest, Stats) {
     Protocol::Parser parser;
 
@@ -91,10 +147,176 @@ TEST(MemcachedParserTest, Stats) {
     ASSERT_EQ("stats", parser.Name());
 
     uint32_t value_size;
-    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
-    ASSERT_FALSE(cmd == nullptr);
+    std::string key_bytes;
+    std::vector<uint32_t> key_ends;
+    Execute::CommandSlot cmd;
+    ASSERT_TRUE(parser.Build(value_size, cmd, key_bytes, key_ends));
     ASSERT_EQ(0, value_size);
 
     Execute::Stats *tmp = reinterpret_cast<Execute::Stats *>(cmd.get());
 	ASSERT_FALSE(tmp == nullptr);
 }
+
+// Verify bulk token slicing gives the same keys as char by char parsing however input is split
+TEST(MemcachedParserTest, VectorizedSplitInput) {
+    std::string long_key(100, 'k');
+    std::string input = "get a " + long_key + " 0123456789abcdef0123456789abcdef_ x\r\n";
+
+    for (size_t split = 0; split < input.size(); split++) {
+        for (bool vectorized : {false, true}) {
+            Protocol::Parser parser(vectorized);
+
+            size_t consumed = 0, total = 0;
+            ASSERT_FALSE(parser.Parse(input.data(), split, consumed));
+            total += consumed;
+            ASSERT_TRUE(parser.Parse(input.data() + total, input.size() - total, consumed));
+            total += consumed;
+            ASSERT_EQ(input.size(), total);
+
+            uint32_t value_size;
+            std::string key_bytes;
+            std::vector<uint32_t> key_ends;
+            Execute::CommandSlot cmd;
+            ASSERT_TRUE(parser.Build(value_size, cmd, key_bytes, key_ends));
+            Execute::Get *tmp = reinterpret_cast<Execute::Get *>(cmd.get());
+            ASSERT_EQ(4, tmp->keys().size());
+            ASSERT_EQ("a", tmp->keys()[0]);
+            ASSERT_EQ(long_key, tmp->keys()[1]);
+            ASSERT_EQ("0123456789abcdef0123456789abcdef_", tmp->keys()[2]);
+            ASSERT_EQ("x", tmp->keys()[3]);
+        }
+    }
+}
+
+// Verify names sharing length and first char with known commands are rejected
+TEST(MemcachedParserTest, UnknownCommand) {
+    for (const char *input : {"sex foo\r\n", "gett foo\r\n", "stat foo\r\n", "appenf foo\r\n", "prepene foo\r\n"}) {
+        Protocol::Parser parser;
+        size_t consumed = 0;
+        EXPECT_THROW(parser.Parse(input, strlen(input), consumed), std::runtime_error) << input;
+    }
+}
+
+// Verify slot could be reused by commands of different types
+TEST(MemcachedParserTest, SlotReuse) {
+    Protocol::Parser parser;
+    std::string key_bytes;
+    std::vector<uint32_t> key_ends;
+    Execute::CommandSlot cmd;
+    uint32_t value_size;
+    size_t consumed = 0;
+
+    ASSERT_TRUE(parser.Parse("get a b\r\n", consumed));
+    ASSERT_TRUE(parser.Build(value_size, cmd, key_bytes, key_ends));
+    ASSERT_FALSE(cmd.As<Execute::Get>() == nullptr);
+    ASSERT_TRUE(cmd.As<Execute::Set>() == nullptr);
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("set some_rather_long_key_name 0 0 1\r\n", consumed));
+    ASSERT_TRUE(parser.Build(value_size, cmd, key_bytes, key_ends));
+    ASSERT_TRUE(cmd.As<Execute::Get>() == nullptr);
+    ASSERT_EQ("some_rather_long_key_name", cmd.As<Execute::Set>()->key());
+
+    cmd.Reset();
+    ASSERT_FALSE(cmd);
+}
+
+TEST(MemcachedParserTest, HasBody) {
+    Protocol::Parser parser;
+    size_t consumed = 0;
+    const char *with_body[] = {"set k 0 0 1\r\n", "add k 0 0 0\r\n", "cas k 0 0 1 5\r\n", "append k 0 0 1\r\n"};
+    for (const char *input : with_body) {
+        parser.Reset();
+        ASSERT_TRUE(parser.Parse(input, consumed));
+        EXPECT_TRUE(parser.HasBody()) << input;
+    }
+
+    const char *without_body[] = {"get k\r\n", "gets a b\r\n", "stats\r\n"};
+    for (const char *input : without_body) {
+        parser.Reset();
+        ASSERT_TRUE(parser.Parse(input, consumed));
+        EXPECT_FALSE(parser.HasBody()) << input;
+    }
+}
+
+// Verify keys of large multiget are sliced out of the shared key bytes as they were sent
+TEST(MemcachedParserTest, MultigetKeys) {
+    std::string input = "gets";
+    for (int i = 0; i < 100; i++) {
+        input += " key" + std::to_string(i);
+    }
+    input += "\r\n";
+
+    Protocol::Parser parser;
+    size_t consumed = 0;
+    ASSERT_TRUE(parser.Parse(input, consumed));
+
+    uint32_t value_size;
+    std::string key_bytes;
+    std::vector<uint32_t> key_ends;
+    Execute::CommandSlot cmd;
+    ASSERT_TRUE(parser.Build(value_size, cmd, key_bytes, key_ends));
+
+    std::vector<std::string> keys = cmd.As<Execute::Get>()->keys();
+    ASSERT_EQ(100, keys.size());
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ("key" + std::to_string(i), keys[i]);
+    }
+}
+
+// Verify command built into given key buffers doesn't depend on the parser anymore
+TEST(MemcachedParserTest, BuildIntoKeyBuffers) {
+    Protocol::Parser parser;
+    size_t consumed = 0;
+    uint32_t value_size;
+
+    std::string keys1, keys2;
+    std::vector<uint32_t> ends1, ends2;
+    Execute::CommandSlot cmd1, cmd2;
+
+    ASSERT_TRUE(parser.Parse("get first_long_key_name b\r\n", consumed));
+    ASSERT_TRUE(parser.Build(value_size, cmd1, keys1, ends1));
+    parser.Reset();
+
+    ASSERT_TRUE(parser.Parse("gets c\r\n", consumed));
+    ASSERT_TRUE(parser.Build(value_size, cmd2, keys2, ends2));
+    parser.Reset();
+
+    std::vector<std::string> keys = cmd1.As<Execute::Get>()->keys();
+    ASSERT_EQ(2, keys.size());
+    ASSERT_EQ("first_long_key_name", keys[0]);
+    ASSERT_EQ("b", keys[1]);
+
+    keys = cmd2.As<Execute::Get>()->keys();
+    ASSERT_EQ(1, keys.size());
+    ASSERT_EQ("c", keys[0]);
+}
+
+// Verify get references values in the response and flattened response is the same as the plain one
+TEST(MemcachedParserTest, GetResponseValues) {
+    Backend::MapBasedGlobalLockImpl storage;
+    storage.Put("a", "value_a");
+    storage.Put("c", "value_c");
+
+    Protocol::Parser parser;
+    size_t consumed = 0;
+    ASSERT_TRUE(parser.Parse("get a b c\r\n", consumed));
+
+    uint32_t value_size;
+    std::string key_bytes;
+    std::vector<uint32_t> key_ends;
+    Execute::CommandSlot cmd;
+    ASSERT_TRUE(parser.Build(value_size, cmd, key_bytes, key_ends));
+
+    Execute::Response response;
+    cmd.Execute(storage, "", response);
+    ASSERT_EQ(2, response.values.size());
+    ASSERT_EQ("VALUE a 0 7\r\n\r\nVALUE c 0 7\r\n\r\nEND", response.text);
+    ASSERT_EQ("value_a", std::string(response.values[0].second.data(), response.values[0].second.size()));
+
+    std::string flat, plain;
+    response.Flatten(flat);
+    cmd.Execute(storage, "", plain);
+    ASSERT_EQ("VALUE a 0 7\r\nvalue_a\r\nVALUE c 0 7\r\nvalue_c\r\nEND", flat);
+    ASSERT_EQ(flat, plain);
+}
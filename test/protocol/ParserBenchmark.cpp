@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <protocol/Parser.h>
+
+using namespace Afina;
+
+// Parses given input over and over without building commands, returns bytes per second
+static double Throughput(bool vectorized, const std::string &input, size_t rounds) {
+    Protocol::Parser parser(vectorized);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; i++) {
+        size_t offset = 0;
+        while (offset < input.size()) {
+            size_t parsed = 0;
+            if (parser.Parse(input.data() + offset, input.size() - offset, parsed)) {
+                parser.Reset();
+            }
+            offset += parsed;
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return (input.size() * rounds) / elapsed.count();
+}
+
+TEST(ParserBenchmark, ScalarVsVectorized) {
+    std::string multiget = "get";
+    for (int i = 0; i < 100; i++) {
+        multiget += " user:session:" + std::to_string(1000000 + i);
+    }
+    multiget += "\r\n";
+
+    struct {
+        const char *name;
+        std::string input;
+    } cases[] = {
+        {"short get", "get foo\r\n"},
+        {"set header", "set user:profile:1234567890 0 0 1024\r\n"},
+        {"100-key get", multiget},
+    };
+
+    std::cout << "input\t\tscalar MB/s\tvectorized MB/s" << std::endl;
+    for (auto &c : cases) {
+        size_t rounds = (8 * 1024 * 1024) / c.input.size();
+        double scalar = Throughput(false, c.input, rounds);
+        double vectorized = Throughput(true, c.input, rounds);
+        std::cout << c.name << "\t" << long(scalar / 1e6) << "\t\t" << long(vectorized / 1e6) << std::endl;
+
+        EXPECT_GT(scalar, 0);
+        EXPECT_GT(vectorized, 0);
+    }
+}
@@ -0,0 +1,144 @@
+#include "gtest/gtest.h"
+#include <string>
+
+#include <storage/ArenaImpl.h>
+
+using namespace Afina::Backend;
+using namespace std;
+
+TEST(ArenaTest, PutGet) {
+    ArenaImpl storage;
+
+    EXPECT_TRUE(storage.Put("KEY1", "val1"));
+    EXPECT_TRUE(storage.Put("KEY2", "val2"));
+    EXPECT_FALSE(storage.PutIfAbsent("KEY1", "val3"));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val1", value);
+
+    // Grow value beyond its block, then shrink it back
+    EXPECT_TRUE(storage.Set("KEY1", std::string(1000, 'x')));
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ(std::string(1000, 'x'), value);
+
+    EXPECT_TRUE(storage.Put("KEY1", "v"));
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("v", value);
+
+    EXPECT_TRUE(storage.Append("KEY1", "w"));
+    EXPECT_TRUE(storage.Prepend("KEY1", "u"));
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("uvw", value);
+
+    EXPECT_TRUE(storage.Delete("KEY1"));
+    EXPECT_FALSE(storage.Get("KEY1", value));
+    EXPECT_FALSE(storage.Set("KEY1", "val"));
+
+    EXPECT_TRUE(storage.Get("KEY2", value));
+    EXPECT_EQ("val2", value);
+}
+
+TEST(ArenaTest, ManyKeys) {
+    ArenaImpl storage(64 * 1024 * 1024);
+
+    for (long i = 0; i < 100000; ++i) {
+        EXPECT_TRUE(storage.Put("Key" + to_string(i), "Val" + to_string(i)));
+    }
+
+    std::string value;
+    for (long i = 99999; i >= 0; --i) {
+        EXPECT_TRUE(storage.Get("Key" + to_string(i), value));
+        EXPECT_EQ("Val" + to_string(i), value);
+    }
+}
+
+TEST(ArenaTest, MemoryBudget) {
+    const size_t budget = 64 * 1024;
+    ArenaImpl storage(budget);
+
+    std::string big(1000, 'v');
+    for (long i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(storage.Put("Key" + to_string(i), big));
+        EXPECT_LE(storage.UsedMemory(), budget);
+    }
+
+    // Fewer than 64 values of 1000 bytes fit
+    std::string value;
+    EXPECT_TRUE(storage.Get("Key999", value));
+    EXPECT_FALSE(storage.Get("Key900", value));
+
+    // Value larger than whole arena is rejected
+    EXPECT_FALSE(storage.Put("huge", std::string(budget, 'x')));
+    EXPECT_FALSE(storage.Get("huge", value));
+}
+
+TEST(ArenaTest, DefragInsteadOfEviction) {
+    const size_t budget = 256 * 1024;
+    ArenaImpl storage(budget);
+
+    // Fill arena with small values, then delete every other one: half of the arena is free, but
+    // no hole is larger than a single small value
+    std::string small(200, 's');
+    long count = 0;
+    for (; storage.UsedMemory() + 2048 < budget - budget / 8; ++count) {
+        ASSERT_TRUE(storage.Put("Key" + to_string(count), small));
+    }
+    for (long i = 0; i < count; i += 2) {
+        EXPECT_TRUE(storage.Delete("Key" + to_string(i)));
+    }
+
+    // Large value fits only after compaction, nothing gets evicted
+    std::string large(budget / 4, 'l');
+    EXPECT_TRUE(storage.Put("large", large));
+
+    std::string value;
+    for (long i = 1; i < count; i += 2) {
+        ASSERT_TRUE(storage.Get("Key" + to_string(i), value));
+        EXPECT_EQ(small, value);
+    }
+    EXPECT_TRUE(storage.Get("large", value));
+    EXPECT_EQ(large, value);
+}
+
+TEST(ArenaTest, BackgroundDefrag) {
+    ArenaImpl storage(1024 * 1024);
+
+    for (long i = 0; i < 2000; ++i) {
+        EXPECT_TRUE(storage.Put("Key" + to_string(i), "Val" + to_string(i)));
+    }
+    for (long i = 0; i < 2000; i += 3) {
+        EXPECT_TRUE(storage.Delete("Key" + to_string(i)));
+    }
+
+    // Compaction steps move entries around, links between them must survive
+    for (int i = 0; i < 10; i++) {
+        storage.ReapExpired(time(nullptr));
+    }
+
+    std::string value;
+    for (long i = 0; i < 2000; ++i) {
+        if (i % 3 == 0) {
+            EXPECT_FALSE(storage.Get("Key" + to_string(i), value));
+        } else {
+            ASSERT_TRUE(storage.Get("Key" + to_string(i), value));
+            EXPECT_EQ("Val" + to_string(i), value);
+        }
+    }
+}
+
+TEST(ArenaTest, Stats) {
+    ArenaImpl storage(1024 * 1024);
+
+    for (long i = 0; i < 100; ++i) {
+        EXPECT_TRUE(storage.Put("Key" + to_string(i), "Val" + to_string(i)));
+    }
+
+    std::string stats;
+    storage.Stats(stats);
+    EXPECT_NE(std::string::npos, stats.find("curr_items 100\n"));
+    EXPECT_NE(std::string::npos, stats.find("limit_maxbytes 1048576\n"));
+    EXPECT_NE(std::string::npos, stats.find("arena_used_blocks 100\n"));
+    EXPECT_NE(std::string::npos, stats.find("arena_fragmentation "));
+    EXPECT_EQ('\n', stats.back());
+}
@@ -0,0 +1,178 @@
+#include "gtest/gtest.h"
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <afina/Storage.h>
+#include <storage/ArenaImpl.h>
+#include <storage/LRUCacheImpl.h>
+#include <storage/LockFreeHashImpl.h>
+#include <storage/MapBasedGlobalLockImpl.h>
+#include <storage/MapBasedRWLockImpl.h>
+#include <storage/StripedLockImpl.h>
+
+using namespace Afina;
+using namespace Afina::Backend;
+using namespace std;
+
+template <typename T> class AtomicUpdateTest : public ::testing::Test {
+protected:
+    T storage;
+};
+
+typedef ::testing::Types<MapBasedGlobalLockImpl, MapBasedRWLockImpl, StripedLockImpl, LRUCacheImpl, LockFreeHashImpl,
+                         ArenaImpl>
+    Backends;
+TYPED_TEST_CASE(AtomicUpdateTest, Backends);
+
+static std::string AsString(const PinnedValue &v) { return std::string(v.data(), v.size()); }
+
+TYPED_TEST(AtomicUpdateTest, AppendPrepend) {
+    Storage &storage = this->storage;
+
+    EXPECT_FALSE(storage.Append("KEY1", "tail"));
+    EXPECT_FALSE(storage.Prepend("KEY1", "head"));
+
+    storage.Put("KEY1", "body");
+    EXPECT_TRUE(storage.Append("KEY1", "-tail"));
+    EXPECT_TRUE(storage.Prepend("KEY1", "head-"));
+    EXPECT_TRUE(storage.Append("KEY1", ""));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("head-body-tail", value);
+}
+
+TYPED_TEST(AtomicUpdateTest, AppendKeepsExpiration) {
+    Storage &storage = this->storage;
+
+    storage.Put("KEY1", "val", time(nullptr) - 1);
+    EXPECT_FALSE(storage.Append("KEY1", "ue"));
+
+    storage.Put("KEY2", "val", time(nullptr) + 1000);
+    EXPECT_TRUE(storage.Append("KEY2", "ue"));
+    storage.Set("KEY2", "old", time(nullptr) - 1);
+    EXPECT_FALSE(storage.Prepend("KEY2", "x"));
+}
+
+TYPED_TEST(AtomicUpdateTest, AppendKeepsPinned) {
+    Storage &storage = this->storage;
+
+    storage.Put("KEY1", "val");
+    PinnedValue pinned;
+    EXPECT_TRUE(storage.GetPinned("KEY1", pinned));
+
+    for (int i = 0; i < 100; i++) {
+        storage.Append("KEY1", "x");
+        storage.Prepend("KEY1", "y");
+    }
+    EXPECT_EQ("val", AsString(pinned));
+
+    PinnedValue current;
+    EXPECT_TRUE(storage.GetPinned("KEY1", current));
+    EXPECT_EQ(std::string(100, 'y') + "val" + std::string(100, 'x'), AsString(current));
+}
+
+TYPED_TEST(AtomicUpdateTest, CompareAndSwap) {
+    Storage &storage = this->storage;
+
+    PinnedValue value;
+    uint64_t version = 0;
+    EXPECT_FALSE(storage.GetVersioned("KEY1", value, version));
+    EXPECT_EQ(CasResult::kNotFound, storage.CompareAndSwap("KEY1", "val", version));
+
+    storage.Put("KEY1", "val1");
+    EXPECT_TRUE(storage.GetVersioned("KEY1", value, version));
+    EXPECT_EQ("val1", AsString(value));
+
+    // Every modification changes version
+    uint64_t old = version;
+    EXPECT_TRUE(storage.Append("KEY1", "+"));
+    EXPECT_TRUE(storage.GetVersioned("KEY1", value, version));
+    EXPECT_NE(old, version);
+    EXPECT_EQ(CasResult::kExists, storage.CompareAndSwap("KEY1", "val2", old));
+
+    EXPECT_EQ(CasResult::kStored, storage.CompareAndSwap("KEY1", "val2", version));
+    EXPECT_EQ(CasResult::kExists, storage.CompareAndSwap("KEY1", "val3", version));
+
+    std::string current;
+    EXPECT_TRUE(storage.Get("KEY1", current));
+    EXPECT_EQ("val2", current);
+}
+
+TYPED_TEST(AtomicUpdateTest, ConcurrentAppends) {
+    Storage &storage = this->storage;
+    storage.Put("KEY1", "");
+
+    const int threads = 4;
+    const int appends = 500;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&storage]() {
+            for (int i = 0; i < appends; i++) {
+                storage.Append("KEY1", "x");
+                if (i % 50 == 0) {
+                    PinnedValue pinned;
+                    storage.GetPinned("KEY1", pinned);
+                }
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ(threads * appends, value.size());
+}
+
+TYPED_TEST(AtomicUpdateTest, ConcurrentCompareAndSwap) {
+    Storage &storage = this->storage;
+    storage.Put("COUNTER", "0");
+
+    // Classic optimistic increment: no update could be lost
+    const int threads = 4;
+    const int increments = 200;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&storage]() {
+            for (int i = 0; i < increments; i++) {
+                while (true) {
+                    PinnedValue value;
+                    uint64_t version;
+                    ASSERT_TRUE(storage.GetVersioned("COUNTER", value, version));
+                    std::string next = std::to_string(std::stoi(AsString(value)) + 1);
+                    if (storage.CompareAndSwap("COUNTER", next, version) == CasResult::kStored) {
+                        break;
+                    }
+                }
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("COUNTER", value));
+    EXPECT_EQ(std::to_string(threads * increments), value);
+}
+
+TEST(AtomicUpdateTest, LRUGrowsInPlace) {
+    LRUCacheImpl storage(1024 * 1024);
+    storage.Put("KEY1", std::string(100, 'x'));
+
+    // First append reallocates with extra room, next ones fit into it
+    EXPECT_TRUE(storage.Append("KEY1", "y"));
+    size_t used = storage.UsedMemory();
+    for (int i = 0; i < 40; i++) {
+        EXPECT_TRUE(storage.Append("KEY1", "y"));
+    }
+    EXPECT_EQ(used, storage.UsedMemory());
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ(std::string(100, 'x') + std::string(41, 'y'), value);
+}
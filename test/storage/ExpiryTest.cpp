@@ -0,0 +1,137 @@
+#include "gtest/gtest.h"
+#include <ctime>
+#include <string>
+
+#include <afina/Storage.h>
+#include <storage/ArenaImpl.h>
+#include <storage/LRUCacheImpl.h>
+#include <storage/LockFreeHashImpl.h>
+#include <storage/MapBasedGlobalLockImpl.h>
+#include <storage/MapBasedRWLockImpl.h>
+#include <storage/StripedLockImpl.h>
+
+using namespace Afina;
+using namespace Afina::Backend;
+using namespace std;
+
+template <typename T> class ExpiryTest : public ::testing::Test {
+protected:
+    T storage;
+};
+
+typedef ::testing::Types<MapBasedGlobalLockImpl, MapBasedRWLockImpl, StripedLockImpl, LRUCacheImpl, LockFreeHashImpl,
+                         ArenaImpl>
+    Backends;
+TYPED_TEST_CASE(ExpiryTest, Backends);
+
+TYPED_TEST(ExpiryTest, NotExpiredYet) {
+    Storage &storage = this->storage;
+
+    EXPECT_TRUE(storage.Put("KEY1", "val1", time(nullptr) + 1000));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val1", value);
+}
+
+TYPED_TEST(ExpiryTest, ExpiredIsAbsent) {
+    Storage &storage = this->storage;
+
+    EXPECT_TRUE(storage.Put("KEY1", "val1", time(nullptr) - 1));
+
+    std::string value;
+    PinnedValue pinned;
+    EXPECT_FALSE(storage.Get("KEY1", value));
+    EXPECT_FALSE(storage.GetPinned("KEY1", pinned));
+    EXPECT_FALSE(storage.Set("KEY1", "val2"));
+    EXPECT_FALSE(storage.Delete("KEY1"));
+    EXPECT_FALSE(storage.Get("KEY1", value));
+}
+
+TYPED_TEST(ExpiryTest, PutIfAbsentReplacesExpired) {
+    Storage &storage = this->storage;
+
+    storage.Put("KEY1", "val1", time(nullptr) - 1);
+    EXPECT_TRUE(storage.PutIfAbsent("KEY1", "val2"));
+    EXPECT_FALSE(storage.PutIfAbsent("KEY1", "val3"));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val2", value);
+}
+
+TYPED_TEST(ExpiryTest, UpdateResetsExpiration) {
+    Storage &storage = this->storage;
+
+    storage.Put("KEY1", "val1", time(nullptr) + 1000);
+    EXPECT_TRUE(storage.Set("KEY1", "val2", time(nullptr) - 1));
+
+    std::string value;
+    EXPECT_FALSE(storage.Get("KEY1", value));
+
+    storage.Put("KEY1", "val3");
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val3", value);
+}
+
+TYPED_TEST(ExpiryTest, ReapKeepsUpdated) {
+    Storage &storage = this->storage;
+
+    time_t now = time(nullptr);
+    storage.Put("KEY1", "val1", now - 1);
+    storage.Put("KEY2", "val2", now - 1);
+    storage.Put("KEY1", "val3");
+
+    for (int i = 0; i < 100; i++) {
+        storage.ReapExpired(now);
+    }
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val3", value);
+    EXPECT_FALSE(storage.Get("KEY2", value));
+}
+
+TYPED_TEST(ExpiryTest, ReapFollowsMovedExpiration) {
+    Storage &storage = this->storage;
+
+    time_t now = time(nullptr);
+    storage.Put("KEY1", "val1", now + 1);
+    for (int i = 2; i < 100; i++) {
+        storage.Set("KEY1", "val1", now + i);
+    }
+    storage.Put("KEY2", "val2", now + 100);
+    storage.Set("KEY2", "val2", now + 2);
+
+    std::string value;
+    for (int i = 0; i < 100; i++) {
+        storage.ReapExpired(now + 2);
+    }
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_FALSE(storage.Get("KEY2", value));
+
+    for (int i = 0; i < 100; i++) {
+        storage.ReapExpired(now + 99);
+    }
+    EXPECT_FALSE(storage.Get("KEY1", value));
+}
+
+TEST(ExpiryTest, ReapReleasesMemory) {
+    LRUCacheImpl storage(1024 * 1024);
+
+    time_t now = time(nullptr);
+    for (int i = 0; i < 100; i++) {
+        storage.Put("KEY" + std::to_string(i), std::string(100, 'x'), now - 1);
+    }
+    storage.Put("PERSISTENT", "val");
+    EXPECT_LT(100 * 100, storage.UsedMemory());
+
+    storage.ReapExpired(now);
+
+    LRUCacheImpl reference(1024 * 1024);
+    reference.Put("PERSISTENT", "val");
+    EXPECT_EQ(reference.UsedMemory(), storage.UsedMemory());
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("PERSISTENT", value));
+}
@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+#include <string>
+
+#include <storage/LRUCacheImpl.h>
+
+using namespace Afina::Backend;
+using namespace std;
+
+TEST(LRUCacheTest, PutGet) {
+    LRUCacheImpl storage;
+
+    EXPECT_TRUE(storage.Put("KEY1", "val1"));
+    EXPECT_TRUE(storage.Put("KEY2", "val2"));
+    EXPECT_FALSE(storage.PutIfAbsent("KEY1", "val3"));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val1", value);
+
+    // Grow value beyond its block, then shrink it back
+    EXPECT_TRUE(storage.Set("KEY1", std::string(1000, 'x')));
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ(std::string(1000, 'x'), value);
+
+    EXPECT_TRUE(storage.Put("KEY1", "v"));
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("v", value);
+
+    EXPECT_TRUE(storage.Delete("KEY1"));
+    EXPECT_FALSE(storage.Get("KEY1", value));
+    EXPECT_FALSE(storage.Set("KEY1", "val"));
+
+    EXPECT_TRUE(storage.Get("KEY2", value));
+    EXPECT_EQ("val2", value);
+}
+
+TEST(LRUCacheTest, ManyKeys) {
+    LRUCacheImpl storage(1024 * 1024 * 1024);
+
+    for (long i = 0; i < 100000; ++i) {
+        EXPECT_TRUE(storage.Put("Key" + to_string(i), "Val" + to_string(i)));
+    }
+
+    std::string value;
+    for (long i = 99999; i >= 0; --i) {
+        EXPECT_TRUE(storage.Get("Key" + to_string(i), value));
+        EXPECT_EQ("Val" + to_string(i), value);
+    }
+}
+
+TEST(LRUCacheTest, MemoryBudget) {
+    const size_t budget = 64 * 1024;
+    LRUCacheImpl storage(budget);
+
+    std::string big(1000, 'v');
+    for (long i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(storage.Put("Key" + to_string(i), big));
+        EXPECT_LE(storage.UsedMemory(), budget);
+    }
+
+    // Fewer than 64 values of 1000 bytes fit
+    std::string value;
+    EXPECT_TRUE(storage.Get("Key999", value));
+    EXPECT_FALSE(storage.Get("Key900", value));
+
+    // Value larger than whole budget is rejected
+    EXPECT_FALSE(storage.Put("huge", std::string(budget, 'x')));
+    EXPECT_FALSE(storage.Get("huge", value));
+}
+
+TEST(LRUCacheTest, EvictionOrder) {
+    const size_t budget = 4096;
+    LRUCacheImpl storage(budget);
+
+    std::string val(900, 'v');
+    EXPECT_TRUE(storage.Put("KEY1", val));
+    EXPECT_TRUE(storage.Put("KEY2", val));
+    EXPECT_TRUE(storage.Put("KEY3", val));
+
+    // Touch KEY1 so KEY2 becomes the least recently used one
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+
+    EXPECT_TRUE(storage.Put("KEY4", val));
+    EXPECT_TRUE(storage.Put("KEY5", val));
+
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_FALSE(storage.Get("KEY2", value));
+    EXPECT_TRUE(storage.Get("KEY5", value));
+}
+
+TEST(LRUCacheTest, ShrinkReleasesMemory) {
+    LRUCacheImpl storage(4 * 1024 * 1024);
+    LRUCacheImpl reference(4 * 1024 * 1024);
+    reference.Put("KEY1", "small");
+
+    // Entry is charged for the value it holds now, not for the largest one it has ever held
+    storage.Put("KEY1", std::string(1024 * 1024, 'x'));
+    EXPECT_LT(1024 * 1024, storage.UsedMemory());
+    EXPECT_TRUE(storage.Set("KEY1", "small"));
+    EXPECT_EQ(reference.UsedMemory(), storage.UsedMemory());
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("small", value);
+}
+
+TEST(LRUCacheTest, FailedUpdateKeepsValue) {
+    LRUCacheImpl storage(1024);
+
+    EXPECT_TRUE(storage.Put("KEY1", "val1"));
+    EXPECT_FALSE(storage.Put("KEY1", std::string(2048, 'x')));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val1", value);
+}
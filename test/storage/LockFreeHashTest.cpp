@@ -0,0 +1,176 @@
+#include "gtest/gtest.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <storage/Epoch.h>
+#include <storage/LockFreeHashImpl.h>
+
+using namespace Afina::Backend;
+using namespace std;
+
+TEST(LockFreeHashTest, PutGet) {
+    LockFreeHashImpl storage;
+
+    EXPECT_TRUE(storage.Put("KEY1", "val1"));
+    EXPECT_TRUE(storage.Put("KEY1", "val2"));
+    EXPECT_FALSE(storage.PutIfAbsent("KEY1", "val3"));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val2", value);
+
+    EXPECT_TRUE(storage.Delete("KEY1"));
+    EXPECT_FALSE(storage.Get("KEY1", value));
+    EXPECT_FALSE(storage.Delete("KEY1"));
+    EXPECT_FALSE(storage.Set("KEY1", "val4"));
+
+    EXPECT_TRUE(storage.PutIfAbsent("KEY1", "val5"));
+    EXPECT_TRUE(storage.Set("KEY1", "val6"));
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val6", value);
+}
+
+TEST(LockFreeHashTest, MaxSizeAndRebuild) {
+    LockFreeHashImpl storage(1000);
+
+    // Lots of distinct keys leave lots of tombstones, table must be rebuilt on the way
+    for (long i = 0; i < 100000; ++i) {
+        EXPECT_TRUE(storage.Put("Key" + to_string(i), "Val" + to_string(i)));
+    }
+
+    size_t found = 0;
+    std::string value;
+    for (long i = 0; i < 100000; ++i) {
+        if (storage.Get("Key" + to_string(i), value)) {
+            EXPECT_EQ("Val" + to_string(i), value);
+            found++;
+        }
+    }
+    EXPECT_LE(found, 1000);
+    EXPECT_TRUE(storage.Get("Key99999", value));
+
+    Epoch::Collect();
+}
+
+// Value written by the writer: writer id, sequence number and padding which must be intact
+static std::string MakeValue(int writer, long seq) {
+    std::string v = to_string(writer) + ":" + to_string(seq) + ":";
+    v.append(64 + seq % 64, 'a' + writer);
+    return v;
+}
+
+static bool ParseValue(const std::string &v, int &writer, long &seq) {
+    size_t p1 = v.find(':');
+    size_t p2 = v.find(':', p1 + 1);
+    if (p1 == std::string::npos || p2 == std::string::npos) {
+        return false;
+    }
+    writer = stoi(v.substr(0, p1));
+    seq = stol(v.substr(p1 + 1, p2 - p1 - 1));
+    return v == MakeValue(writer, seq);
+}
+
+// Several writers put increasing versions of a single key while deleters remove it and
+// readers check that values are never torn and never go back in time for the same writer
+TEST(LockFreeHashTest, SingleKeyLinearizability) {
+    LockFreeHashImpl storage(16);
+    const int writers = 4, readers = 4, deleters = 2;
+    const long ops = 20000;
+
+    std::atomic<bool> failed(false);
+    std::atomic<int> running_writers(writers);
+    std::vector<std::thread> threads;
+
+    for (int w = 0; w < writers; w++) {
+        threads.emplace_back([&, w]() {
+            for (long i = 0; i < ops; i++) {
+                if (!storage.Put("key", MakeValue(w, i))) {
+                    failed = true;
+                }
+            }
+            running_writers--;
+        });
+    }
+
+    for (int d = 0; d < deleters; d++) {
+        threads.emplace_back([&]() {
+            while (running_writers.load() > 0) {
+                storage.Delete("key");
+                std::this_thread::yield();
+            }
+        });
+    }
+
+    for (int r = 0; r < readers; r++) {
+        threads.emplace_back([&]() {
+            std::vector<long> last(writers, -1);
+            std::string value;
+            while (running_writers.load() > 0) {
+                if (!storage.Get("key", value)) {
+                    continue;
+                }
+
+                int writer;
+                long seq;
+                if (!ParseValue(value, writer, seq) || seq < last[writer]) {
+                    failed = true;
+                    return;
+                }
+                last[writer] = seq;
+            }
+        });
+    }
+
+    for (auto &t : threads) {
+        t.join();
+    }
+    EXPECT_FALSE(failed.load());
+
+    // Once everything settled last write must be visible
+    EXPECT_TRUE(storage.Put("key", "final"));
+    std::string value;
+    EXPECT_TRUE(storage.Get("key", value));
+    EXPECT_EQ("final", value);
+    EXPECT_TRUE(storage.Delete("key"));
+    EXPECT_FALSE(storage.Get("key", value));
+}
+
+// Concurrent Put/Delete/Get over many keys with eviction and rebuilds happening meanwhile
+TEST(LockFreeHashTest, Stress) {
+    LockFreeHashImpl storage(512);
+    const int threads_count = 8;
+    const long ops = 20000;
+
+    std::atomic<bool> failed(false);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threads_count; t++) {
+        threads.emplace_back([&, t]() {
+            unsigned seed = 17 * t + 3;
+            std::string value;
+            for (long i = 0; i < ops; i++) {
+                seed = seed * 1103515245 + 12345;
+                std::string key = "Key" + to_string((seed >> 8) % 2048);
+                switch (seed % 4) {
+                case 0:
+                    storage.Delete(key);
+                    break;
+                case 1:
+                    storage.Put(key, key + ":" + key);
+                    break;
+                default:
+                    if (storage.Get(key, value) && value != key + ":" + key) {
+                        failed = true;
+                    }
+                }
+            }
+        });
+    }
+
+    for (auto &t : threads) {
+        t.join();
+    }
+    EXPECT_FALSE(failed.load());
+    Epoch::Collect();
+}
@@ -0,0 +1,95 @@
+#include "gtest/gtest.h"
+#include <string>
+
+#include <afina/Storage.h>
+#include <storage/ArenaImpl.h>
+#include <storage/LRUCacheImpl.h>
+#include <storage/LockFreeHashImpl.h>
+#include <storage/MapBasedGlobalLockImpl.h>
+#include <storage/MapBasedRWLockImpl.h>
+#include <storage/StripedLockImpl.h>
+
+using namespace Afina;
+using namespace Afina::Backend;
+using namespace std;
+
+template <typename T> class PinnedValueTest : public ::testing::Test {
+protected:
+    T storage;
+};
+
+typedef ::testing::Types<MapBasedGlobalLockImpl, MapBasedRWLockImpl, StripedLockImpl, LRUCacheImpl, LockFreeHashImpl,
+                         ArenaImpl>
+    Backends;
+TYPED_TEST_CASE(PinnedValueTest, Backends);
+
+static std::string AsString(const PinnedValue &v) { return std::string(v.data(), v.size()); }
+
+TYPED_TEST(PinnedValueTest, GetPinned) {
+    Storage &storage = this->storage;
+
+    PinnedValue value;
+    EXPECT_FALSE(storage.GetPinned("KEY1", value));
+
+    storage.Put("KEY1", "val1");
+    EXPECT_TRUE(storage.GetPinned("KEY1", value));
+    EXPECT_EQ("val1", AsString(value));
+}
+
+TYPED_TEST(PinnedValueTest, SurvivesOverwrite) {
+    Storage &storage = this->storage;
+
+    storage.Put("KEY1", "val1");
+    PinnedValue value;
+    EXPECT_TRUE(storage.GetPinned("KEY1", value));
+
+    // Same size update could be done in place if value wasn't pinned
+    storage.Put("KEY1", "val2");
+    storage.Set("KEY1", "val3");
+    EXPECT_EQ("val1", AsString(value));
+
+    PinnedValue current;
+    EXPECT_TRUE(storage.GetPinned("KEY1", current));
+    EXPECT_EQ("val3", AsString(current));
+}
+
+TYPED_TEST(PinnedValueTest, SurvivesDelete) {
+    Storage &storage = this->storage;
+
+    std::string big(10000, 'x');
+    storage.Put("KEY1", big);
+    PinnedValue value;
+    EXPECT_TRUE(storage.GetPinned("KEY1", value));
+
+    storage.Delete("KEY1");
+    std::string tmp;
+    EXPECT_FALSE(storage.Get("KEY1", tmp));
+    EXPECT_EQ(big, AsString(value));
+
+    value.reset();
+    EXPECT_EQ(0, value.size());
+}
+
+TYPED_TEST(PinnedValueTest, PutReserved) {
+    Storage &storage = this->storage;
+
+    storage.Put("KEY1", "val1");
+    PinnedValue old;
+    EXPECT_TRUE(storage.GetPinned("KEY1", old));
+
+    std::shared_ptr<std::string> reserved = storage.ReserveValue(4);
+    ASSERT_EQ(0, reserved->size());
+    ASSERT_LE(4, reserved->capacity());
+    std::string tmp;
+    reserved->append("val2");
+    EXPECT_TRUE(storage.Get("KEY1", tmp));
+    EXPECT_EQ("val1", tmp);
+
+    EXPECT_TRUE(storage.PutReserved("KEY1", std::move(reserved)));
+    EXPECT_TRUE(storage.PutReserved("KEY2", storage.ReserveValue(0)));
+    EXPECT_TRUE(storage.Get("KEY1", tmp));
+    EXPECT_EQ("val2", tmp);
+    EXPECT_TRUE(storage.Get("KEY2", tmp));
+    EXPECT_EQ("", tmp);
+    EXPECT_EQ("val1", AsString(old));
+}
@@ -0,0 +1,102 @@
+#include "gtest/gtest.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <storage/MapBasedGlobalLockImpl.h>
+#include <storage/MapBasedRWLockImpl.h>
+
+using namespace Afina::Backend;
+using namespace std;
+
+TEST(RWLockTest, PutGet) {
+    MapBasedRWLockImpl storage;
+
+    storage.Put("KEY1", "val1");
+    storage.Put("KEY1", "val2");
+    EXPECT_FALSE(storage.PutIfAbsent("KEY1", "val3"));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val2", value);
+
+    EXPECT_TRUE(storage.Set("KEY1", "val4"));
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val4", value);
+
+    EXPECT_TRUE(storage.Delete("KEY1"));
+    EXPECT_FALSE(storage.Get("KEY1", value));
+    EXPECT_FALSE(storage.Delete("KEY1"));
+}
+
+TEST(RWLockTest, SecondChance) {
+    MapBasedRWLockImpl storage(3);
+
+    storage.Put("KEY1", "val1");
+    storage.Put("KEY2", "val2");
+    storage.Put("KEY3", "val3");
+
+    // KEY1 is referenced, so KEY2 is the one to go
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    storage.Put("KEY4", "val4");
+
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_FALSE(storage.Get("KEY2", value));
+    EXPECT_TRUE(storage.Get("KEY3", value));
+    EXPECT_TRUE(storage.Get("KEY4", value));
+}
+
+// Runs workload with the given percentage of Get operations from the given number of threads
+// and returns total throughput in operations per second
+static double Throughput(Afina::Storage &storage, int threads, int read_pct, long total_ops) {
+    const long keys = 10000;
+    for (long i = 0; i < keys; i++) {
+        storage.Put("Key" + to_string(i), "Val" + to_string(i));
+    }
+
+    long ops = total_ops / threads;
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&storage, ops, t, keys, read_pct]() {
+            std::string value;
+            unsigned seed = 7 * t + 1;
+            for (long i = 0; i < ops; i++) {
+                seed = seed * 1103515245 + 12345;
+                std::string key = "Key" + to_string(seed % keys);
+                if (long(i % 100) >= read_pct) {
+                    storage.Put(key, key);
+                } else {
+                    storage.Get(key, value);
+                }
+            }
+        });
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return (ops * threads) / elapsed.count();
+}
+
+TEST(RWLockTest, ReadScaling) {
+    const long total_ops = 200000;
+    for (int read_pct : {100, 95}) {
+        std::cout << read_pct << "% get" << std::endl;
+        std::cout << "threads\tmap_global ops/s\tmap_rwlock ops/s" << std::endl;
+        for (int threads = 1; threads <= 32; threads *= 2) {
+            MapBasedGlobalLockImpl global(100000);
+            MapBasedRWLockImpl rw(100000);
+
+            double g = Throughput(global, threads, read_pct, total_ops);
+            double r = Throughput(rw, threads, read_pct, total_ops);
+            std::cout << threads << "\t" << long(g) << "\t\t\t" << long(r) << std::endl;
+
+            EXPECT_GT(g, 0);
+            EXPECT_GT(r, 0);
+        }
+    }
+}
@@ -0,0 +1,149 @@
+#include "gtest/gtest.h"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <storage/MapBasedGlobalLockImpl.h>
+#include <storage/StripedLockImpl.h>
+
+using namespace Afina::Backend;
+using namespace std;
+
+TEST(StripedLockTest, PutGet) {
+    StripedLockImpl storage;
+
+    storage.Put("KEY1", "val1");
+    storage.Put("KEY2", "val2");
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val1", value);
+
+    EXPECT_TRUE(storage.Get("KEY2", value));
+    EXPECT_EQ("val2", value);
+
+    EXPECT_TRUE(storage.Delete("KEY1"));
+    EXPECT_FALSE(storage.Get("KEY1", value));
+    EXPECT_FALSE(storage.Set("KEY1", "val3"));
+    EXPECT_TRUE(storage.PutIfAbsent("KEY1", "val3"));
+    EXPECT_FALSE(storage.PutIfAbsent("KEY1", "val4"));
+
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val3", value);
+}
+
+TEST(StripedLockTest, MaxSize) {
+    StripedLockImpl storage(1000, 8);
+
+    for (long i = 0; i < 10000; ++i) {
+        storage.Put("Key" + to_string(i), "Val" + to_string(i));
+    }
+
+    // Shards together hold at most max_size items
+    size_t found = 0;
+    std::string value;
+    for (long i = 0; i < 10000; ++i) {
+        if (storage.Get("Key" + to_string(i), value)) {
+            EXPECT_EQ("Val" + to_string(i), value);
+            found++;
+        }
+    }
+    EXPECT_LE(found, 1000);
+    EXPECT_GT(found, 0);
+
+    // Recently written keys are alive
+    EXPECT_TRUE(storage.Get("Key9999", value));
+}
+
+TEST(StripedLockTest, MaxSizeNotDivisible) {
+    StripedLockImpl storage(17, 16);
+
+    for (long i = 0; i < 1000; ++i) {
+        storage.Put("Key" + to_string(i), "Val" + to_string(i));
+    }
+
+    size_t found = 0;
+    std::string value;
+    for (long i = 0; i < 1000; ++i) {
+        found += storage.Get("Key" + to_string(i), value) ? 1 : 0;
+    }
+    EXPECT_LE(found, 17);
+}
+
+TEST(StripedLockTest, PutReservedKeepsValue) {
+    StripedLockImpl storage;
+
+    // Reserved value ends up in the shard as it is, without copying
+    std::shared_ptr<std::string> reserved = storage.ReserveValue(64 * 1024);
+    reserved->append(64 * 1024, 'x');
+    const char *data = reserved->data();
+    EXPECT_TRUE(storage.PutReserved("KEY1", std::move(reserved)));
+
+    Afina::PinnedValue value;
+    EXPECT_TRUE(storage.GetPinned("KEY1", value));
+    EXPECT_EQ(data, value.data());
+    EXPECT_EQ(64 * 1024, value.size());
+}
+
+TEST(StripedLockTest, MaxSizeBelowStripes) {
+    StripedLockImpl storage(4, 16);
+
+    // Any key could be stored, whatever shard it goes to
+    std::string value;
+    for (long i = 0; i < 100; ++i) {
+        EXPECT_TRUE(storage.Put("Key" + to_string(i), "Val" + to_string(i)));
+        EXPECT_TRUE(storage.Get("Key" + to_string(i), value));
+    }
+}
+
+// Runs mixed workload of 90% Get and 10% Put on the given storage from the given number of
+// threads and returns total throughput in operations per second
+static double Throughput(Afina::Storage &storage, int threads, long total_ops) {
+    const long keys = 10000;
+    for (long i = 0; i < keys; i++) {
+        storage.Put("Key" + to_string(i), "Val" + to_string(i));
+    }
+
+    long ops = total_ops / threads;
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&storage, ops, t, keys]() {
+            std::string value;
+            unsigned seed = 7 * t + 1;
+            for (long i = 0; i < ops; i++) {
+                seed = seed * 1103515245 + 12345;
+                std::string key = "Key" + to_string(seed % keys);
+                if (i % 10 == 0) {
+                    storage.Put(key, key);
+                } else {
+                    storage.Get(key, value);
+                }
+            }
+        });
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return (ops * threads) / elapsed.count();
+}
+
+TEST(StripedLockTest, ThroughputScaling) {
+    const long total_ops = 200000;
+    std::cout << "threads\tmap_global ops/s\tstriped ops/s" << std::endl;
+    for (int threads = 1; threads <= 32; threads *= 2) {
+        MapBasedGlobalLockImpl global(100000);
+        StripedLockImpl striped(100000, 64);
+
+        double g = Throughput(global, threads, total_ops);
+        double s = Throughput(striped, threads, total_ops);
+        std::cout << threads << "\t" << long(g) << "\t\t\t" << long(s) << std::endl;
+
+        EXPECT_GT(g, 0);
+        EXPECT_GT(s, 0);
+    }
+}
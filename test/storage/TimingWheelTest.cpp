@@ -0,0 +1,71 @@
+#include "gtest/gtest.h"
+#include <ctime>
+#include <utility>
+#include <vector>
+
+#include <storage/TimingWheel.h>
+
+using namespace Afina::Backend;
+using namespace std;
+
+typedef vector<pair<time_t, int>> Fired;
+
+static size_t AdvanceTo(TimingWheel<int> &wheel, time_t now, Fired &fired, size_t budget = 1000) {
+    return wheel.Advance(now, budget, [&fired](time_t deadline, int value) { fired.emplace_back(deadline, value); });
+}
+
+TEST(TimingWheelTest, FiresWhenDue) {
+    TimingWheel<int> wheel(1000);
+    wheel.Schedule(1001, 1);
+    wheel.Schedule(1003, 3);
+    wheel.Schedule(999, 0);
+    EXPECT_EQ(3, wheel.size());
+
+    Fired fired;
+    EXPECT_EQ(1, AdvanceTo(wheel, 1000, fired));
+    EXPECT_EQ(Fired({{999, 0}}), fired);
+
+    fired.clear();
+    EXPECT_EQ(1, AdvanceTo(wheel, 1002, fired));
+    EXPECT_EQ(Fired({{1001, 1}}), fired);
+
+    fired.clear();
+    EXPECT_EQ(1, AdvanceTo(wheel, 1010, fired));
+    EXPECT_EQ(Fired({{1003, 3}}), fired);
+    EXPECT_EQ(0, wheel.size());
+}
+
+TEST(TimingWheelTest, FarDeadlines) {
+    // Deadlines fall into every level of the wheel
+    time_t start = 123456;
+    vector<time_t> deltas = {1, 63, 64, 100, 4095, 4096, 5000, 300000, 20000000};
+
+    TimingWheel<int> wheel(start);
+    for (size_t i = 0; i < deltas.size(); i++) {
+        wheel.Schedule(start + deltas[i], i);
+    }
+
+    for (size_t i = 0; i < deltas.size(); i++) {
+        Fired fired;
+        AdvanceTo(wheel, start + deltas[i] - 1, fired);
+        EXPECT_TRUE(fired.empty()) << "delta " << deltas[i];
+
+        AdvanceTo(wheel, start + deltas[i], fired);
+        EXPECT_EQ(Fired({{start + deltas[i], int(i)}}), fired) << "delta " << deltas[i];
+    }
+    EXPECT_EQ(0, wheel.size());
+}
+
+TEST(TimingWheelTest, Budget) {
+    TimingWheel<int> wheel(0);
+    for (int i = 0; i < 10; i++) {
+        wheel.Schedule(5, i);
+    }
+
+    Fired fired;
+    EXPECT_EQ(4, AdvanceTo(wheel, 10, fired, 4));
+    EXPECT_EQ(4, AdvanceTo(wheel, 10, fired, 4));
+    EXPECT_EQ(2, AdvanceTo(wheel, 10, fired, 4));
+    EXPECT_EQ(10, fired.size());
+    EXPECT_EQ(0, wheel.size());
+}